@@ -45,12 +45,32 @@ namespace transactions
      */
     class transactions_cleanup;
 
+    /** @internal
+     */
+    class timer_scheduler;
+
+    /** @internal
+     */
+    class atr_write_batcher;
+
+    /** @internal
+     */
+    class waitable_op_list;
+
     /** @brief Transaction logic should be contained in a lambda of this form */
     using logic = std::function<void(attempt_context&)>;
 
     /** @brief AsyncTransaction logic should be contained in a lambda of this form */
     using async_logic = std::function<void(async_attempt_context&)>;
 
+    /**
+     * @brief AsyncTransaction logic which calls done when it has finished, rather than when it returns
+     *
+     * This lets the logic issue operations from the callbacks of earlier ones.  Call done exactly once, with the error
+     * (if any) that should fail the attempt.
+     */
+    using async_logic_with_completion = std::function<void(async_attempt_context&, async_attempt_context::VoidCallback&& done)>;
+
     /** @brief AsyncTransaction callback when transaction has completed */
     using txn_complete_callback = std::function<void(std::optional<transaction_exception>, std::optional<transaction_result>)>;
 
@@ -175,6 +195,18 @@ namespace transactions
 
         void run(const per_transaction_config& config, async_logic&& logic, txn_complete_callback&& cb);
 
+        /**
+         * @brief Run a transaction
+         *
+         * As above, but the attempt is only committed once the logic calls its done callback.
+         *
+         * @param logic The lambda containing the async transaction logic.
+         * @param cb Called when the transaction is complete.
+         */
+        void run(async_logic_with_completion&& logic, txn_complete_callback&& cb);
+
+        void run(const per_transaction_config& config, async_logic_with_completion&& logic, txn_complete_callback&& cb);
+
         /**
          * @internal
          * called internally - will likely move
@@ -229,6 +261,33 @@ namespace transactions
             return *cleanup_;
         }
 
+        /**
+         * @internal
+         * Called internally
+         */
+        CB_NODISCARD timer_scheduler& scheduler()
+        {
+            return *scheduler_;
+        }
+
+        /**
+         * @internal
+         * Called internally
+         */
+        CB_NODISCARD atr_write_batcher& atr_batcher()
+        {
+            return *atr_batcher_;
+        }
+
+        /**
+         * @internal
+         * Work transactions leave running once they are done, which has to finish before we close
+         */
+        CB_NODISCARD waitable_op_list& background_ops()
+        {
+            return *background_ops_;
+        }
+
         /**
          * @brief Return a reference to the @ref core::cluster
          *
@@ -243,6 +302,10 @@ namespace transactions
         core::cluster& cluster_;
         transaction_config config_;
         std::unique_ptr<transactions_cleanup> cleanup_;
+        // outlives the scheduler, which may still be holding writes for it to send
+        std::unique_ptr<atr_write_batcher> atr_batcher_;
+        std::unique_ptr<timer_scheduler> scheduler_;
+        std::unique_ptr<waitable_op_list> background_ops_;
         const size_t max_attempts_{ 1000 };
         const std::chrono::milliseconds min_retry_delay_{ 1 };
     };
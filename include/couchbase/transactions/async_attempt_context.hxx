@@ -18,6 +18,8 @@
 #include <future>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <core/operations/document_query.hxx>
 #include <couchbase/transactions/exceptions.hxx>
@@ -44,6 +46,7 @@ namespace transactions
         using Callback = std::function<void(std::exception_ptr, std::optional<transaction_get_result>)>;
         using VoidCallback = std::function<void(std::exception_ptr)>;
         using QueryCallback = std::function<void(std::exception_ptr, std::optional<core::operations::query_response>)>;
+        using MultiCallback = std::function<void(std::exception_ptr, std::optional<std::vector<transaction_get_result>>)>;
         virtual ~async_attempt_context() = default;
         /**
          * Gets a document from the specified Couchbase collection matching the specified id.
@@ -61,6 +64,15 @@ namespace transactions
          */
         virtual void get_optional(const core::document_id& id, Callback&& cb) = 0;
 
+        /**
+         * Gets several documents at once.  All the lookups are issued together, rather than one after another.
+         *
+         * @param ids the IDs of the documents to get
+         * @param cb callback function with the documents, in the same order as ids, when all were found.  Otherwise it is
+         *           called with the first @ref transaction_operation_failed seen, once every lookup has completed.
+         */
+        virtual void get_multi(const std::vector<core::document_id>& ids, MultiCallback&& cb) = 0;
+
         /**
          * Mutates the specified document with new content, using the document's last TransactionDocument#cas().
          *
@@ -102,6 +114,46 @@ namespace transactions
         {
             return insert_raw(id, default_json_serializer::serialize(content), std::move(cb));
         }
+        /**
+         * Replaces several documents, staging the replacements concurrently.
+         *
+         * Each document is replaced exactly as by @ref replace, but up to @ref transaction_config::staging_concurrency()
+         * of them are in flight at once.
+         *
+         * @param docs the documents to be updated, each paired with the content to replace it with.
+         * @param cb callback function with the updated documents, in the same order as docs, when successful, or a
+         *           @ref transaction_operation_failed.
+         */
+        template<typename Content>
+        void replace_many(const std::vector<std::pair<transaction_get_result, Content>>& docs, MultiCallback&& cb)
+        {
+            std::vector<std::pair<transaction_get_result, std::string>> raw;
+            raw.reserve(docs.size());
+            for (const auto& doc : docs) {
+                raw.emplace_back(doc.first, default_json_serializer::serialize(doc.second));
+            }
+            return replace_many_raw(std::move(raw), std::move(cb));
+        }
+        /**
+         * Inserts several documents, staging the inserts concurrently.
+         *
+         * Each document is inserted exactly as by @ref insert, but up to @ref transaction_config::staging_concurrency()
+         * of them are in flight at once.
+         *
+         * @param docs the IDs of the documents to insert, each paired with its content.
+         * @param cb callback function with the new documents, in the same order as docs, when successful, or a
+         *           @ref transaction_operation_failed.
+         */
+        template<typename Content>
+        void insert_many(const std::vector<std::pair<core::document_id, Content>>& docs, MultiCallback&& cb)
+        {
+            std::vector<std::pair<core::document_id, std::string>> raw;
+            raw.reserve(docs.size());
+            for (const auto& doc : docs) {
+                raw.emplace_back(doc.first, default_json_serializer::serialize(doc.second));
+            }
+            return insert_many_raw(std::move(raw), std::move(cb));
+        }
         /**
          * Removes the specified document, using the document's last TransactionDocument#cas
          *
@@ -165,6 +217,12 @@ namespace transactions
 
         /** @internal */
         virtual void replace_raw(const transaction_get_result& document, const std::string& content, Callback&& cb) = 0;
+
+        /** @internal */
+        virtual void insert_many_raw(std::vector<std::pair<core::document_id, std::string>>&& docs, MultiCallback&& cb) = 0;
+
+        /** @internal */
+        virtual void replace_many_raw(std::vector<std::pair<transaction_get_result, std::string>>&& docs, MultiCallback&& cb) = 0;
     };
 
 } // namespace transactions
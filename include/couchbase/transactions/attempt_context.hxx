@@ -17,6 +17,8 @@
 
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <core/cluster.hxx>
 #include <couchbase/transactions/transaction_get_result.hxx>
@@ -64,6 +66,18 @@ namespace transactions
          */
         virtual std::optional<transaction_get_result> get_optional(const core::document_id& id) = 0;
 
+        /**
+         * Gets several documents at once.  All the lookups are issued together, so this takes roughly as long as a single
+         * @ref get, rather than one get per document.
+         *
+         * @param ids the IDs of the documents to get
+         * @return the documents, in the same order as ids
+         *
+         * @throws transaction_operation_failed if any of the documents cannot be read, exactly as @ref get would.  This
+         *         either should not be caught by the lambda, or rethrown if it is caught.
+         */
+        virtual std::vector<transaction_get_result> get_multi(const std::vector<core::document_id>& ids) = 0;
+
         /**
          * Mutates the specified document with new content, using the document's last TransactionDocument#cas().
          *
@@ -109,6 +123,50 @@ namespace transactions
         {
             return insert_raw(id, default_json_serializer::serialize(content));
         }
+        /**
+         * Replaces several documents, staging the replacements concurrently.
+         *
+         * Each document is replaced exactly as by @ref replace, but up to @ref transaction_config::staging_concurrency()
+         * of them are in flight at once.
+         *
+         * @param docs the documents to be updated, each paired with the content to replace it with.
+         * @return the documents, updated with their new CAS values, in the same order as docs.
+         *
+         * @throws transaction_operation_failed if any of the replacements fail.  This either should not be caught by the
+         *         lambda, or rethrown if it is caught.
+         */
+        template<typename Content>
+        std::vector<transaction_get_result> replace_many(const std::vector<std::pair<transaction_get_result, Content>>& docs)
+        {
+            std::vector<std::pair<transaction_get_result, std::string>> raw;
+            raw.reserve(docs.size());
+            for (const auto& doc : docs) {
+                raw.emplace_back(doc.first, default_json_serializer::serialize(doc.second));
+            }
+            return replace_many_raw(std::move(raw));
+        }
+        /**
+         * Inserts several documents, staging the inserts concurrently.
+         *
+         * Each document is inserted exactly as by @ref insert, but up to @ref transaction_config::staging_concurrency()
+         * of them are in flight at once.
+         *
+         * @param docs the IDs of the documents to insert, each paired with its content.
+         * @return the docs, with their new CAS values, in the same order as docs.
+         *
+         * @throws transaction_operation_failed if any of the inserts fail.  This either should not be caught by the lambda,
+         *         or rethrown if it is caught.
+         */
+        template<typename Content>
+        std::vector<transaction_get_result> insert_many(const std::vector<std::pair<core::document_id, Content>>& docs)
+        {
+            std::vector<std::pair<core::document_id, std::string>> raw;
+            raw.reserve(docs.size());
+            for (const auto& doc : docs) {
+                raw.emplace_back(doc.first, default_json_serializer::serialize(doc.second));
+            }
+            return insert_many_raw(std::move(raw));
+        }
         /**
          * Removes the specified document, using the document's last TransactionDocument#cas
          *
@@ -174,6 +232,12 @@ namespace transactions
 
         /** @internal */
         virtual transaction_get_result replace_raw(const transaction_get_result& document, const std::string& content) = 0;
+
+        /** @internal */
+        virtual std::vector<transaction_get_result> insert_many_raw(std::vector<std::pair<core::document_id, std::string>>&& docs) = 0;
+
+        /** @internal */
+        virtual std::vector<transaction_get_result> replace_many_raw(std::vector<std::pair<transaction_get_result, std::string>>&& docs) = 0;
     };
 
 } // namespace transactions
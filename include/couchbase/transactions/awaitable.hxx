@@ -0,0 +1,383 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * @file
+ * Optional C++20 coroutine layer over @ref async_attempt_context.
+ *
+ * The library itself is built as C++17, so everything here is only available when the including translation unit is
+ * compiled with coroutine support.  Nothing here blocks a thread: a coroutine is suspended while its operation is in
+ * flight, and resumed on whichever io thread completes it.
+ *
+ * @code{.cpp}
+ * transactions::attempt_task logic(transactions::awaitable_attempt_context ctx, core::document_id id)
+ * {
+ *     auto doc = co_await ctx.get(id);
+ *     co_await ctx.replace(doc, nlohmann::json{ { "a", "thing" } });
+ * }
+ *
+ * // then, from any coroutine:
+ * auto result = co_await transactions::run_async(txns, [id](transactions::awaitable_attempt_context ctx) {
+ *     return logic(ctx, id);
+ * });
+ * @endcode
+ */
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define COUCHBASE_TRANSACTIONS_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef COUCHBASE_TRANSACTIONS_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <couchbase/transactions.hxx>
+#include <couchbase/transactions/async_attempt_context.hxx>
+
+namespace couchbase
+{
+namespace transactions
+{
+    namespace internal
+    {
+        /**
+         * Awaits an operation which reports its outcome through a callback taking an exception_ptr and an optional value.
+         *
+         * The operation may call back before await_suspend returns, in which case the coroutine is not suspended at all.
+         */
+        template<typename T>
+        class operation_awaiter
+        {
+          public:
+            using callback = std::function<void(std::exception_ptr, std::optional<T>)>;
+            using starter = std::function<void(callback&&)>;
+
+            explicit operation_awaiter(starter&& start)
+              : start_(std::move(start))
+            {
+            }
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                handle_ = handle;
+                start_([this](std::exception_ptr err, std::optional<T> result) {
+                    error_ = err;
+                    result_ = std::move(result);
+                    // whichever of us gets here second resumes the coroutine.
+                    if (completed_.exchange(true)) {
+                        handle_.resume();
+                    }
+                });
+                return !completed_.exchange(true);
+            }
+
+            std::optional<T> await_resume()
+            {
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                return std::move(result_);
+            }
+
+          private:
+            starter start_;
+            std::coroutine_handle<> handle_;
+            std::atomic<bool> completed_{ false };
+            std::exception_ptr error_;
+            std::optional<T> result_;
+        };
+
+        /**
+         * As @ref operation_awaiter, for operations which always produce a value when they succeed.
+         */
+        template<typename T>
+        class required_awaiter : public operation_awaiter<T>
+        {
+          public:
+            using operation_awaiter<T>::operation_awaiter;
+
+            T await_resume()
+            {
+                return std::move(operation_awaiter<T>::await_resume().value());
+            }
+        };
+
+        /**
+         * As @ref operation_awaiter, for operations which only report an error.
+         */
+        class void_awaiter : public operation_awaiter<bool>
+        {
+          public:
+            explicit void_awaiter(std::function<void(async_attempt_context::VoidCallback&&)>&& start)
+              : operation_awaiter<bool>([start = std::move(start)](callback&& cb) {
+                  start([cb = std::move(cb)](std::exception_ptr err) { cb(err, std::nullopt); });
+              })
+            {
+            }
+
+            void await_resume()
+            {
+                operation_awaiter<bool>::await_resume();
+            }
+        };
+    } // namespace internal
+
+    /**
+     * @brief Wraps an @ref async_attempt_context, so its operations can be awaited.
+     *
+     * Errors are rethrown from the co_await, and should be allowed to propagate out of the attempt, exactly as with the
+     * synchronous @ref attempt_context.
+     */
+    class awaitable_attempt_context
+    {
+      public:
+        explicit awaitable_attempt_context(async_attempt_context& ctx)
+          : ctx_(ctx)
+        {
+        }
+
+        internal::required_awaiter<transaction_get_result> get(const core::document_id& id)
+        {
+            return internal::required_awaiter<transaction_get_result>(
+              [&ctx = ctx_, id](auto&& cb) { ctx.get(id, std::forward<decltype(cb)>(cb)); });
+        }
+
+        internal::operation_awaiter<transaction_get_result> get_optional(const core::document_id& id)
+        {
+            return internal::operation_awaiter<transaction_get_result>(
+              [&ctx = ctx_, id](auto&& cb) { ctx.get_optional(id, std::forward<decltype(cb)>(cb)); });
+        }
+
+        internal::required_awaiter<std::vector<transaction_get_result>> get_multi(const std::vector<core::document_id>& ids)
+        {
+            return internal::required_awaiter<std::vector<transaction_get_result>>(
+              [&ctx = ctx_, ids](auto&& cb) { ctx.get_multi(ids, std::forward<decltype(cb)>(cb)); });
+        }
+
+        template<typename Content>
+        internal::required_awaiter<transaction_get_result> insert(const core::document_id& id, const Content& content)
+        {
+            return internal::required_awaiter<transaction_get_result>(
+              [&ctx = ctx_, id, content](auto&& cb) { ctx.insert(id, content, std::forward<decltype(cb)>(cb)); });
+        }
+
+        template<typename Content>
+        internal::required_awaiter<transaction_get_result> replace(const transaction_get_result& document, const Content& content)
+        {
+            return internal::required_awaiter<transaction_get_result>(
+              [&ctx = ctx_, document, content](auto&& cb) { ctx.replace(document, content, std::forward<decltype(cb)>(cb)); });
+        }
+
+        template<typename Content>
+        internal::required_awaiter<std::vector<transaction_get_result>> insert_many(
+          const std::vector<std::pair<core::document_id, Content>>& docs)
+        {
+            return internal::required_awaiter<std::vector<transaction_get_result>>(
+              [&ctx = ctx_, docs](auto&& cb) { ctx.insert_many(docs, std::forward<decltype(cb)>(cb)); });
+        }
+
+        template<typename Content>
+        internal::required_awaiter<std::vector<transaction_get_result>> replace_many(
+          const std::vector<std::pair<transaction_get_result, Content>>& docs)
+        {
+            return internal::required_awaiter<std::vector<transaction_get_result>>(
+              [&ctx = ctx_, docs](auto&& cb) { ctx.replace_many(docs, std::forward<decltype(cb)>(cb)); });
+        }
+
+        internal::void_awaiter remove(const transaction_get_result& document)
+        {
+            return internal::void_awaiter([&ctx = ctx_, document](auto&& cb) { ctx.remove(document, std::forward<decltype(cb)>(cb)); });
+        }
+
+        internal::required_awaiter<core::operations::query_response> query(const std::string& statement,
+                                                                           const transaction_query_options& options = {})
+        {
+            return internal::required_awaiter<core::operations::query_response>(
+              [&ctx = ctx_, statement, options](auto&& cb) { ctx.query(statement, options, std::forward<decltype(cb)>(cb)); });
+        }
+
+        /**
+         * @brief Commits the attempt before the coroutine finishes.  There is no need to, as finishing commits it.
+         */
+        internal::void_awaiter commit()
+        {
+            return internal::void_awaiter([&ctx = ctx_](auto&& cb) { ctx.commit(std::forward<decltype(cb)>(cb)); });
+        }
+
+        internal::void_awaiter rollback()
+        {
+            return internal::void_awaiter([&ctx = ctx_](auto&& cb) { ctx.rollback(std::forward<decltype(cb)>(cb)); });
+        }
+
+        /**
+         * @brief The wrapped context, for anything not (yet) exposed as an awaitable.
+         */
+        async_attempt_context& context()
+        {
+            return ctx_;
+        }
+
+      private:
+        async_attempt_context& ctx_;
+    };
+
+    /**
+     * @brief Return type for coroutines containing the transaction logic.
+     *
+     * The coroutine does not start until @ref run_async starts the attempt, and the attempt is committed when the
+     * coroutine finishes.  An exception escaping the coroutine fails the attempt, just as with @ref attempt_context.
+     */
+    class attempt_task
+    {
+      public:
+        class promise_type
+        {
+          public:
+            attempt_task get_return_object()
+            {
+                return attempt_task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            auto final_suspend() noexcept
+            {
+                struct final_awaiter {
+                    bool await_ready() const noexcept
+                    {
+                        return false;
+                    }
+                    void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                    {
+                        // the frame goes before done is called, as done may well start the next attempt.
+                        auto done = std::move(handle.promise().done_);
+                        auto error = handle.promise().error_;
+                        handle.destroy();
+                        done(error);
+                    }
+                    void await_resume() const noexcept
+                    {
+                    }
+                };
+                return final_awaiter{};
+            }
+
+            void return_void()
+            {
+            }
+
+            void unhandled_exception()
+            {
+                error_ = std::current_exception();
+            }
+
+          private:
+            friend class attempt_task;
+            async_attempt_context::VoidCallback done_;
+            std::exception_ptr error_;
+        };
+
+        attempt_task(attempt_task&& other) noexcept
+          : handle_(std::exchange(other.handle_, nullptr))
+        {
+        }
+
+        attempt_task(const attempt_task&) = delete;
+        attempt_task& operator=(const attempt_task&) = delete;
+
+        ~attempt_task()
+        {
+            if (handle_) {
+                handle_.destroy();
+            }
+        }
+
+        /**
+         * @internal
+         * Runs the coroutine, which calls done when it has finished.  The coroutine then owns itself.
+         */
+        void start(async_attempt_context::VoidCallback&& done)
+        {
+            auto handle = std::exchange(handle_, nullptr);
+            handle.promise().done_ = std::move(done);
+            handle.resume();
+        }
+
+      private:
+        explicit attempt_task(std::coroutine_handle<promise_type> handle)
+          : handle_(handle)
+        {
+        }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    /** @brief Coroutine transaction logic should be contained in a lambda of this form */
+    using coroutine_logic = std::function<attempt_task(awaitable_attempt_context)>;
+
+    /**
+     * @brief Run a transaction from a coroutine, resuming with its @ref transaction_result.
+     *
+     * @param txns The transactions object to run the transaction with.
+     * @param config The configuration for this transaction.
+     * @param logic Called for each attempt, returning the coroutine containing the transaction logic.
+     * @throws @ref transaction_exception from the co_await, if the transaction fails.
+     */
+    inline internal::required_awaiter<transaction_result> run_async(transactions& txns,
+                                                                    const per_transaction_config& config,
+                                                                    coroutine_logic&& logic)
+    {
+        return internal::required_awaiter<transaction_result>([&txns, config, logic = std::move(logic)](auto&& cb) mutable {
+            txns.run(
+              config,
+              [logic = std::move(logic)](async_attempt_context& ctx, async_attempt_context::VoidCallback&& done) {
+                  logic(awaitable_attempt_context(ctx)).start(std::move(done));
+              },
+              [cb = std::move(cb)](std::optional<transaction_exception> err, std::optional<transaction_result> result) {
+                  if (err) {
+                      return cb(std::make_exception_ptr(*err), std::nullopt);
+                  }
+                  cb(nullptr, std::move(result));
+              });
+        });
+    }
+
+    inline internal::required_awaiter<transaction_result> run_async(transactions& txns, coroutine_logic&& logic)
+    {
+        return run_async(txns, per_transaction_config(), std::move(logic));
+    }
+} // namespace transactions
+} // namespace couchbase
+
+#endif
@@ -18,6 +18,7 @@
 
 #include <couchbase/support.hxx>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -40,43 +41,37 @@ namespace transactions
         document_metadata(std::optional<std::string> cas,
                           std::optional<std::string> revid,
                           std::optional<std::uint32_t> exptime,
-                          std::optional<std::string> crc32)
-          : cas_(std::move(cas))
-          , revid_(std::move(revid))
-          , exptime_(exptime)
-          , crc32_(crc32)
-        {
-        }
+                          std::optional<std::string> crc32);
 
         /** @internal
          * @brief Create document metadata, used in responses from query server.
          *
          * @param cas string representation of document cas.
          */
-        document_metadata(std::string cas)
-          : cas_(std::move(cas))
-        {
-        }
+        document_metadata(std::string cas);
+
+        /** @internal
+         * @brief Create document metadata from the $document virtual xattr, as returned by the server.
+         *
+         * It is only parsed when one of the accessors is first called, and copies share the parsed result.
+         *
+         * @param document the $document xattr, as json.
+         */
+        static document_metadata from_document_xattr(std::string document);
 
         /**
          * @brief Get CAS for the document
          *
          * @return the CAS of the document, as a string.
          */
-        CB_NODISCARD std::optional<std::string> cas() const
-        {
-            return cas_;
-        }
+        CB_NODISCARD std::optional<std::string> cas() const;
 
         /**
          * @brief Get revid for the document
          *
          * @return the revid of the document, as a string.
          */
-        CB_NODISCARD std::optional<std::string> revid() const
-        {
-            return revid_;
-        }
+        CB_NODISCARD std::optional<std::string> revid() const;
 
         /**
          * @brief Get the expiry of the document, if set
@@ -84,26 +79,21 @@ namespace transactions
          * @return the expiry of the document, if one was set, and the request
          *         specified it.
          */
-        CB_NODISCARD std::optional<std::uint32_t> exptime() const
-        {
-            return exptime_;
-        }
+        CB_NODISCARD std::optional<std::uint32_t> exptime() const;
 
         /**
          * @brief Get the crc for the document
          *
          * @return the crc-32 for the document, as a string
          */
-        CB_NODISCARD std::optional<std::string> crc32() const
-        {
-            return crc32_;
-        }
+        CB_NODISCARD std::optional<std::string> crc32() const;
 
       private:
-        const std::optional<std::string> cas_;
-        const std::optional<std::string> revid_;
-        const std::optional<std::uint32_t> exptime_;
-        const std::optional<std::string> crc32_;
+        struct state;
+        std::shared_ptr<state> state_;
+
+        explicit document_metadata(std::shared_ptr<state> state);
+        const state& parsed() const;
     };
 } // namespace transactions
 } // namespace couchbase
@@ -94,6 +94,13 @@ namespace transactions
         void clean(std::shared_ptr<spdlog::logger> logger, transactions_cleanup_attempt* result = nullptr);
         bool ready() const;
 
+        using doc_lists_callback = std::function<void(std::optional<std::vector<doc_record>>,
+                                                      std::optional<std::vector<doc_record>>,
+                                                      std::optional<std::vector<doc_record>>)>;
+        // calls call with the inserted, replaced and removed lists of the entry, then with those of each of its chunks.
+        // Public for testing.
+        void for_each_doc_lists(std::shared_ptr<spdlog::logger> logger, const doc_lists_callback& call);
+
         template<typename OStream>
         friend OStream& operator<<(OStream& os, const atr_cleanup_entry& e)
         {
@@ -18,7 +18,9 @@
 
 #include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -37,6 +39,12 @@ namespace transactions
     struct atr_entry {
       public:
         atr_entry() = default;
+        /**
+         * The doc lists and forward compatibility block are not parsed up front: most entries the lost attempts scan
+         * reads have not expired, so are never cleaned.  Instead each is a slice of raw, the attempts xattr the entry
+         * came from, which every entry of that ATR shares, and is parsed when asked for.  An empty slice means the
+         * field was not there.
+         */
         atr_entry(std::string atr_bucket,
                   std::string atr_id,
                   std::string attempt_id,
@@ -47,12 +55,14 @@ namespace transactions
                   std::optional<std::uint64_t> timestamp_rollback_ms,
                   std::optional<std::uint64_t> timestamp_rolled_back_ms,
                   std::optional<std::uint32_t> expires_after_ms,
-                  std::optional<std::vector<doc_record>> inserted_ids,
-                  std::optional<std::vector<doc_record>> replaced_ids,
-                  std::optional<std::vector<doc_record>> removed_ids,
-                  std::optional<nlohmann::json> forward_compat,
+                  std::shared_ptr<const std::string> raw,
+                  std::string_view inserted_ids,
+                  std::string_view replaced_ids,
+                  std::string_view removed_ids,
+                  std::string_view forward_compat,
                   std::uint64_t cas,
-                  std::optional<std::string> durability_level)
+                  std::optional<std::string> durability_level,
+                  std::uint32_t doc_list_chunks = 0)
           : atr_bucket_(std::move(atr_bucket))
           , atr_id_(std::move(atr_id))
           , attempt_id_(std::move(attempt_id))
@@ -63,15 +73,30 @@ namespace transactions
           , timestamp_rollback_ms_(timestamp_rollback_ms)
           , timestamp_rolled_back_ms_(timestamp_rolled_back_ms)
           , expires_after_ms_(expires_after_ms)
-          , inserted_ids_(std::move(inserted_ids))
-          , replaced_ids_(std::move(replaced_ids))
-          , removed_ids_(std::move(removed_ids))
-          , forward_compat_(std::move(forward_compat))
+          , raw_(std::move(raw))
+          , inserted_ids_(inserted_ids)
+          , replaced_ids_(replaced_ids)
+          , removed_ids_(removed_ids)
+          , forward_compat_(forward_compat)
           , cas_(cas)
-          , durability_level_(durability_level)
+          , durability_level_(std::move(durability_level))
+          , doc_list_chunks_(doc_list_chunks)
         {
         }
 
+        /**
+         * A copy of this entry without its doc lists, which holds on to nothing but its own forward compatibility
+         * block, rather than the whole of the ATR it came from.
+         */
+        CB_NODISCARD atr_entry without_doc_lists() const
+        {
+            atr_entry copy(*this);
+            copy.raw_ = std::make_shared<const std::string>(forward_compat_);
+            copy.inserted_ids_ = copy.replaced_ids_ = copy.removed_ids_ = {};
+            copy.forward_compat_ = *copy.raw_;
+            return copy;
+        }
+
         CB_NODISCARD bool has_expired(std::uint32_t safety_margin = 0) const
         {
             uint64_t cas_ms = cas_ / 1000000;
@@ -128,22 +153,33 @@ namespace transactions
 
         CB_NODISCARD std::optional<std::vector<doc_record>> inserted_ids() const
         {
-            return inserted_ids_;
+            return parse_doc_records(inserted_ids_);
         }
 
         CB_NODISCARD std::optional<std::vector<doc_record>> replaced_ids() const
         {
-            return replaced_ids_;
+            return parse_doc_records(replaced_ids_);
         }
 
         CB_NODISCARD std::optional<std::vector<doc_record>> removed_ids() const
         {
-            return removed_ids_;
+            return parse_doc_records(removed_ids_);
+        }
+
+        /**
+         * The number of chunks the attempt's doc lists were written to, rather than to the entry itself, if any.
+         */
+        CB_NODISCARD std::uint32_t doc_list_chunks() const
+        {
+            return doc_list_chunks_;
         }
 
         CB_NODISCARD std::optional<nlohmann::json> forward_compat() const
         {
-            return forward_compat_;
+            if (forward_compat_.empty()) {
+                return {};
+            }
+            return nlohmann::json::parse(forward_compat_.begin(), forward_compat_.end());
         }
 
         CB_NODISCARD std::optional<std::uint32_t> expires_after_ms() const
@@ -172,13 +208,30 @@ namespace transactions
         std::optional<std::uint64_t> timestamp_rollback_ms_;
         std::optional<std::uint64_t> timestamp_rolled_back_ms_;
         std::optional<std::uint32_t> expires_after_ms_;
-        std::optional<std::vector<doc_record>> inserted_ids_;
-        std::optional<std::vector<doc_record>> replaced_ids_;
-        std::optional<std::vector<doc_record>> removed_ids_;
-        std::optional<nlohmann::json> forward_compat_;
+        // the slices below point into raw_, so stay valid for as long as any copy of this entry is around.
+        std::shared_ptr<const std::string> raw_;
+        std::string_view inserted_ids_;
+        std::string_view replaced_ids_;
+        std::string_view removed_ids_;
+        std::string_view forward_compat_;
         std::uint64_t cas_{};
         // ExtStoreDurability
         std::optional<std::string> durability_level_;
+        std::uint32_t doc_list_chunks_{};
+
+        static std::optional<std::vector<doc_record>> parse_doc_records(std::string_view raw)
+        {
+            if (raw.empty()) {
+                return {};
+            }
+            auto list = nlohmann::json::parse(raw.begin(), raw.end());
+            std::vector<doc_record> records;
+            records.reserve(list.size());
+            for (auto& record : list) {
+                records.push_back(doc_record::create_from(record));
+            }
+            return records;
+        }
     };
 } // namespace transactions
 } // namespace couchbase
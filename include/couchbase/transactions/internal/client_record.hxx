@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,9 @@ namespace transactions
         bool override_active;
         uint64_t override_expires;
         uint64_t cas_now_nanos;
+        // for each vbucket count the clients are configured with, the most ATRs any of them is using.  The ATR ids
+        // depend on both.
+        std::map<uint32_t, uint32_t> num_atrs_by_num_vbuckets;
 
         template<typename OStream>
         friend OStream& operator<<(OStream& os, const client_record_details& details)
@@ -50,6 +54,11 @@ namespace transactions
             os << ", override_enabled: " << details.override_enabled;
             os << ", override_expires: " << details.override_expires;
             os << ", cas_now_nanos: " << details.cas_now_nanos;
+            os << ", num_atrs: {";
+            for (const auto& [num_vbuckets, num_atrs] : details.num_atrs_by_num_vbuckets) {
+                os << num_vbuckets << " vbuckets: " << num_atrs << ",";
+            }
+            os << "}";
             os << ", expired_client_ids: [";
             for (auto& id : details.expired_client_ids) {
                 os << id << ",";
@@ -0,0 +1,90 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <thread>
+
+namespace couchbase
+{
+namespace transactions
+{
+    /**
+     * Runs callbacks after a delay, using asio timers on a single thread, so waiting never blocks or creates a thread.
+     */
+    class timer_scheduler
+    {
+      public:
+        timer_scheduler();
+        ~timer_scheduler();
+
+        timer_scheduler(const timer_scheduler&) = delete;
+        timer_scheduler& operator=(const timer_scheduler&) = delete;
+
+        // Calls fn on the scheduler thread once delay has elapsed, or with asio::error::operation_aborted if the scheduler is
+        // closed first.  Once closed, fn is called straight away with operation_aborted, so a callback which schedules
+        // itself again must stop when it sees that.
+        void schedule(std::chrono::nanoseconds delay, std::function<void(std::error_code)>&& fn);
+
+        // Cancels any outstanding timers, waits for their callbacks to run, then stops the thread.
+        void close();
+
+      private:
+        struct state;
+        // shared with the thread, so that the io_context outlives its run() even if we are destroyed on that thread.
+        std::shared_ptr<state> state_;
+        std::thread thread_;
+    };
+
+    /**
+     * The asynchronous version of @ref exp_delay: an exponential backoff that waits on a @ref timer_scheduler rather than
+     * sleeping.
+     */
+    class async_exp_delay
+    {
+      public:
+        template<typename R1, typename P1, typename R2, typename P2, typename R3, typename P3>
+        async_exp_delay(timer_scheduler& scheduler,
+                        std::chrono::duration<R1, P1> initial,
+                        std::chrono::duration<R2, P2> max,
+                        std::chrono::duration<R3, P3> limit)
+          : scheduler_(scheduler)
+          , initial_delay_(std::chrono::duration_cast<std::chrono::nanoseconds>(initial))
+          , max_delay_(std::chrono::duration_cast<std::chrono::nanoseconds>(max))
+          , timeout_(std::chrono::duration_cast<std::chrono::nanoseconds>(limit))
+        {
+        }
+
+        // The first call just records the end time and calls cb straight away.  After that, cb is called once the delay has
+        // elapsed, or with a retry_operation_timeout if we are past the end time.
+        void operator()(std::function<void(std::exception_ptr)>&& cb);
+
+      private:
+        timer_scheduler& scheduler_;
+        std::chrono::nanoseconds initial_delay_;
+        std::chrono::nanoseconds max_delay_;
+        std::chrono::nanoseconds timeout_;
+        uint32_t retries_{ 0 };
+        std::optional<std::chrono::time_point<std::chrono::steady_clock>> end_time_;
+    };
+} // namespace transactions
+} // namespace couchbase
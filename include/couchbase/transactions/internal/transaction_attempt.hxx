@@ -27,6 +27,8 @@ namespace transactions
     struct transaction_attempt {
         std::string id;
         attempt_state state;
+        // the staged mutations have all been made visible, which may be before the attempt has reached COMPLETED
+        bool unstaging_complete;
         transaction_attempt();
     };
 } // namespace transactions
@@ -34,14 +34,16 @@ namespace couchbase
 namespace transactions
 {
     class attempt_context_impl;
+    class transaction_operation_failed;
 
-    class exp_delay;
+    class async_exp_delay;
 
     class transaction_context
     {
       public:
         transaction_context(transactions& txns, const per_transaction_config& conf = per_transaction_config());
         transaction_context(const transaction_context&);
+        ~transaction_context();
 
         CB_NODISCARD const std::string& transaction_id() const
         {
@@ -96,7 +98,21 @@ namespace transactions
 
         CB_NODISCARD bool has_expired_client_side();
 
-        void retry_delay();
+        // calls cb on the transactions' timer_scheduler, after a short delay
+        void retry_delay(std::function<void()>&& cb);
+
+        // calls cb on the transactions' timer_scheduler, after delay
+        void retry_delay(std::chrono::nanoseconds delay, std::function<void()>&& cb);
+
+        CB_NODISCARD atr_write_batcher& atr_batcher()
+        {
+            return transactions_.atr_batcher();
+        }
+
+        CB_NODISCARD waitable_op_list& background_ops()
+        {
+            return transactions_.background_ops();
+        }
 
         CB_NODISCARD std::chrono::time_point<std::chrono::steady_clock> start_time_client() const
         {
@@ -123,7 +139,7 @@ namespace transactions
 
         CB_NODISCARD transaction_result get_transaction_result() const
         {
-            return transaction_result{ transaction_id(), current_attempt().state == attempt_state::COMPLETED };
+            return transaction_result{ transaction_id(), current_attempt().unstaging_complete };
         }
         void new_attempt_context()
         {
@@ -168,6 +184,9 @@ namespace transactions
         std::chrono::nanoseconds remaining() const;
 
       private:
+        // called once any rollback needed for er has been done
+        void finish_error_handling(const transaction_operation_failed& er, txn_complete_callback&& cb);
+
         std::string transaction_id_;
 
         /** The time this overall transaction started */
@@ -189,7 +208,7 @@ namespace transactions
         transactions_cleanup& cleanup_;
         std::shared_ptr<attempt_context_impl> current_attempt_context_;
 
-        std::unique_ptr<exp_delay> delay_;
+        std::unique_ptr<async_exp_delay> delay_;
     };
 } // namespace transactions
 } // namespace couchbase
@@ -36,6 +36,7 @@ namespace transactions
     static const std::string ATR_FIELD_DOCS_INSERTED = "ins";
     static const std::string ATR_FIELD_DOCS_REPLACED = "rep";
     static const std::string ATR_FIELD_DOCS_REMOVED = "rem";
+    static const std::string ATR_FIELD_DOC_LIST_CHUNKS = "dlc";
     static const std::string ATR_FIELD_PER_DOC_ID = "id";
     static const std::string ATR_FIELD_PER_DOC_BUCKET = "bkt";
     static const std::string ATR_FIELD_PER_DOC_SCOPE = "scp";
@@ -27,6 +27,7 @@
 #include <limits>
 #include <random>
 #include <string>
+#include <string_view>
 #include <thread>
 
 namespace couchbase
@@ -57,6 +58,52 @@ namespace transactions
         return stoull(now_str, nullptr, 10) * 1000000000;
     }
 
+    static inline uint64_t byteswap64(uint64_t val)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_bswap64(val);
+#else
+        uint64_t ret = 0;
+        for (size_t ii = 0; ii < sizeof(uint64_t); ii++) {
+            ret = (ret << 8) | (val & 0xff);
+            val >>= 8;
+        }
+        return ret;
+#endif
+    }
+
+    /**
+     * ${Mutation.CAS} is written by kvengine with 'macroToString(htonll(info.cas))'.  Discussed this with KV team and, though there is
+     * consensus that this is off (htonll is definitely wrong, and a string is an odd choice), there are clients (SyncGateway) that
+     * consume the current string, so it can't be changed.  Note that only little-endian servers are supported for Couchbase, so the 8
+     * byte long inside the string will always be little-endian ordered.
+     *
+     * Looks like: "0x000058a71dd25c15"
+     * Want:        0x155CD21DA7580000   (1539336197457313792 in base10, an epoch time in millionths of a second)
+     *
+     * The lost attempts scan decodes several of these for every ATR entry, so rather than going through stoull this
+     * maps each hex digit arithmetically, without branching on it.  It expects what the server writes - anything other
+     * than hex digits gives a meaningless result rather than an error.
+     *
+     * returns epoch time in ms
+     */
+    static inline uint64_t parse_mutation_cas(std::string_view cas)
+    {
+        if (cas.size() > 1 && cas[0] == '0' && (cas[1] == 'x' || cas[1] == 'X')) {
+            cas.remove_prefix(2);
+        }
+        if (cas.size() > 16) {
+            throw std::out_of_range("mutation cas has too many digits");
+        }
+        uint64_t val = 0;
+        for (char c : cas) {
+            auto ch = static_cast<uint8_t>(c);
+            // '0'-'9' are 0x30-0x39, 'A'-'F' 0x41-0x46 and 'a'-'f' 0x61-0x66: letters have bit 6 set, and need 9 more
+            val = (val << 4) | ((ch & 0xf) + 9 * (ch >> 6));
+        }
+        return byteswap64(val) / 1000000;
+    }
+
     static inline std::string jsonify(const nlohmann::json& obj)
     {
         return obj.dump();
@@ -123,9 +170,8 @@ namespace transactions
         return req;
     }
 
-    static inline result wrap_operation_future(std::future<result>& fut, bool ignore_subdoc_errors = true)
+    static inline void validate_operation_result(result& res, bool ignore_subdoc_errors = true)
     {
-        auto res = fut.get();
         if (!res.is_success()) {
             throw client_error(res);
         }
@@ -142,6 +188,12 @@ namespace transactions
                 }
             }
         }
+    }
+
+    static inline result wrap_operation_future(std::future<result>& fut, bool ignore_subdoc_errors = true)
+    {
+        auto res = fut.get();
+        validate_operation_result(res, ignore_subdoc_errors);
         return res;
     }
 
@@ -244,6 +296,13 @@ namespace transactions
         return dist(gen);
     }
 
+    // The delay retry_op_exp uses before the given retry, for asynchronous code that drives its own retries.
+    static inline std::chrono::nanoseconds retry_op_exp_delay(size_t retries)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          DEFAULT_RETRY_OP_EXP_DELAY * (jitter() * pow(2, fmin(DEFAULT_RETRY_OP_EXPONENT_CAP, retries))));
+    }
+
     template<typename R, typename R1, typename P1, typename R2, typename P2, typename R3, typename P3>
     R retry_op_exponential_backoff_timeout(std::chrono::duration<R1, P1> initial_delay,
                                            std::chrono::duration<R2, P2> max_delay,
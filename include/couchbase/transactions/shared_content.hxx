@@ -0,0 +1,58 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace couchbase
+{
+namespace transactions
+{
+    /**
+     * @internal
+     * @brief An immutable document body, shared between the results, staged mutations and links which hold it.
+     *
+     * Copies share the one buffer, so passing a body from a get to a staged mutation and back out again as a
+     * read-your-own-write never copies it.
+     */
+    class shared_content
+    {
+      public:
+        shared_content() = default;
+
+        shared_content(std::string content)
+          : content_(std::make_shared<const std::string>(std::move(content)))
+        {
+        }
+
+        const std::string& str() const
+        {
+            static const std::string empty;
+            return content_ ? *content_ : empty;
+        }
+
+        bool empty() const
+        {
+            return str().empty();
+        }
+
+      private:
+        std::shared_ptr<const std::string> content_;
+    };
+} // namespace transactions
+} // namespace couchbase
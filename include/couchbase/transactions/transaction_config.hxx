@@ -207,6 +207,213 @@ namespace transactions
             return cleanup_client_attempts_;
         }
 
+        /**
+         * @brief Set the maximum number of documents unstaged concurrently during commit.
+         *
+         * @see unstaging_concurrency()
+         * @param value The maximum number of unstaging requests in flight.  Zero is treated as 1.
+         */
+        void unstaging_concurrency(size_t value)
+        {
+            unstaging_concurrency_ = value;
+        }
+
+        /**
+         * @brief Get the maximum number of documents unstaged concurrently during commit.
+         *
+         * Once a transaction has committed, each of its staged mutations is written to its document.  These
+         * writes are pipelined, and this limits how many of them are in flight at any one time.  Setting it to 1
+         * unstages the documents one at a time, in the order they were staged.
+         *
+         * @return The maximum number of unstaging requests in flight.
+         */
+        CB_NODISCARD size_t unstaging_concurrency() const
+        {
+            return unstaging_concurrency_;
+        }
+
+        /**
+         * @brief Set the maximum number of documents rolled back concurrently.
+         *
+         * @see rollback_concurrency()
+         * @param value The maximum number of rollback requests in flight.  Zero is treated as 1.
+         */
+        void rollback_concurrency(size_t value)
+        {
+            rollback_concurrency_ = value;
+        }
+
+        /**
+         * @brief Get the maximum number of documents rolled back concurrently.
+         *
+         * When an attempt is rolled back, the staged mutation on each of its documents is removed.  These
+         * removals are pipelined, each retrying independently, and this limits how many are in flight at once.
+         *
+         * @return The maximum number of rollback requests in flight.
+         */
+        CB_NODISCARD size_t rollback_concurrency() const
+        {
+            return rollback_concurrency_;
+        }
+
+        /**
+         * @brief Set the maximum number of documents staged concurrently by the batch mutations.
+         *
+         * @see staging_concurrency()
+         * @param value The maximum number of staging requests in flight.  Zero is treated as 1.
+         */
+        void staging_concurrency(size_t value)
+        {
+            staging_concurrency_ = value;
+        }
+
+        /**
+         * @brief Get the maximum number of documents staged concurrently by the batch mutations.
+         *
+         * @ref attempt_context::insert_many and @ref attempt_context::replace_many stage their documents
+         * concurrently, once the transaction's ATR entry is pending.  This limits how many of those staging
+         * requests are in flight at any one time.
+         *
+         * @return The maximum number of staging requests in flight.
+         */
+        CB_NODISCARD size_t staging_concurrency() const
+        {
+            return staging_concurrency_;
+        }
+
+        /**
+         * @brief Set the number of ATRs (active transaction records) to use, per bucket.
+         *
+         * @see num_atrs()
+         * @param value The number of ATRs.  Must be at least 1.
+         */
+        void num_atrs(size_t value)
+        {
+            num_atrs_ = value;
+        }
+
+        /**
+         * @brief Get the number of ATRs (active transaction records) to use, per bucket.
+         *
+         * Each attempt records its state in an ATR, chosen by the vbucket of the first document it mutates.  More ATRs
+         * spread that contention further when many transactions run at once, fewer mean less for the lost attempts
+         * cleanup to scan.  All the applications sharing a bucket should use the same number - although each scans at
+         * least as many as any of the others is using.  The default is 1024.
+         *
+         * @return The number of ATRs.
+         */
+        CB_NODISCARD size_t num_atrs() const
+        {
+            return num_atrs_;
+        }
+
+        /**
+         * @brief Set the number of vbuckets the buckets have.
+         *
+         * @see num_vbuckets()
+         * @param value The number of vbuckets.  Must be at least 1.
+         */
+        void num_vbuckets(size_t value)
+        {
+            num_vbuckets_ = value;
+        }
+
+        /**
+         * @brief Get the number of vbuckets the buckets have.
+         *
+         * The ATR ids are generated so that each ATR is on the same vbucket as the documents which use it.  The
+         * default of 1024 is right for most platforms.
+         *
+         * @return The number of vbuckets.
+         */
+        CB_NODISCARD size_t num_vbuckets() const
+        {
+            return num_vbuckets_;
+        }
+
+        /**
+         * @brief Set the number of staged mutations above which an attempt keeps its doc lists out of its ATR entry.
+         *
+         * @see doc_list_chunk_size()
+         * @param value The most documents listed in one chunk, or zero to always list them in the ATR entry.
+         */
+        void doc_list_chunk_size(size_t value)
+        {
+            doc_list_chunk_size_ = value;
+        }
+
+        /**
+         * @brief Get the number of staged mutations above which an attempt keeps its doc lists out of its ATR entry.
+         *
+         * When an attempt commits or rolls back, it lists every document it has staged in its ATR entry, so that
+         * cleanup can finish the job if the attempt does not.  All the entries in an ATR share one document, so an
+         * attempt which touches thousands of documents can make it too large to write.  An attempt with more staged
+         * mutations than this writes its lists to documents of their own instead, in chunks of this many.  Lost
+         * attempts cleanup must be able to read these, so only set this when every application sharing the bucket is
+         * using a version of this library which can.  The default is zero, which disables chunking.
+         *
+         * @return The most documents listed in one chunk, or zero if the lists are always in the ATR entry.
+         */
+        CB_NODISCARD size_t doc_list_chunk_size() const
+        {
+            return doc_list_chunk_size_;
+        }
+
+        /**
+         * @brief Set how long a write to an ATR waits for writes from other transactions to join it.
+         *
+         * @see atr_group_commit_window()
+         * @param window How long to wait, or zero to send every write on its own.
+         */
+        template<typename T>
+        void atr_group_commit_window(T window)
+        {
+            atr_group_commit_window_ = std::chrono::duration_cast<std::chrono::microseconds>(window);
+        }
+
+        /**
+         * @brief Get how long a write to an ATR waits for writes from other transactions to join it.
+         *
+         * Every transaction makes at least three durable writes to its ATR: setting its entry pending, committing it,
+         * and removing it once complete.  When many transactions run at once, several are often writing to the same
+         * ATR.  With a window, the writes made to an ATR within it are sent as a single durable request, so fewer
+         * durable writes are needed under load - at the cost of each waiting up to this long before being sent.  The
+         * default is zero, which sends every write on its own straight away.
+         *
+         * @return How long a write waits for others to join it.
+         */
+        CB_NODISCARD std::chrono::microseconds atr_group_commit_window() const
+        {
+            return atr_group_commit_window_;
+        }
+
+        /**
+         * @brief Set whether a commit returns before removing its entry from the ATR.
+         *
+         * @see defer_atr_complete()
+         * @param value True to leave removing the entry to the background.
+         */
+        void defer_atr_complete(bool value)
+        {
+            defer_atr_complete_ = value;
+        }
+
+        /**
+         * @brief Get whether a commit returns before removing its entry from the ATR.
+         *
+         * Once a transaction's documents are unstaged its entry in the ATR has done its job, but removing it is one more
+         * durable write before the commit returns.  With this set, the commit returns as soon as the documents are
+         * unstaged, and entries are removed in the background, those in the same ATR together in one request.  Any
+         * that cannot be removed are left for lost attempts cleanup, which finds them once they expire.  The testing
+         * hooks around completing the ATR entry are not called.  The default is false.
+         *
+         * @return True if a commit leaves removing its entry to the background.
+         */
+        CB_NODISCARD bool defer_atr_complete() const
+        {
+            return defer_atr_complete_;
+        }
+
         void custom_metadata_collection(const transaction_keyspace& keyspace)
         {
             custom_metadata_collection_ = keyspace;
@@ -258,6 +465,14 @@ namespace transactions
         std::unique_ptr<cleanup_testing_hooks> cleanup_hooks_;
         core::query_scan_consistency scan_consistency_;
         std::optional<transaction_keyspace> custom_metadata_collection_;
+        size_t unstaging_concurrency_;
+        size_t rollback_concurrency_;
+        size_t staging_concurrency_;
+        size_t num_atrs_;
+        size_t num_vbuckets_;
+        size_t doc_list_chunk_size_;
+        std::chrono::microseconds atr_group_commit_window_;
+        bool defer_atr_complete_;
     };
 } // namespace transactions
 } // namespace couchbase
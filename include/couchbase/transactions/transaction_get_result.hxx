@@ -20,6 +20,7 @@
 #include <core/operations.hxx>
 #include <couchbase/internal/nlohmann/json.hpp>
 #include <couchbase/transactions/document_metadata.hxx>
+#include <couchbase/transactions/shared_content.hxx>
 #include <couchbase/transactions/transaction_links.hxx>
 #include <couchbase/transactions/transcoder.hxx>
 #include <ostream>
@@ -37,7 +38,7 @@ namespace transactions
     class transaction_get_result
     {
       private:
-        std::string value_;
+        shared_content value_;
         core::document_id id_;
         uint64_t cas_;
         transaction_links links_;
@@ -111,22 +112,7 @@ namespace transactions
         template<typename Content>
         static transaction_get_result create_from(const transaction_get_result& document, Content content)
         {
-            transaction_links links(document.links().atr_id(),
-                                    document.links().atr_bucket_name(),
-                                    document.links().atr_scope_name(),
-                                    document.links().atr_collection_name(),
-                                    document.links().staged_transaction_id(),
-                                    document.links().staged_attempt_id(),
-                                    document.links().staged_content(),
-                                    document.links().cas_pre_txn(),
-                                    document.links().revid_pre_txn(),
-                                    document.links().exptime_pre_txn(),
-                                    document.links().crc32_of_staging(),
-                                    document.links().op(),
-                                    document.links().forward_compat(),
-                                    document.links().is_deleted());
-
-            return { document.id(), content, document.cas(), links, document.metadata() };
+            return { document.id(), content, document.cas(), document.links_, document.metadata() };
         }
 
         /** @internal */
@@ -135,6 +121,13 @@ namespace transactions
         /** @internal */
         static transaction_get_result create_from(const core::operations::lookup_in_response& resp);
 
+        /**
+         * @internal
+         * The lookups a transactional get needs, in the order create_from expects them.  Built once, so each get just
+         * copies them.
+         */
+        static const decltype(core::operations::lookup_in_request::specs)& lookup_specs();
+
         /** @internal */
         template<typename Content>
         transaction_get_result& operator=(const transaction_get_result& other)
@@ -189,12 +182,24 @@ namespace transactions
         template<typename Content>
         CB_NODISCARD Content content() const
         {
-            return default_json_serializer::deserialize<Content>(value_);
+            return default_json_serializer::deserialize<Content>(value_.str());
         }
 
         void content(const std::string& content)
         {
-            value_ = content;
+            value_ = shared_content(content);
+        }
+
+        /** @internal */
+        void content(shared_content content)
+        {
+            value_ = std::move(content);
+        }
+
+        /** @internal */
+        CB_NODISCARD const shared_content& content_buffer() const
+        {
+            return value_;
         }
 
         /**
@@ -218,7 +223,7 @@ namespace transactions
         }
 
         /** @internal */
-        CB_NODISCARD transaction_links links() const
+        CB_NODISCARD const transaction_links& links() const
         {
             return links_;
         }
@@ -16,13 +16,18 @@
 
 #pragma once
 
+#include <array>
+#include <bitset>
+#include <cstdint>
 #include <ostream>
 #include <string>
+#include <string_view>
 
 #include <optional>
 
 #include <couchbase/internal/nlohmann/json.hpp>
 #include <couchbase/support.hxx>
+#include <couchbase/transactions/shared_content.hxx>
 
 namespace couchbase
 {
@@ -32,23 +37,79 @@ namespace transactions
     class transaction_links
     {
       private:
-        std::optional<std::string> atr_id_;
-        std::optional<std::string> atr_bucket_name_;
-        std::optional<std::string> atr_scope_name_;
-        std::optional<std::string> atr_collection_name_;
-        // id of the transaction that has staged content
-        std::optional<std::string> staged_transaction_id_;
-        std::optional<std::string> staged_attempt_id_;
-        std::optional<std::string> staged_content_;
-
-        // for {BACKUP_FIELDS}
-        std::optional<std::string> cas_pre_txn_;
-        std::optional<std::string> revid_pre_txn_;
-        std::optional<uint32_t> exptime_pre_txn_;
-        std::optional<std::string> crc32_of_staging_;
-        std::optional<std::string> op_;
-        std::optional<nlohmann::json> forward_compat_;
-        bool is_deleted_;
+        enum field : std::size_t {
+            ATR_ID,
+            ATR_BUCKET_NAME,
+            ATR_SCOPE_NAME,
+            ATR_COLLECTION_NAME,
+            // id of the transaction that has staged content
+            STAGED_TRANSACTION_ID,
+            STAGED_ATTEMPT_ID,
+            // for {BACKUP_FIELDS}, the txn.restore xattr as json.  Only cleanup needs what is in it, so it is parsed on
+            // demand.
+            RESTORE,
+            CRC32_OF_STAGING,
+            OP,
+            // the txn.fc xattr as json, parsed on demand as it is rarely there.
+            FORWARD_COMPAT,
+            FIELD_COUNT
+        };
+        using field_values = std::array<std::optional<std::string>, FIELD_COUNT>;
+
+        // All the string fields, one after another, so copying links is one allocation at most.  A field ends at its
+        // entry in ends_, and starts where the one before it ends.  present_ tells an empty field from a missing one.
+        std::string buffer_;
+        std::array<std::uint32_t, FIELD_COUNT> ends_{};
+        std::bitset<FIELD_COUNT> present_;
+        std::optional<shared_content> staged_content_;
+        bool is_deleted_{ false };
+
+        void store(const field_values& values)
+        {
+            size_t size = 0;
+            for (const auto& value : values) {
+                size += value ? value->size() : 0;
+            }
+            buffer_.reserve(size);
+            for (size_t i = 0; i < FIELD_COUNT; i++) {
+                if (values[i]) {
+                    buffer_.append(*values[i]);
+                    present_.set(i);
+                }
+                ends_[i] = static_cast<std::uint32_t>(buffer_.size());
+            }
+        }
+
+        CB_NODISCARD std::optional<std::string_view> view(field f) const
+        {
+            if (!present_.test(f)) {
+                return std::nullopt;
+            }
+            std::uint32_t start = f == 0 ? 0 : ends_[f - 1];
+            return std::string_view(buffer_).substr(start, ends_[f] - start);
+        }
+
+        CB_NODISCARD std::optional<std::string> get(field f) const
+        {
+            if (auto value = view(f)) {
+                return std::string(*value);
+            }
+            return std::nullopt;
+        }
+
+        template<typename T>
+        std::optional<T> restore_field(const char* name) const
+        {
+            auto raw = view(RESTORE);
+            if (!raw) {
+                return std::nullopt;
+            }
+            auto restore = nlohmann::json::parse(raw->begin(), raw->end());
+            if (!restore.contains(name)) {
+                return std::nullopt;
+            }
+            return restore[name].get<T>();
+        }
 
       public:
         transaction_links() = default;
@@ -58,29 +119,27 @@ namespace transactions
                           std::optional<std::string> atr_collection_name,
                           std::optional<std::string> staged_transaction_id,
                           std::optional<std::string> staged_attempt_id,
-                          std::optional<std::string> staged_content,
-                          std::optional<std::string> cas_pre_txn,
-                          std::optional<std::string> revid_pre_txn,
-                          std::optional<uint32_t> exptime_pre_txn,
+                          std::optional<shared_content> staged_content,
+                          std::optional<std::string> restore,
                           std::optional<std::string> crc32_of_staging,
                           std::optional<std::string> op,
-                          std::optional<nlohmann::json> forward_compat,
+                          std::optional<std::string> forward_compat,
                           bool is_deleted)
-          : atr_id_(std::move(atr_id))
-          , atr_bucket_name_(std::move(atr_bucket_name))
-          , atr_scope_name_(std::move(atr_scope_name))
-          , atr_collection_name_(std::move(atr_collection_name))
-          , staged_transaction_id_(std::move(staged_transaction_id))
-          , staged_attempt_id_(std::move(staged_attempt_id))
-          , staged_content_(std::move(staged_content))
-          , cas_pre_txn_(std::move(cas_pre_txn))
-          , revid_pre_txn_(std::move(revid_pre_txn))
-          , exptime_pre_txn_(exptime_pre_txn)
-          , crc32_of_staging_(std::move(crc32_of_staging))
-          , op_(std::move(op))
-          , forward_compat_(forward_compat)
+          : staged_content_(std::move(staged_content))
           , is_deleted_(is_deleted)
         {
+            field_values values;
+            values[ATR_ID] = std::move(atr_id);
+            values[ATR_BUCKET_NAME] = std::move(atr_bucket_name);
+            values[ATR_SCOPE_NAME] = std::move(atr_scope_name);
+            values[ATR_COLLECTION_NAME] = std::move(atr_collection_name);
+            values[STAGED_TRANSACTION_ID] = std::move(staged_transaction_id);
+            values[STAGED_ATTEMPT_ID] = std::move(staged_attempt_id);
+            values[RESTORE] = std::move(restore);
+            values[CRC32_OF_STAGING] = std::move(crc32_of_staging);
+            values[OP] = std::move(op);
+            values[FORWARD_COMPAT] = std::move(forward_compat);
+            store(values);
         }
 
         /** @brief create links from query result
@@ -89,43 +148,45 @@ namespace transactions
          */
         explicit transaction_links(const nlohmann::json& json)
         {
+            field_values values;
             if (json.contains("txnMeta")) {
                 for (const auto& item : json["txnMeta"].items()) {
                     if (item.key() == "atmpt") {
-                        staged_attempt_id_ = item.value().get<std::string>();
+                        values[STAGED_ATTEMPT_ID] = item.value().get<std::string>();
                     }
                     if (item.key() == "txn") {
-                        staged_transaction_id_ = item.value().get<std::string>();
+                        values[STAGED_TRANSACTION_ID] = item.value().get<std::string>();
                     }
                     if (item.key() == "atr") {
-                        atr_id_ = item.value()["key"].get<std::string>();
-                        atr_bucket_name_ = item.value()["bkt"].get<std::string>();
-                        atr_scope_name_ = item.value()["scp"].get<std::string>();
-                        atr_collection_name_ = item.value()["coll"].get<std::string>();
+                        values[ATR_ID] = item.value()["key"].get<std::string>();
+                        values[ATR_BUCKET_NAME] = item.value()["bkt"].get<std::string>();
+                        values[ATR_SCOPE_NAME] = item.value()["scp"].get<std::string>();
+                        values[ATR_COLLECTION_NAME] = item.value()["coll"].get<std::string>();
                     }
                 }
             }
+            store(values);
         }
 
         void append_to_json(nlohmann::json& obj) const
         {
-            if (staged_attempt_id_) {
-                obj["txnMeta"]["atmpt"] = staged_attempt_id_.value();
+            if (auto value = view(STAGED_ATTEMPT_ID)) {
+                obj["txnMeta"]["atmpt"] = std::string(*value);
             }
-            if (staged_transaction_id_) {
-                obj["txnMeta"]["txn"] = staged_transaction_id_.value();
+            if (auto value = view(STAGED_TRANSACTION_ID)) {
+                obj["txnMeta"]["txn"] = std::string(*value);
             }
-            if (atr_id_) {
-                obj["txnMeta"]["atr"]["key"] = atr_id_.value();
+            if (auto value = view(ATR_ID)) {
+                obj["txnMeta"]["atr"]["key"] = std::string(*value);
             }
-            if (atr_bucket_name_) {
-                obj["txnMeta"]["atr"]["bkt"] = atr_bucket_name_.value();
+            if (auto value = view(ATR_BUCKET_NAME)) {
+                obj["txnMeta"]["atr"]["bkt"] = std::string(*value);
             }
-            if (atr_scope_name_) {
-                obj["txnMeta"]["atr"]["scp"] = atr_scope_name_.value();
+            if (auto value = view(ATR_SCOPE_NAME)) {
+                obj["txnMeta"]["atr"]["scp"] = std::string(*value);
             }
-            if (atr_collection_name_) {
-                obj["txnMeta"]["atr"]["coll"] = atr_collection_name_.value();
+            if (auto value = view(ATR_COLLECTION_NAME)) {
+                obj["txnMeta"]["atr"]["coll"] = std::string(*value);
             }
         }
 
@@ -134,7 +195,7 @@ namespace transactions
          */
         CB_NODISCARD bool is_document_in_transaction() const
         {
-            return !!(atr_id_);
+            return present_.test(ATR_ID);
         }
         CB_NODISCARD bool has_staged_content() const
         {
@@ -142,82 +203,105 @@ namespace transactions
         }
         CB_NODISCARD bool is_document_being_removed() const
         {
-            return (!!op_ && *op_ == "remove");
+            return view(OP) == std::optional<std::string_view>("remove");
         }
 
         CB_NODISCARD bool is_document_being_inserted() const
         {
-            return (!!op_ && *op_ == "insert");
+            return view(OP) == std::optional<std::string_view>("insert");
         }
 
         CB_NODISCARD bool has_staged_write() const
         {
-            return !!(staged_attempt_id_);
+            return present_.test(STAGED_ATTEMPT_ID);
         }
 
         CB_NODISCARD std::optional<std::string> atr_id() const
         {
-            return atr_id_;
+            return get(ATR_ID);
         }
 
         CB_NODISCARD std::optional<std::string> atr_bucket_name() const
         {
-            return atr_bucket_name_;
+            return get(ATR_BUCKET_NAME);
         }
 
         CB_NODISCARD std::optional<std::string> atr_scope_name() const
         {
-            return atr_scope_name_;
+            return get(ATR_SCOPE_NAME);
         }
 
         CB_NODISCARD std::optional<std::string> atr_collection_name() const
         {
-            return atr_collection_name_;
+            return get(ATR_COLLECTION_NAME);
         }
 
         CB_NODISCARD std::optional<std::string> staged_transaction_id() const
         {
-            return staged_transaction_id_;
+            return get(STAGED_TRANSACTION_ID);
         }
 
         CB_NODISCARD std::optional<std::string> staged_attempt_id() const
         {
-            return staged_attempt_id_;
+            return get(STAGED_ATTEMPT_ID);
+        }
+
+        /** As @ref staged_attempt_id, without copying it */
+        CB_NODISCARD std::optional<std::string_view> staged_attempt_id_view() const
+        {
+            return view(STAGED_ATTEMPT_ID);
         }
 
         CB_NODISCARD std::optional<std::string> cas_pre_txn() const
         {
-            return cas_pre_txn_;
+            return restore_field<std::string>("CAS");
         }
 
         CB_NODISCARD std::optional<std::string> revid_pre_txn() const
         {
-            return revid_pre_txn_;
+            // only present in 6.5+
+            return restore_field<std::string>("revid");
         }
 
         CB_NODISCARD std::optional<uint32_t> exptime_pre_txn() const
         {
-            return exptime_pre_txn_;
+            return restore_field<uint32_t>("exptime");
         }
 
         CB_NODISCARD std::optional<std::string> op() const
         {
-            return op_;
+            return get(OP);
         }
 
         CB_NODISCARD std::optional<std::string> crc32_of_staging() const
         {
-            return crc32_of_staging_;
+            return get(CRC32_OF_STAGING);
         }
 
-        CB_NODISCARD std::string staged_content() const
+        /** As @ref crc32_of_staging, without copying it */
+        CB_NODISCARD std::optional<std::string_view> crc32_of_staging_view() const
         {
-            return staged_content_ ? *staged_content_ : "";
+            return view(CRC32_OF_STAGING);
+        }
+
+        CB_NODISCARD const std::string& staged_content() const
+        {
+            return staged_content_buffer().str();
+        }
+
+        CB_NODISCARD const shared_content& staged_content_buffer() const
+        {
+            static const shared_content none;
+            return staged_content_ ? *staged_content_ : none;
         }
 
         CB_NODISCARD std::optional<nlohmann::json> forward_compat() const
         {
-            return forward_compat_;
+            auto raw = view(FORWARD_COMPAT);
+            if (!raw) {
+                return std::nullopt;
+            }
+            return nlohmann::json::parse(raw->begin(), raw->end());
         }
 
         CB_NODISCARD bool is_deleted() const
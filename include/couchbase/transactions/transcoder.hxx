@@ -65,7 +65,18 @@ namespace transactions
         template<typename T>
         T deserialize_from_json_string(const std::string& json_string)
         {
-            return deserialize<nlohmann::json>(json_string).get<T>();
+            if constexpr (std::is_same<T, std::string>::value) {
+                // a string with nothing to unescape just needs its quotes removing
+                if (json_string.size() >= 2 && json_string.front() == '"' && json_string.back() == '"' &&
+                    json_string.find('\\') == std::string::npos) {
+                    return json_string.substr(1, json_string.size() - 2);
+                }
+            }
+            if constexpr (std::is_same<T, nlohmann::json>::value) {
+                return nlohmann::json::parse(json_string);
+            } else {
+                return nlohmann::json::parse(json_string).get<T>();
+            }
         }
 
         template<typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
@@ -21,50 +21,287 @@
 #include <core/operations.hxx>
 #include <optional>
 
-#include <future>
+#include <charconv>
 #include <memory>
+#include <stdexcept>
+#include <string_view>
 #include <vector>
 
 namespace couchbase
 {
 namespace transactions
 {
+    namespace
+    {
+        /**
+         * Walks forwards through a JSON buffer, never building a DOM.  Callers pull out the scalars they want as they
+         * come to them, and skip everything else - remembering, if they like, where it was.  Anything malformed throws.
+         */
+        class json_scanner
+        {
+          public:
+            explicit json_scanner(std::string_view json)
+              : json_(json)
+            {
+            }
+
+            void expect(char c)
+            {
+                if (!consume(c)) {
+                    throw std::runtime_error(std::string("expected '") + c + "' at offset " + std::to_string(pos_));
+                }
+            }
+
+            // true, and moves past c, if c is next
+            bool consume(char c)
+            {
+                skip_whitespace();
+                if (pos_ < json_.size() && json_[pos_] == c) {
+                    ++pos_;
+                    return true;
+                }
+                return false;
+            }
+
+            // the contents of the next string, still escaped
+            std::string_view raw_string()
+            {
+                expect('"');
+                auto start = pos_;
+                while (pos_ < json_.size()) {
+                    auto c = json_[pos_++];
+                    if (c == '"') {
+                        return json_.substr(start, pos_ - start - 1);
+                    }
+                    if (c == '\\') {
+                        ++pos_;
+                    }
+                }
+                throw std::runtime_error("unterminated string");
+            }
+
+            std::string string()
+            {
+                auto raw = raw_string();
+                if (raw.find('\\') == std::string_view::npos) {
+                    return std::string(raw);
+                }
+                // rare enough to leave the unescaping to nlohmann
+                std::string_view quoted(raw.data() - 1, raw.size() + 2);
+                return nlohmann::json::parse(quoted.begin(), quoted.end()).get<std::string>();
+            }
+
+            std::uint32_t uint32()
+            {
+                auto raw = value();
+                std::uint32_t val{};
+                auto res = std::from_chars(raw.data(), raw.data() + raw.size(), val);
+                if (res.ec != std::errc() || res.ptr != raw.data() + raw.size()) {
+                    throw std::runtime_error("expected an unsigned number, got " + std::string(raw));
+                }
+                return val;
+            }
+
+            // skips the next value, of whatever type, returning where it was
+            std::string_view value()
+            {
+                skip_whitespace();
+                auto start = pos_;
+                if (pos_ >= json_.size()) {
+                    throw std::runtime_error("unexpected end of json");
+                }
+                switch (json_[pos_]) {
+                    case '"':
+                        raw_string();
+                        break;
+                    case '{':
+                    case '[':
+                        skip_container();
+                        break;
+                    default:
+                        while (pos_ < json_.size() && !is_delimiter(json_[pos_])) {
+                            ++pos_;
+                        }
+                }
+                return json_.substr(start, pos_ - start);
+            }
 
-    /*
-        inline active_transaction_record active_transaction_record::map_to_atr(const couchbase::document_id& atr_id,
-                                                                               result& res,
-                                                                               nlohmann::json& attempts)
+          private:
+            std::string_view json_;
+            size_t pos_{ 0 };
+
+            static bool is_delimiter(char c)
+            {
+                return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+            }
+
+            void skip_whitespace()
+            {
+                while (pos_ < json_.size() && (json_[pos_] == ' ' || json_[pos_] == '\t' || json_[pos_] == '\n' || json_[pos_] == '\r')) {
+                    ++pos_;
+                }
+            }
+
+            void skip_container()
+            {
+                size_t depth = 0;
+                while (pos_ < json_.size()) {
+                    switch (json_[pos_]) {
+                        case '"':
+                            raw_string();
+                            continue;
+                        case '{':
+                        case '[':
+                            ++depth;
+                            break;
+                        case '}':
+                        case ']':
+                            if (--depth == 0) {
+                                ++pos_;
+                                return;
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                    ++pos_;
+                }
+                throw std::runtime_error("unterminated object or array");
+            }
+        };
+
+        // reads the object for one attempt, which the scanner is at the start of
+        atr_entry read_entry(json_scanner& scanner,
+                             const std::string& atr_bucket,
+                             const std::string& atr_key,
+                             std::string attempt_id,
+                             const std::shared_ptr<const std::string>& raw,
+                             std::uint64_t now_ns)
         {
-            auto vbucket = res.values[1].content_as<nlohmann::json>();
-            auto now_ns = now_ns_from_vbucket(vbucket);
-            std::vector<atr_entry> entries;
-            entries.reserve(attempts.size());
-            for (auto& element : attempts.items()) {
-                auto& val = element.value();
-                entries.emplace_back(
-                  atr_id.bucket(),
-                  atr_id.key(),
-                  element.key(),
-                  attempt_state_value(val[ATR_FIELD_STATUS].get<std::string>()),
-                  parse_mutation_cas(val.value(ATR_FIELD_START_TIMESTAMP, "")),
-                  parse_mutation_cas(val.value(ATR_FIELD_START_COMMIT, "")),
-                  parse_mutation_cas(val.value(ATR_FIELD_TIMESTAMP_COMPLETE, "")),
-                  parse_mutation_cas(val.value(ATR_FIELD_TIMESTAMP_ROLLBACK_START, "")),
-                  parse_mutation_cas(val.value(ATR_FIELD_TIMESTAMP_ROLLBACK_COMPLETE, "")),
-                  val.count(ATR_FIELD_EXPIRES_AFTER_MSECS) ? std::make_optional(val[ATR_FIELD_EXPIRES_AFTER_MSECS].get<std::uint32_t>())
-                                                           : std::optional<std::uint32_t>(),
-                  process_document_ids(val, ATR_FIELD_DOCS_INSERTED),
-                  process_document_ids(val, ATR_FIELD_DOCS_REPLACED),
-                  process_document_ids(val, ATR_FIELD_DOCS_REMOVED),
-                  val.contains(ATR_FIELD_FORWARD_COMPAT) ? std::make_optional(val[ATR_FIELD_FORWARD_COMPAT].get<nlohmann::json>())
-                                                         : std::nullopt,
-                  now_ns,
-                  val.contains(ATR_FIELD_DURABILITY_LEVEL) ? std::make_optional(val[ATR_FIELD_DURABILITY_LEVEL].get<nlohmann::json>())
-                     : std::nullopt);
+            std::optional<std::string> status;
+            std::string_view tst, tsc, tsco, tsrs, tsrc;
+            std::optional<std::uint32_t> expires_after_ms;
+            std::string_view inserted, replaced, removed, forward_compat;
+            std::optional<std::string> durability_level;
+            std::uint32_t doc_list_chunks = 0;
+            scanner.expect('{');
+            if (!scanner.consume('}')) {
+                do {
+                    auto field = scanner.raw_string();
+                    scanner.expect(':');
+                    if (field == ATR_FIELD_STATUS) {
+                        status = scanner.string();
+                    } else if (field == ATR_FIELD_START_TIMESTAMP) {
+                        tst = scanner.raw_string();
+                    } else if (field == ATR_FIELD_START_COMMIT) {
+                        tsc = scanner.raw_string();
+                    } else if (field == ATR_FIELD_TIMESTAMP_COMPLETE) {
+                        tsco = scanner.raw_string();
+                    } else if (field == ATR_FIELD_TIMESTAMP_ROLLBACK_START) {
+                        tsrs = scanner.raw_string();
+                    } else if (field == ATR_FIELD_TIMESTAMP_ROLLBACK_COMPLETE) {
+                        tsrc = scanner.raw_string();
+                    } else if (field == ATR_FIELD_EXPIRES_AFTER_MSECS) {
+                        expires_after_ms = scanner.uint32();
+                    } else if (field == ATR_FIELD_DOCS_INSERTED) {
+                        inserted = scanner.value();
+                    } else if (field == ATR_FIELD_DOCS_REPLACED) {
+                        replaced = scanner.value();
+                    } else if (field == ATR_FIELD_DOCS_REMOVED) {
+                        removed = scanner.value();
+                    } else if (field == ATR_FIELD_FORWARD_COMPAT) {
+                        forward_compat = scanner.value();
+                    } else if (field == ATR_FIELD_DURABILITY_LEVEL) {
+                        durability_level = scanner.string();
+                    } else if (field == ATR_FIELD_DOC_LIST_CHUNKS) {
+                        doc_list_chunks = scanner.uint32();
+                    } else {
+                        scanner.value();
+                    }
+                } while (scanner.consume(','));
+                scanner.expect('}');
             }
-            return active_transaction_record(atr_id, res.cas, std::move(entries));
+            if (!status) {
+                throw std::runtime_error("attempt " + attempt_id + " has no status");
+            }
+            return atr_entry(atr_bucket,
+                             atr_key,
+                             std::move(attempt_id),
+                             attempt_state_value(*status),
+                             parse_mutation_cas(tst),
+                             parse_mutation_cas(tsc),
+                             parse_mutation_cas(tsco),
+                             parse_mutation_cas(tsrs),
+                             parse_mutation_cas(tsrc),
+                             expires_after_ms,
+                             raw,
+                             inserted,
+                             replaced,
+                             removed,
+                             forward_compat,
+                             now_ns,
+                             std::move(durability_level),
+                             doc_list_chunks);
+        }
+    } // namespace
+
+    std::vector<atr_entry> active_transaction_record::parse_attempts(const std::string& atr_bucket,
+                                                                     const std::string& atr_key,
+                                                                     std::shared_ptr<const std::string> raw,
+                                                                     std::uint64_t now_ns)
+    {
+        std::vector<atr_entry> entries;
+        json_scanner scanner(*raw);
+        scanner.expect('{');
+        if (scanner.consume('}')) {
+            return entries;
         }
+        do {
+            auto attempt_id = scanner.string();
+            scanner.expect(':');
+            entries.push_back(read_entry(scanner, atr_bucket, atr_key, std::move(attempt_id), raw, now_ns));
+        } while (scanner.consume(','));
+        scanner.expect('}');
+        return entries;
+    }
+
+    atr_entry active_transaction_record::parse_entry(const std::string& atr_bucket,
+                                                     const std::string& atr_key,
+                                                     const std::string& attempt_id,
+                                                     std::shared_ptr<const std::string> raw,
+                                                     std::uint64_t now_ns)
+    {
+        json_scanner scanner(*raw);
+        return read_entry(scanner, atr_bucket, atr_key, attempt_id, raw, now_ns);
+    }
 
-    */
+    active_transaction_record active_transaction_record::map_to_atr(const core::operations::lookup_in_response& resp)
+    {
+        std::vector<atr_entry> entries;
+        if (resp.fields[0].status == key_value_status_code::success) {
+            auto vbucket = default_json_serializer::deserialize<nlohmann::json>(to_string(resp.fields[1].value));
+            entries = parse_attempts(resp.ctx.bucket(),
+                                     resp.ctx.id(),
+                                     std::make_shared<const std::string>(to_string(resp.fields[0].value)),
+                                     now_ns_from_vbucket(vbucket));
+        }
+        return active_transaction_record(
+          { resp.ctx.bucket(), resp.ctx.scope(), resp.ctx.collection(), resp.ctx.id() }, resp.cas.value(), std::move(entries));
+    }
+
+    std::optional<atr_entry> active_transaction_record::map_to_atr_entry(const core::operations::lookup_in_response& resp,
+                                                                         const std::string& attempt_id)
+    {
+        // the entry not being there is not an error: the attempt may not have got that far, or been cleaned up since
+        if (resp.fields[0].status != key_value_status_code::success) {
+            return std::nullopt;
+        }
+        auto vbucket = default_json_serializer::deserialize<nlohmann::json>(to_string(resp.fields[1].value));
+        return parse_entry(resp.ctx.bucket(),
+                           resp.ctx.id(),
+                           attempt_id,
+                           std::make_shared<const std::string>(to_string(resp.fields[0].value)),
+                           now_ns_from_vbucket(vbucket));
+    }
 } // namespace transactions
 } // namespace couchbase
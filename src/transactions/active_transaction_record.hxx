@@ -16,6 +16,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -82,97 +83,103 @@ namespace transactions
             return f.get();
         }
 
-        active_transaction_record(const core::document_id& id, uint64_t, std::vector<atr_entry> entries)
-          : id_(std::move(id))
-          , entries_(std::move(entries))
+        /**
+         * Looks up just the one entry for attempt_id, rather than the whole ATR - which, with many attempts each listing
+         * many documents, can be large.  Calls cb with no entry if either the ATR or the entry is not there.
+         */
+        template<typename Callback>
+        static void get_atr_entry(core::cluster& cluster, const core::document_id& atr_id, const std::string& attempt_id, Callback&& cb)
         {
+            core::operations::lookup_in_request req{ atr_id };
+            req.specs =
+              lookup_in_specs{
+                  lookup_in_specs::get(ATR_FIELD_ATTEMPTS + "." + attempt_id).xattr(),
+                  lookup_in_specs::get("$vbucket").xattr(),
+              }
+                .specs();
+            cluster.execute(req, [attempt_id, cb = std::move(cb)](core::operations::lookup_in_response resp) {
+                if (resp.ctx.ec() == couchbase::errc::key_value::document_not_found) {
+                    return cb({}, std::nullopt, 0);
+                }
+                if (resp.ctx.ec()) {
+                    return cb(resp.ctx.ec(), std::nullopt, 0);
+                }
+                // only the parsing is guarded, so that cb is called just the once, even if it throws
+                std::optional<atr_entry> entry;
+                try {
+                    entry = map_to_atr_entry(resp, attempt_id);
+                } catch (const std::exception& e) {
+                    // as get_atr, a corrupt entry
+                    return cb(couchbase::errc::key_value::path_invalid, std::nullopt, 0);
+                }
+                cb({}, std::move(entry), resp.cas.value());
+            });
         }
 
-        CB_NODISCARD const std::vector<atr_entry>& entries() const
+        static std::optional<atr_entry> get_atr_entry(core::cluster& cluster,
+                                                      const core::document_id& atr_id,
+                                                      const std::string& attempt_id)
         {
-            return entries_;
+            auto barrier = std::promise<std::optional<atr_entry>>();
+            auto f = barrier.get_future();
+            get_atr_entry(cluster, atr_id, attempt_id, [&](std::error_code ec, std::optional<atr_entry> entry, uint64_t) {
+                if (!ec) {
+                    return barrier.set_value(std::move(entry));
+                }
+                return barrier.set_exception(std::make_exception_ptr(std::runtime_error(ec.message())));
+            });
+            return f.get();
         }
 
-      private:
-        core::document_id id_;
-        std::vector<atr_entry> entries_;
+        active_transaction_record(const core::document_id& id, uint64_t cas, std::vector<atr_entry> entries)
+          : id_(std::move(id))
+          , cas_(cas)
+          , entries_(std::move(entries))
+        {
+        }
 
-        /**
-         * ${Mutation.CAS} is written by kvengine with 'macroToString(htonll(info.cas))'.  Discussed this with KV team and, though there is
-         * consensus that this is off (htonll is definitely wrong, and a string is an odd choice), there are clients (SyncGateway) that
-         * consume the current string, so it can't be changed.  Note that only little-endian servers are supported for Couchbase, so the 8
-         * byte long inside the string will always be little-endian ordered.
-         *
-         * Looks like: "0x000058a71dd25c15"
-         * Want:        0x155CD21DA7580000   (1539336197457313792 in base10, an epoch time in millionths of a second)
-         *
-         * returns epoch time in ms
-         */
-        static inline uint64_t parse_mutation_cas(const std::string& cas)
+        CB_NODISCARD const core::document_id& id() const
         {
-            if (cas.empty()) {
-                return 0;
-            }
-
-            uint64_t val = stoull(cas, nullptr, 16);
-            /* byteswap */
-            size_t ii;
-            uint64_t ret = 0;
-            for (ii = 0; ii < sizeof(uint64_t); ii++) {
-                ret <<= 8ull;
-                ret |= val & 0xffull;
-                val >>= 8ull;
-            }
-            return ret / 1000000;
+            return id_;
         }
 
-        static inline std::optional<std::vector<doc_record>> process_document_ids(nlohmann::json& entry, std::string key)
+        CB_NODISCARD uint64_t cas() const
         {
-            if (entry.count(key) == 0) {
-                return {};
-            }
-            std::vector<doc_record> records;
-            records.reserve(entry[key].size());
-            for (auto& record : entry[key]) {
-                records.push_back(doc_record::create_from(record));
-            }
-            return std::move(records);
+            return cas_;
         }
-        static inline active_transaction_record map_to_atr(const core::operations::lookup_in_response& resp)
+
+        CB_NODISCARD const std::vector<atr_entry>& entries() const
         {
-            std::vector<atr_entry> entries;
-            if (resp.fields[0].status == key_value_status_code::success) {
-                auto attempts = nlohmann::json::parse(to_string(resp.fields[0].value));
-                auto vbucket = default_json_serializer::deserialize<nlohmann::json>(to_string(resp.fields[1].value));
-                auto now_ns = now_ns_from_vbucket(vbucket);
-                entries.reserve(attempts.size());
-                for (auto& element : attempts.items()) {
-                    auto& val = element.value();
-                    entries.emplace_back(
-                      resp.ctx.bucket(),
-                      resp.ctx.id(),
-                      element.key(),
-                      attempt_state_value(val[ATR_FIELD_STATUS].get<std::string>()),
-                      parse_mutation_cas(val.value(ATR_FIELD_START_TIMESTAMP, "")),
-                      parse_mutation_cas(val.value(ATR_FIELD_START_COMMIT, "")),
-                      parse_mutation_cas(val.value(ATR_FIELD_TIMESTAMP_COMPLETE, "")),
-                      parse_mutation_cas(val.value(ATR_FIELD_TIMESTAMP_ROLLBACK_START, "")),
-                      parse_mutation_cas(val.value(ATR_FIELD_TIMESTAMP_ROLLBACK_COMPLETE, "")),
-                      val.count(ATR_FIELD_EXPIRES_AFTER_MSECS) ? std::make_optional(val[ATR_FIELD_EXPIRES_AFTER_MSECS].get<std::uint32_t>())
-                                                               : std::optional<std::uint32_t>(),
-                      process_document_ids(val, ATR_FIELD_DOCS_INSERTED),
-                      process_document_ids(val, ATR_FIELD_DOCS_REPLACED),
-                      process_document_ids(val, ATR_FIELD_DOCS_REMOVED),
-                      val.contains(ATR_FIELD_FORWARD_COMPAT) ? std::make_optional(val[ATR_FIELD_FORWARD_COMPAT].get<nlohmann::json>())
-                                                             : std::nullopt,
-                      now_ns,
-                      val.contains(ATR_FIELD_DURABILITY_LEVEL) ? std::make_optional(val[ATR_FIELD_DURABILITY_LEVEL].get<nlohmann::json>())
-                                                               : std::nullopt);
-                }
-            }
-            return active_transaction_record(
-              { resp.ctx.bucket(), resp.ctx.scope(), resp.ctx.collection(), resp.ctx.id() }, resp.cas.value(), std::move(entries));
+            return entries_;
         }
+
+        /**
+         * Parses the attempts xattr of an ATR, without building a DOM for it.
+         *
+         * @param raw the attempts xattr.  The entries keep hold of it, as their doc lists are only parsed if asked for.
+         * @param now_ns the server time, from the $vbucket xattr read with it.
+         */
+        static std::vector<atr_entry> parse_attempts(const std::string& atr_bucket,
+                                                     const std::string& atr_key,
+                                                     std::shared_ptr<const std::string> raw,
+                                                     std::uint64_t now_ns);
+
+        /**
+         * As parse_attempts, for the object of a single attempt.
+         */
+        static atr_entry parse_entry(const std::string& atr_bucket,
+                                     const std::string& atr_key,
+                                     const std::string& attempt_id,
+                                     std::shared_ptr<const std::string> raw,
+                                     std::uint64_t now_ns);
+
+      private:
+        core::document_id id_;
+        uint64_t cas_;
+        std::vector<atr_entry> entries_;
+
+        static active_transaction_record map_to_atr(const core::operations::lookup_in_response& resp);
+        static std::optional<atr_entry> map_to_atr_entry(const core::operations::lookup_in_response& resp, const std::string& attempt_id);
     };
 
 } // namespace transactions
@@ -0,0 +1,161 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "atr_cache.hxx"
+
+#include <sstream>
+
+namespace tx = couchbase::transactions;
+
+namespace
+{
+// the same ATR on a different cluster is a different ATR
+std::string
+entry_key(const couchbase::core::cluster& cluster, const couchbase::core::document_id& atr_id, const std::string& attempt_id)
+{
+    std::ostringstream key;
+    key << static_cast<const void*>(&cluster) << "/" << atr_id.bucket() << "/" << atr_id.scope() << "/" << atr_id.collection() << "/"
+        << atr_id.key() << "/" << attempt_id;
+    return key.str();
+}
+
+bool
+is_resolved(tx::attempt_state state)
+{
+    switch (state) {
+        case tx::attempt_state::COMMITTED:
+        case tx::attempt_state::COMPLETED:
+        case tx::attempt_state::ABORTED:
+        case tx::attempt_state::ROLLED_BACK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool
+is_finished(tx::attempt_state state)
+{
+    return state == tx::attempt_state::COMPLETED || state == tx::attempt_state::ROLLED_BACK;
+}
+} // namespace
+
+tx::atr_cache&
+tx::atr_cache::instance()
+{
+    static atr_cache cache;
+    return cache;
+}
+
+tx::atr_cache::atr_cache()
+  : atr_cache([](core::cluster& cluster, const core::document_id& atr_id, const std::string& attempt_id, fetch_callback&& cb) {
+      active_transaction_record::get_atr_entry(cluster, atr_id, attempt_id, std::move(cb));
+  })
+{
+}
+
+tx::atr_cache::atr_cache(fetcher fetch)
+  : fetch_(std::move(fetch))
+{
+}
+
+void
+tx::atr_cache::get_entry(core::cluster& cluster,
+                         const core::document_id& atr_id,
+                         const std::string& attempt_id,
+                         bool finished_only,
+                         entry_callback&& cb)
+{
+    std::optional<atr_entry> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(entry_key(cluster, atr_id, attempt_id));
+        if (it != entries_.end() && (!finished_only || is_finished(it->second.entry.state()))) {
+            cached = it->second.entry;
+        }
+    }
+    if (cached) {
+        return cb({}, std::move(cached));
+    }
+    fetch(cluster, atr_id, attempt_id, std::move(cb));
+}
+
+void
+tx::atr_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    insertion_order_.clear();
+}
+
+void
+tx::atr_cache::fetch(core::cluster& cluster, const core::document_id& atr_id, const std::string& attempt_id, entry_callback&& cb)
+{
+    auto key = entry_key(cluster, atr_id, attempt_id);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& waiting = fetches_[key];
+        waiting.push_back(std::move(cb));
+        if (waiting.size() > 1) {
+            // someone else is already fetching it
+            return;
+        }
+    }
+    fetch_(cluster, atr_id, attempt_id, [this, key](std::error_code ec, std::optional<atr_entry> entry, std::uint64_t atr_cas) {
+        fetched(key, ec, entry, atr_cas);
+    });
+}
+
+void
+tx::atr_cache::fetched(const std::string& key, std::error_code ec, const std::optional<atr_entry>& entry, std::uint64_t atr_cas)
+{
+    std::vector<entry_callback> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = fetches_.find(key);
+        if (it == fetches_.end()) {
+            // the waiters have already been called back
+            return;
+        }
+        waiting = std::move(it->second);
+        fetches_.erase(it);
+        if (!ec && entry && is_resolved(entry->state())) {
+            add_unlocked(key, *entry, atr_cas);
+        }
+    }
+    for (auto& cb : waiting) {
+        cb(ec, entry);
+    }
+}
+
+void
+tx::atr_cache::add_unlocked(const std::string& key, const atr_entry& entry, std::uint64_t atr_cas)
+{
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        // only move forwards, in case this fetch was overtaken by another
+        if (atr_cas > it->second.atr_cas) {
+            it->second = { entry.without_doc_lists(), atr_cas };
+        }
+        return;
+    }
+    while (entries_.size() >= MAX_ENTRIES && !insertion_order_.empty()) {
+        entries_.erase(insertion_order_.front());
+        insertion_order_.pop_front();
+    }
+    entries_.emplace(key, cached_entry{ entry.without_doc_lists(), atr_cas });
+    insertion_order_.push_back(key);
+}
@@ -0,0 +1,96 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "active_transaction_record.hxx"
+#include "couchbase/transactions/internal/atr_entry.hxx"
+
+namespace couchbase
+{
+namespace transactions
+{
+    /**
+     * Finds the ATR entries of other transactions, on behalf of every attempt in the process.
+     *
+     * Once an attempt has reached COMMITTED or ABORTED, readers of the documents it staged know all they need to: the
+     * later COMPLETED and ROLLED_BACK states make no difference to which version of a document they see.  So entries in
+     * those states are kept here, and readers of a hot document staged by a transaction which has since committed do not
+     * each go back to its ATR.  Attempt ids are unique, so these never need invalidating.
+     *
+     * Anything else is fetched from the ATR - just the one entry - with concurrent requests for the same entry sharing a
+     * single fetch.  When two fetches of an entry overlap, the one which read the later CAS of the ATR wins.
+     */
+    class atr_cache
+    {
+      public:
+        using entry_callback = std::function<void(std::error_code, std::optional<atr_entry>)>;
+        using fetch_callback = std::function<void(std::error_code, std::optional<atr_entry>, std::uint64_t)>;
+        // fetches an entry, calling back with it and the CAS of the ATR it was read from
+        using fetcher = std::function<void(core::cluster&, const core::document_id&, const std::string&, fetch_callback&&)>;
+
+        static atr_cache& instance();
+
+        /** Fetches entries with @ref active_transaction_record::get_atr_entry */
+        atr_cache();
+
+        /** @internal For tests, which fetch entries themselves */
+        explicit atr_cache(fetcher fetch);
+
+        /**
+         * Calls cb with the entry for attempt_id in the ATR atr_id, or with no entry if the ATR has none.
+         *
+         * @param finished_only only use a cached entry if it is COMPLETED or ROLLED_BACK, for callers waiting for the
+         * attempt to be done with its documents, rather than just to have decided what to do with them.
+         */
+        void get_entry(core::cluster& cluster,
+                       const core::document_id& atr_id,
+                       const std::string& attempt_id,
+                       bool finished_only,
+                       entry_callback&& cb);
+
+        void clear();
+
+      private:
+        static constexpr size_t MAX_ENTRIES = 4096;
+
+        struct cached_entry {
+            atr_entry entry;
+            std::uint64_t atr_cas;
+        };
+
+        fetcher fetch_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, cached_entry> entries_;
+        // in the order they were added, so the oldest are dropped first once there are too many.
+        std::deque<std::string> insertion_order_;
+        std::unordered_map<std::string, std::vector<entry_callback>> fetches_;
+
+        void fetch(core::cluster& cluster, const core::document_id& atr_id, const std::string& attempt_id, entry_callback&& cb);
+        void fetched(const std::string& key, std::error_code ec, const std::optional<atr_entry>& entry, std::uint64_t atr_cas);
+        void add_unlocked(const std::string& key, const atr_entry& entry, std::uint64_t atr_cas);
+    };
+} // namespace transactions
+} // namespace couchbase
@@ -24,6 +24,7 @@
 #include "couchbase/transactions/internal/logging.hxx"
 #include "couchbase/transactions/internal/transactions_cleanup.hxx"
 #include "couchbase/transactions/internal/utils.hxx"
+#include "doc_list_chunks.hxx"
 #include "forward_compat.hxx"
 
 #include <optional>
@@ -88,24 +89,22 @@ tx::atr_cleanup_entry::clean(std::shared_ptr<spdlog::logger> logger, transaction
 {
     logger->trace("cleaning {}", *this);
     // get atr entry if needed
-    atr_entry entry;
     if (nullptr == atr_entry_) {
-        auto atr = tx::active_transaction_record::get_atr(cleanup_->cluster_ref(), atr_id_);
-        if (atr) {
-            // now get the specific attempt
-            auto it =
-              std::find_if(atr->entries().begin(), atr->entries().end(), [&](const atr_entry& e) { return e.attempt_id() == attempt_id_; });
-            if (it != atr->entries().end()) {
-                atr_entry_ = &(*it);
-                return check_atr_and_cleanup(logger, result);
-            } else {
-                logger->trace("could not find attempt {}, nothing to clean", attempt_id_);
-                return;
-            }
-        } else {
-            logger->trace("could not find atr {}, nothing to clean", atr_id_);
+        auto entry = tx::active_transaction_record::get_atr_entry(cleanup_->cluster_ref(), atr_id_, attempt_id_);
+        if (!entry) {
+            logger->trace("could not find attempt {} in atr {}, nothing to clean", attempt_id_, atr_id_);
             return;
         }
+        // only valid for the duration of this call
+        atr_entry_ = &*entry;
+        try {
+            check_atr_and_cleanup(logger, result);
+        } catch (...) {
+            atr_entry_ = nullptr;
+            throw;
+        }
+        atr_entry_ = nullptr;
+        return;
     }
     check_atr_and_cleanup(logger, result);
 }
@@ -152,22 +151,41 @@ tx::atr_cleanup_entry::cleanup_docs(std::shared_ptr<spdlog::logger> logger, dura
 {
     switch (atr_entry_->state()) {
         case tx::attempt_state::COMMITTED:
-            commit_docs(logger, atr_entry_->inserted_ids(), dl);
-            commit_docs(logger, atr_entry_->replaced_ids(), dl);
-            remove_docs_staged_for_removal(logger, atr_entry_->removed_ids(), dl);
+            for_each_doc_lists(logger, [&](auto inserted, auto replaced, auto removed) {
+                commit_docs(logger, std::move(inserted), dl);
+                commit_docs(logger, std::move(replaced), dl);
+                remove_docs_staged_for_removal(logger, std::move(removed), dl);
+            });
             break;
         // half-finished commit
         case tx::attempt_state::ABORTED:
             // half finished rollback
-            remove_docs(logger, atr_entry_->inserted_ids(), dl);
-            remove_txn_links(logger, atr_entry_->replaced_ids(), dl);
-            remove_txn_links(logger, atr_entry_->removed_ids(), dl);
+            for_each_doc_lists(logger, [&](auto inserted, auto replaced, auto removed) {
+                remove_docs(logger, std::move(inserted), dl);
+                remove_txn_links(logger, std::move(replaced), dl);
+                remove_txn_links(logger, std::move(removed), dl);
+            });
             break;
         default:
             logger->trace("attempt in {}, nothing to do in cleanup_docs", attempt_state_name(atr_entry_->state()));
     }
 }
 
+void
+tx::atr_cleanup_entry::for_each_doc_lists(std::shared_ptr<spdlog::logger> logger, const doc_lists_callback& call)
+{
+    call(atr_entry_->inserted_ids(), atr_entry_->replaced_ids(), atr_entry_->removed_ids());
+    // only one chunk is fetched at a time, however many the attempt wrote
+    for (std::uint32_t i = 0; i < atr_entry_->doc_list_chunks(); ++i) {
+        auto chunk = doc_list_chunks::read(cleanup_->cluster_ref(), cleanup_->config(), atr_id_, attempt_id_, i);
+        if (!chunk) {
+            logger->trace("doc list chunk {} of attempt {} has been removed, so has nothing left to clean", i, attempt_id_);
+            continue;
+        }
+        call(std::move(chunk->inserted), std::move(chunk->replaced), std::move(chunk->removed));
+    }
+}
+
 void
 tx::atr_cleanup_entry::do_per_doc(std::shared_ptr<spdlog::logger> logger,
                                   std::vector<tx::doc_record> docs,
@@ -177,23 +195,7 @@ tx::atr_cleanup_entry::do_per_doc(std::shared_ptr<spdlog::logger> logger,
     for (auto& dr : docs) {
         try {
             core::operations::lookup_in_request req{ dr.document_id() };
-            req.specs =
-              lookup_in_specs{
-                  lookup_in_specs::get(ATR_ID).xattr(),
-                  lookup_in_specs::get(TRANSACTION_ID).xattr(),
-                  lookup_in_specs::get(ATTEMPT_ID).xattr(),
-                  lookup_in_specs::get(STAGED_DATA).xattr(),
-                  lookup_in_specs::get(ATR_BUCKET_NAME).xattr(),
-                  lookup_in_specs::get(ATR_SCOPE_NAME).xattr(),
-                  lookup_in_specs::get(ATR_COLL_NAME).xattr(),
-                  lookup_in_specs::get(TRANSACTION_RESTORE_PREFIX_ONLY).xattr(),
-                  lookup_in_specs::get(TYPE).xattr(),
-                  lookup_in_specs::get(couchbase::subdoc::lookup_in_macro::document).xattr(),
-                  lookup_in_specs::get(CRC32_OF_STAGING).xattr(),
-                  lookup_in_specs::get(FORWARD_COMPAT).xattr(),
-                  lookup_in_specs::get(""),
-              }
-                .specs();
+            req.specs = transaction_get_result::lookup_specs();
             req.access_deleted = true;
             wrap_request(req, cleanup_->config());
             // now a blocking lookup_in...
@@ -214,17 +216,18 @@ tx::atr_cleanup_entry::do_per_doc(std::shared_ptr<spdlog::logger> logger,
                               "committed and skipping",
                               dr.id());
                 continue;
-            } else if (doc.links().staged_attempt_id() != attempt_id_) {
+            } else if (doc.links().staged_attempt_id_view() != attempt_id_) {
                 logger->trace(
                   "document {} staged for different attempt {}, skipping", dr.id(), doc.links().staged_attempt_id().value_or("<none>)"));
                 continue;
             }
             if (require_crc_to_match) {
-                if (!doc.metadata()->crc32() || !doc.links().crc32_of_staging() ||
-                    doc.links().crc32_of_staging() != doc.metadata()->crc32()) {
+                // no metadata when the $document xattr was not returned
+                auto crc32 = doc.metadata() ? doc.metadata()->crc32() : std::nullopt;
+                if (!crc32 || !doc.links().crc32_of_staging() || doc.links().crc32_of_staging() != crc32) {
                     logger->trace("document {} crc32 {} doesn't match staged value {}, skipping",
                                   dr.id(),
-                                  doc.metadata()->crc32().value_or("<none>"),
+                                  crc32.value_or("<none>"),
                                   doc.links().crc32_of_staging().value_or("<none>"));
                     continue;
                 }
@@ -252,7 +255,7 @@ tx::atr_cleanup_entry::commit_docs(std::shared_ptr<spdlog::logger> logger,
     if (docs) {
         do_per_doc(logger, *docs, true, [&](std::shared_ptr<spdlog::logger> logger, tx::transaction_get_result& doc, bool) {
             if (doc.links().has_staged_content()) {
-                auto content = doc.links().staged_content();
+                const auto& content = doc.links().staged_content();
                 auto ec = cleanup_->config().cleanup_hooks().before_commit_doc(doc.id().key());
                 if (ec) {
                     throw client_error(*ec, "before_commit_doc hook threw error");
@@ -404,6 +407,20 @@ tx::atr_cleanup_entry::cleanup_entry(std::shared_ptr<spdlog::logger> logger, dur
         if (ec) {
             throw client_error(*ec, "before_atr_remove hook threw error");
         }
+        // the chunks go before the entry, as nothing would find them after
+        if (auto chunks = atr_entry_->doc_list_chunks(); chunks > 0) {
+            auto barrier = std::make_shared<std::promise<void>>();
+            auto f = barrier->get_future();
+            doc_list_chunks::remove(
+              cleanup_->cluster_ref(), cleanup_->config(), dl, atr_id_, attempt_id_, chunks, [barrier](std::optional<client_error> err) {
+                  if (err) {
+                      return barrier->set_exception(std::make_exception_ptr(*err));
+                  }
+                  barrier->set_value();
+              });
+            f.get();
+            logger->trace("removed {} doc list chunks of attempt {}", chunks, attempt_id_);
+        }
         core::operations::mutate_in_request req{ atr_id_ };
         couchbase::mutate_in_specs mut_specs;
         if (atr_entry_->state() == tx::attempt_state::PENDING) {
@@ -16,18 +16,49 @@
 
 #pragma once
 
+#include <cstddef>
+#include <string>
 #include <vector>
 
 namespace couchbase
 {
 namespace transactions
 {
+    class transaction_config;
+
+    /**
+     * The ids of the ATRs transactions may use.
+     *
+     * ATR n lives on vbucket n % num_vbuckets: its id is "_txn:atr-n-#x", where x is the smallest hex number which puts
+     * it there.  With the defaults of 1024 of each these are the same ids as the other SDKs use, so they can clean up
+     * after each other.  Generating them takes a while, so it is done once for each combination, when first asked for.
+     */
     class atr_ids
     {
       public:
-        static const std::string& atr_id_for_vbucket(size_t vbucket_id);
-        static size_t vbucket_for_key(const std::string& key);
-        static const std::vector<std::string>& all();
+        static constexpr size_t DEFAULT_NUM_ATRS = 1024;
+        static constexpr size_t DEFAULT_NUM_VBUCKETS = 1024;
+
+        static const atr_ids& get(size_t num_atrs = DEFAULT_NUM_ATRS, size_t num_vbuckets = DEFAULT_NUM_VBUCKETS);
+        static const atr_ids& for_config(const transaction_config& config);
+
+        atr_ids(size_t num_atrs, size_t num_vbuckets);
+
+        // the ATR to use for documents on vbucket_id - on the same vbucket, unless there are fewer ATRs than vbuckets.
+        const std::string& atr_id_for_vbucket(size_t vbucket_id) const;
+        // as atr_id_for_vbucket, but the index of that ATR in all()
+        size_t index_for_vbucket(size_t vbucket_id) const;
+        size_t vbucket_for_key(const std::string& key) const;
+        const std::vector<std::string>& all() const;
+
+        size_t num_vbuckets() const
+        {
+            return num_vbuckets_;
+        }
+
+      private:
+        size_t num_vbuckets_;
+        std::vector<std::string> ids_;
     };
 
 } // namespace transactions
@@ -0,0 +1,185 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "atr_selector.hxx"
+#include "atr_ids.hxx"
+
+#include <couchbase/transactions/transaction_config.hxx>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+namespace tx = couchbase::transactions;
+
+namespace
+{
+std::string
+key_for(const couchbase::core::document_id& atr_id)
+{
+    std::string key;
+    key.reserve(atr_id.bucket().size() + atr_id.scope().size() + atr_id.collection().size() + atr_id.key().size() + 3);
+    return key.append(atr_id.bucket())
+      .append("/")
+      .append(atr_id.scope())
+      .append("/")
+      .append(atr_id.collection())
+      .append("/")
+      .append(atr_id.key());
+}
+} // namespace
+
+tx::atr_selector::lease::lease(atr_selector* selector, std::string key)
+  : selector_(selector)
+  , key_(std::move(key))
+{
+}
+
+tx::atr_selector::lease::lease(lease&& other) noexcept
+  : selector_(std::exchange(other.selector_, nullptr))
+  , key_(std::move(other.key_))
+{
+}
+
+tx::atr_selector::lease&
+tx::atr_selector::lease::operator=(lease&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        selector_ = std::exchange(other.selector_, nullptr);
+        key_ = std::move(other.key_);
+    }
+    return *this;
+}
+
+tx::atr_selector::lease::~lease()
+{
+    reset();
+}
+
+void
+tx::atr_selector::lease::reset()
+{
+    if (selector_ != nullptr) {
+        std::exchange(selector_, nullptr)->release(key_);
+    }
+}
+
+tx::atr_selector&
+tx::atr_selector::instance()
+{
+    static atr_selector selector;
+    return selector;
+}
+
+std::vector<size_t>
+tx::atr_selector::candidates(const atr_ids& ids, size_t vbucket)
+{
+    auto num_atrs = ids.all().size();
+    auto usual = ids.index_for_vbucket(vbucket);
+    std::vector<size_t> indexes{ usual };
+    // the others on the same vbucket first, then the ones after
+    for (auto i = usual + ids.num_vbuckets(); i < num_atrs; i += ids.num_vbuckets()) {
+        indexes.push_back(i);
+    }
+    for (size_t i = 1; i <= NEIGHBOURS; ++i) {
+        auto neighbour = (usual + i) % num_atrs;
+        if (std::find(indexes.begin(), indexes.end(), neighbour) == indexes.end()) {
+            indexes.push_back(neighbour);
+        }
+    }
+    return indexes;
+}
+
+couchbase::core::document_id
+tx::atr_selector::select(const transaction_config& config, const std::string& bucket, size_t vbucket, lease& claimed)
+{
+    // before taking the lock, as giving up the old claim needs it
+    claimed.reset();
+    const auto& ids = atr_ids::for_config(config);
+    auto indexes = candidates(ids, vbucket);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    auto is_full = [this, now](const std::string& key) {
+        auto it = full_.find(key);
+        if (it == full_.end()) {
+            return false;
+        }
+        if (it->second <= now) {
+            full_.erase(it);
+            return false;
+        }
+        return true;
+    };
+    std::optional<core::document_id> best;
+    std::string best_key;
+    size_t best_count = 0;
+    for (auto index : indexes) {
+        auto atr_id = config.atr_id_from_bucket_and_key(bucket, ids.all()[index]);
+        auto key = key_for(atr_id);
+        if (is_full(key)) {
+            continue;
+        }
+        auto it = in_flight_.find(key);
+        auto count = it == in_flight_.end() ? 0 : it->second;
+        if (!best || count < best_count) {
+            best = std::move(atr_id);
+            best_key = std::move(key);
+            best_count = count;
+        }
+        if (count == 0) {
+            break;
+        }
+    }
+    // every candidate is full, so look further afield - or if they all are, go back to the usual one.
+    for (size_t i = 1; !best && i <= ids.all().size(); ++i) {
+        auto index = (indexes.front() + i) % ids.all().size();
+        auto atr_id = config.atr_id_from_bucket_and_key(bucket, ids.all()[index]);
+        auto key = key_for(atr_id);
+        if (i == ids.all().size() || !is_full(key)) {
+            best = std::move(atr_id);
+            best_key = std::move(key);
+        }
+    }
+    ++in_flight_[best_key];
+    claimed = lease(this, std::move(best_key));
+    return std::move(*best);
+}
+
+void
+tx::atr_selector::mark_full(const core::document_id& atr_id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    full_[key_for(atr_id)] = std::chrono::steady_clock::now() + FULL_TTL;
+}
+
+size_t
+tx::atr_selector::in_flight(const core::document_id& atr_id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = in_flight_.find(key_for(atr_id));
+    return it == in_flight_.end() ? 0 : it->second;
+}
+
+void
+tx::atr_selector::release(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = in_flight_.find(key);
+    if (it != in_flight_.end() && --it->second == 0) {
+        in_flight_.erase(it);
+    }
+}
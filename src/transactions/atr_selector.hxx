@@ -0,0 +1,100 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <core/document_id.hxx>
+
+namespace couchbase
+{
+namespace transactions
+{
+    class atr_ids;
+    class transaction_config;
+
+    /**
+     * Chooses the ATR for each attempt in the process, steering clear of those other attempts are already writing to.
+     *
+     * Durable writes to the same ATR are serialized by the server, and concurrent ones come back as
+     * durable_write_in_progress, so an attempt does better on an ATR no one else here is using.  The ATR for the
+     * vbucket of the attempt's first document is still used whenever it is free, as before.  Otherwise the one with
+     * the fewest attempts using it is picked, from those on the same vbucket (when there are more ATRs than vbuckets)
+     * and a few after it.
+     *
+     * ATRs which have reported they are full are avoided for a while, looking beyond those candidates if need be, so
+     * the retry of an attempt which found its ATR full goes somewhere else.
+     */
+    class atr_selector
+    {
+      public:
+        /**
+         * An attempt's claim on an ATR, given up when this is destroyed or reset.
+         */
+        class lease
+        {
+          public:
+            lease() = default;
+            lease(lease&& other) noexcept;
+            lease& operator=(lease&& other) noexcept;
+            lease(const lease&) = delete;
+            lease& operator=(const lease&) = delete;
+            ~lease();
+
+            void reset();
+
+          private:
+            friend class atr_selector;
+            lease(atr_selector* selector, std::string key);
+
+            atr_selector* selector_{ nullptr };
+            std::string key_;
+        };
+
+        // how many of the ATRs after the usual one may be picked instead
+        static constexpr size_t NEIGHBOURS = 2;
+        // how long an ATR which is full is avoided for - long enough for cleanup to make some room in it.
+        static constexpr std::chrono::seconds FULL_TTL{ 10 };
+
+        static atr_selector& instance();
+
+        /**
+         * Picks the ATR for an attempt whose first mutation is of a document on vbucket, in bucket.  The ATR is in use
+         * until the lease is given up.
+         */
+        core::document_id select(const transaction_config& config, const std::string& bucket, size_t vbucket, lease& claimed);
+
+        // how many attempts are using the ATR
+        size_t in_flight(const core::document_id& atr_id);
+
+        // avoid the ATR for the next FULL_TTL, as it has no room for more entries
+        void mark_full(const core::document_id& atr_id);
+
+      private:
+        std::mutex mutex_;
+        std::unordered_map<std::string, size_t> in_flight_;
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> full_;
+
+        void release(const std::string& key);
+        static std::vector<size_t> candidates(const atr_ids& ids, size_t vbucket);
+    };
+} // namespace transactions
+} // namespace couchbase
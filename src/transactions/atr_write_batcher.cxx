@@ -0,0 +1,223 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "atr_write_batcher.hxx"
+#include "couchbase/transactions/internal/logging.hxx"
+#include "couchbase/transactions/internal/timer_scheduler.hxx"
+#include "couchbase/transactions/internal/utils.hxx"
+
+#include <algorithm>
+#include <iterator>
+
+namespace tx = couchbase::transactions;
+
+namespace
+{
+// Only writes with the same durability can share a request.
+std::string
+batch_key(const couchbase::core::operations::mutate_in_request& req)
+{
+    std::string key;
+    return key.append(req.id.bucket())
+      .append("/")
+      .append(req.id.scope())
+      .append("/")
+      .append(req.id.collection())
+      .append("/")
+      .append(req.id.key())
+      .append("/")
+      .append(std::to_string(static_cast<int>(req.durability_level)));
+}
+} // namespace
+
+tx::atr_write_batcher::atr_write_batcher(core::cluster& cluster, timer_scheduler& scheduler)
+  : atr_write_batcher([&cluster](core::operations::mutate_in_request req, callback&& cb) { cluster.execute(req, std::move(cb)); },
+                      scheduler)
+{
+}
+
+tx::atr_write_batcher::atr_write_batcher(sender send_request, timer_scheduler& scheduler)
+  : send_request_(std::move(send_request))
+  , scheduler_(scheduler)
+{
+}
+
+tx::atr_write_batcher::~atr_write_batcher()
+{
+    std::vector<std::shared_ptr<batch>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [key, b] : open_) {
+            if (!b->sent) {
+                b->sent = true;
+                pending.push_back(b);
+            }
+        }
+        open_.clear();
+    }
+    for (auto& b : pending) {
+        send(send_request_, std::move(b->writes));
+    }
+}
+
+std::size_t
+tx::atr_write_batcher::specs_needed(const batch& b, const write& w)
+{
+    // every write creating the ATR sets the same body, so the batch only needs to do that once
+    bool sets_body = w.creates_atr && !b.creates_atr;
+    return w.req.specs.size() + (sets_body ? 1 : 0);
+}
+
+void
+tx::atr_write_batcher::execute(core::operations::mutate_in_request req,
+                               bool creates_atr,
+                               std::chrono::microseconds window,
+                               callback&& cb)
+{
+    write w{ std::move(req), creates_atr, std::move(cb) };
+    if (window.count() <= 0) {
+        std::vector<write> writes;
+        writes.push_back(std::move(w));
+        return send(send_request_, std::move(writes));
+    }
+    auto key = batch_key(w.req);
+    // a batch this write would not fit in, and this write's own batch, if either is ready to go now
+    std::shared_ptr<batch> overflowed;
+    std::shared_ptr<batch> filled;
+    std::shared_ptr<batch> opened;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& b = open_[key];
+        if (b && b->specs + specs_needed(*b, w) > MAX_SPECS) {
+            overflowed = std::move(b);
+            overflowed->sent = true;
+        }
+        if (!b) {
+            b = std::make_shared<batch>();
+            opened = b;
+        }
+        b->specs += specs_needed(*b, w);
+        b->creates_atr = b->creates_atr || w.creates_atr;
+        b->writes.push_back(std::move(w));
+        if (b->specs >= MAX_SPECS) {
+            filled = std::move(b);
+            filled->sent = true;
+            open_.erase(key);
+        }
+    }
+    if (overflowed) {
+        send(send_request_, std::move(overflowed->writes));
+    }
+    if (filled) {
+        send(send_request_, std::move(filled->writes));
+    } else if (opened) {
+        // if the scheduler is closed this flushes straight away, so the batch is never left unsent
+        scheduler_.schedule(window, [this, key, opened](std::error_code) { flush(key, opened); });
+    }
+}
+
+void
+tx::atr_write_batcher::flush(const std::string& key, const std::shared_ptr<batch>& b)
+{
+    std::vector<write> writes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (b->sent) {
+            // it filled up before the window ended
+            return;
+        }
+        b->sent = true;
+        if (auto it = open_.find(key); it != open_.end() && it->second == b) {
+            open_.erase(it);
+        }
+        writes = std::move(b->writes);
+    }
+    send(send_request_, std::move(writes));
+}
+
+void
+tx::atr_write_batcher::send(const sender& send_request, std::vector<write> writes)
+{
+    std::vector<std::size_t> offsets;
+    auto req = merge(writes, offsets);
+    auto sent = std::make_shared<std::vector<write>>(std::move(writes));
+    send_request(std::move(req), [send_request, sent, offsets = std::move(offsets)](core::operations::mutate_in_response resp) {
+        auto& writes = *sent;
+        if (writes.size() == 1) {
+            return writes.front().cb(std::move(resp));
+        }
+        auto ec = error_class_from_response(resp);
+        if (ec == FAIL_PATH_ALREADY_EXISTS || ec == FAIL_PATH_NOT_FOUND) {
+            // nothing was written because of one write's spec, but we cannot tell whose - so let each find out for itself
+            txn_log->debug(
+              "merged write of {} attempts to atr {} failed with {}, sending each on its own", writes.size(), resp.ctx.id(), *ec);
+            for (auto& w : writes) {
+                std::vector<write> alone;
+                alone.push_back(std::move(w));
+                send(send_request, std::move(alone));
+            }
+            return;
+        }
+        if (ec) {
+            // anything else - a missing ATR, a timeout, ambiguity - would have happened to each of them alone too
+            for (auto& w : writes) {
+                w.cb(resp);
+            }
+            return;
+        }
+        for (std::size_t i = 0; i < writes.size(); ++i) {
+            writes[i].cb(slice(resp, offsets[i], writes[i].req.specs.size()));
+        }
+    });
+}
+
+couchbase::core::operations::mutate_in_request
+tx::atr_write_batcher::merge(const std::vector<write>& writes, std::vector<std::size_t>& offsets)
+{
+    // the durability and timeouts of the first stand for them all, as the batch key made sure they match
+    core::operations::mutate_in_request req = writes.front().req;
+    req.specs.clear();
+    offsets.clear();
+    offsets.reserve(writes.size());
+    bool creates_atr = false;
+    for (const auto& w : writes) {
+        offsets.push_back(req.specs.size());
+        req.specs.insert(req.specs.end(), w.req.specs.begin(), w.req.specs.end());
+        creates_atr = creates_atr || w.creates_atr;
+    }
+    if (creates_atr) {
+        // subdoc::opcode::set_doc used in replace w/ empty path
+        // ExtBinaryMetadata
+        auto body = couchbase::mutate_in_specs{ couchbase::mutate_in_specs::replace({}, std::string({ 0x00 })) }.specs();
+        req.specs.insert(req.specs.end(), std::make_move_iterator(body.begin()), std::make_move_iterator(body.end()));
+        req.store_semantics = couchbase::store_semantics::upsert;
+    }
+    return req;
+}
+
+couchbase::core::operations::mutate_in_response
+tx::atr_write_batcher::slice(const core::operations::mutate_in_response& resp, std::size_t offset, std::size_t count)
+{
+    // Only used when no one spec failed, so there is no index of the first error to worry about.
+    core::operations::mutate_in_response out = resp;
+    out.fields.clear();
+    if (offset < resp.fields.size()) {
+        auto begin = std::next(resp.fields.begin(), static_cast<std::ptrdiff_t>(offset));
+        auto end = std::next(begin, static_cast<std::ptrdiff_t>(std::min(count, resp.fields.size() - offset)));
+        out.fields.assign(begin, end);
+    }
+    return out;
+}
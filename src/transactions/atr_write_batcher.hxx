@@ -0,0 +1,114 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <core/cluster.hxx>
+
+namespace couchbase
+{
+namespace transactions
+{
+    class timer_scheduler;
+
+    /**
+     * Sends the writes attempts make to their ATR entries, merging those to the same ATR into one mutate_in when asked to.
+     *
+     * With a window, the first write to an ATR waits that long for others to join it, and then all of them go in a single
+     * durable request.  Every write gets its own slice of the response.  A merged request succeeds or fails as a whole,
+     * so when a spec of one of the writes in it fails - its path exists, or is not there - each write is sent again on
+     * its own, to get its own outcome.  Any other failure is passed on to all of them, as each of them sent alone would
+     * have met it just the same.
+     *
+     * A batch's window is a timer on the scheduler, so closing the scheduler sends every batch still waiting.
+     */
+    class atr_write_batcher
+    {
+      public:
+        using callback = std::function<void(core::operations::mutate_in_response)>;
+        // sends a request, calling back with its response
+        using sender = std::function<void(core::operations::mutate_in_request, callback&&)>;
+
+        struct write {
+            core::operations::mutate_in_request req;
+            // creates the ATR if need be, which also sets its (empty) body
+            bool creates_atr;
+            callback cb;
+        };
+
+        // at most this many specs go in one request
+        static constexpr std::size_t MAX_SPECS = 16;
+
+        /** Sends the requests with cluster */
+        atr_write_batcher(core::cluster& cluster, timer_scheduler& scheduler);
+
+        /** @internal For tests, which send the requests themselves */
+        atr_write_batcher(sender send_request, timer_scheduler& scheduler);
+
+        /**
+         * Sends any batches still waiting for their window to end.  The scheduler should be closed first, as its timers
+         * call back into us, and that will already have sent them - so this is only a backstop.
+         */
+        ~atr_write_batcher();
+
+        /**
+         * Sends a write to an ATR: straight away when window is zero, otherwise along with any other writes to the same
+         * ATR, with the same durability, made within window of the first of them.
+         */
+        void execute(core::operations::mutate_in_request req, bool creates_atr, std::chrono::microseconds window, callback&& cb);
+
+        /**
+         * The single request for writes, with the offset of each one's specs within it.
+         */
+        static core::operations::mutate_in_request merge(const std::vector<write>& writes, std::vector<std::size_t>& offsets);
+
+        /**
+         * The part of the response to a merged request for the count specs at offset.
+         */
+        static core::operations::mutate_in_response slice(const core::operations::mutate_in_response& resp,
+                                                          std::size_t offset,
+                                                          std::size_t count);
+
+      private:
+        struct batch {
+            std::vector<write> writes;
+            std::size_t specs{ 0 };
+            bool creates_atr{ false };
+            bool sent{ false };
+        };
+
+        sender send_request_;
+        timer_scheduler& scheduler_;
+        std::mutex mutex_;
+        // the batch each ATR is gathering writes for, if any
+        std::unordered_map<std::string, std::shared_ptr<batch>> open_;
+
+        static std::size_t specs_needed(const batch& b, const write& w);
+        void flush(const std::string& key, const std::shared_ptr<batch>& b);
+        // static, and holding on to its own copy of send_request, as the responses may come back after we have gone
+        static void send(const sender& send_request, std::vector<write> writes);
+    };
+} // namespace transactions
+} // namespace couchbase
@@ -16,13 +16,18 @@
 
 #include "attempt_context_impl.hxx"
 #include "active_transaction_record.hxx"
+#include "atr_cache.hxx"
 #include "atr_ids.hxx"
+#include "atr_write_batcher.hxx"
 #include "attempt_context_testing_hooks.hxx"
 #include "couchbase/transactions/internal/exceptions_internal.hxx"
 #include "couchbase/transactions/internal/logging.hxx"
 #include "couchbase/transactions/internal/utils.hxx"
+#include "doc_list_chunks.hxx"
 #include "forward_compat.hxx"
+#include "json_writer.hxx"
 #include "staged_mutation.hxx"
+#include "windowed_executor.hxx"
 #include <couchbase/transactions/attempt_state.hxx>
 
 namespace couchbase::transactions
@@ -38,6 +43,9 @@ static const std::string KV_REPLACE{ "EXECUTE __update" };
 static const std::string KV_REMOVE{ "EXECUTE __delete" };
 static const nlohmann::json KV_TXDATA{ { "kv", true } };
 
+// how long a deferred removal from an ATR waits for others to join it, when group commit has no longer window
+static const std::chrono::milliseconds DEFERRED_ATR_COMPLETE_WINDOW{ 10 };
+
 core::cluster&
 attempt_context_impl::cluster_ref()
 {
@@ -225,42 +233,116 @@ attempt_context_impl::get_optional(const core::document_id& id, Callback&& cb)
     });
 }
 
+std::vector<transaction_get_result>
+attempt_context_impl::get_multi(const std::vector<core::document_id>& ids)
+{
+    auto barrier = std::make_shared<std::promise<std::vector<transaction_get_result>>>();
+    auto f = barrier->get_future();
+    get_multi(ids, [barrier](std::exception_ptr err, std::optional<std::vector<transaction_get_result>> res) {
+        if (err) {
+            return barrier->set_exception(err);
+        }
+        return barrier->set_value(std::move(*res));
+    });
+    return f.get();
+}
+
+void
+attempt_context_impl::get_multi(const std::vector<core::document_id>& ids, MultiCallback&& cb)
+{
+    if (ids.empty()) {
+        return cb({}, std::vector<transaction_get_result>());
+    }
+    struct get_multi_state {
+        std::mutex mutex;
+        std::vector<std::optional<transaction_get_result>> results;
+        std::exception_ptr err;
+        size_t remaining;
+        MultiCallback cb;
+    };
+    auto state = std::make_shared<get_multi_state>();
+    state->results.resize(ids.size());
+    state->remaining = ids.size();
+    state->cb = std::move(cb);
+    // Each get is an op in its own right, doing its own read-your-own-writes check and, if the doc is in another
+    // transaction, its own ATR lookup.  Issuing them all before waiting on any lets those lookups run in parallel.  The
+    // last one to complete calls cb.
+    for (size_t i = 0; i < ids.size(); i++) {
+        get(ids[i], [state, i](std::exception_ptr err, std::optional<transaction_get_result> res) {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (err) {
+                if (!state->err) {
+                    state->err = err;
+                }
+            } else {
+                state->results[i] = std::move(res);
+            }
+            if (--state->remaining > 0) {
+                return;
+            }
+            lock.unlock();
+            if (state->err) {
+                return state->cb(state->err, std::nullopt);
+            }
+            std::vector<transaction_get_result> docs;
+            docs.reserve(state->results.size());
+            for (auto& doc : state->results) {
+                docs.push_back(std::move(*doc));
+            }
+            state->cb({}, std::move(docs));
+        });
+    }
+}
+
+void
+attempt_context_impl::write_staging_prefix()
+{
+    staging_prefix_.clear();
+    json_writer<std::vector<std::byte>> writer(staging_prefix_);
+    writer.begin_object();
+    writer.key("id").begin_object().field("txn", transaction_id()).field("atmpt", id()).end_object();
+    writer.key("atr")
+      .begin_object()
+      .field("id", atr_id_->key())
+      .field("bkt", atr_id_->bucket())
+      .field("scp", atr_id_->scope())
+      .field("coll", atr_id_->collection())
+      .end_object();
+}
+
 core::operations::mutate_in_request
 attempt_context_impl::create_staging_request(const core::document_id& id,
                                              const transaction_get_result* document,
                                              const std::string type,
-                                             std::optional<std::string> content)
+                                             const shared_content& content)
 {
     core::operations::mutate_in_request req{ id };
-    auto txn = nlohmann::json::object();
-    txn["id"] = nlohmann::json::object();
-    txn["id"]["txn"] = transaction_id();
-    txn["id"]["atmpt"] = this->id();
-    txn["atr"] = nlohmann::json::object();
-    txn["atr"]["id"] = atr_id();
-    txn["atr"]["bkt"] = atr_id_->bucket();
-    txn["atr"]["scp"] = atr_id_->scope();
-    txn["atr"]["coll"] = atr_id_->collection();
-    txn["op"] = nlohmann::json::object();
-    txn["op"]["type"] = type;
-
+    // only the op and restore blocks differ between documents, the rest was written when the atr was chosen.
+    std::vector<std::byte> txn;
+    txn.reserve(staging_prefix_.size() + 128);
+    txn.insert(txn.end(), staging_prefix_.begin(), staging_prefix_.end());
+    json_writer<std::vector<std::byte>> writer(txn, true);
+    writer.key("op").begin_object().field("type", type).end_object();
     if (document && document->metadata()) {
-        txn["restore"] = nlohmann::json::object();
-        if (document->metadata()->cas()) {
-            txn["restore"]["CAS"] = document->metadata()->cas().value();
+        const auto& metadata = *document->metadata();
+        writer.key("restore").begin_object();
+        if (auto cas = metadata.cas()) {
+            writer.field("CAS", *cas);
         }
-        if (document->metadata()->revid()) {
-            txn["restore"]["revid"] = document->metadata()->revid().value();
+        if (auto revid = metadata.revid()) {
+            writer.field("revid", *revid);
         }
-        if (document->metadata()->exptime()) {
-            txn["restore"]["exptime"] = document->metadata()->exptime().value();
+        if (auto exptime = metadata.exptime()) {
+            writer.field("exptime", static_cast<std::int64_t>(*exptime));
         }
+        writer.end_object();
     }
+    writer.end_object();
 
     auto mut_specs =
-      couchbase::mutate_in_specs(couchbase::mutate_in_specs::upsert_raw("txn", core::utils::to_binary(jsonify(txn))).xattr().create_path());
+      couchbase::mutate_in_specs(couchbase::mutate_in_specs::upsert_raw("txn", std::move(txn)).xattr().create_path());
     if (type != "remove") {
-        mut_specs.push_back(couchbase::mutate_in_specs::upsert_raw("txn.op.stgd", core::utils::to_binary(content.value())).xattr());
+        mut_specs.push_back(couchbase::mutate_in_specs::upsert_raw("txn.op.stgd", core::utils::to_binary(content.str())).xattr());
     }
     mut_specs.push_back(
       couchbase::mutate_in_specs::upsert("txn.op.crc32", couchbase::subdoc::mutate_in_macro::value_crc32c).xattr().create_path());
@@ -294,8 +376,11 @@ attempt_context_impl::replace_raw(const transaction_get_result& document, const
             check_and_handle_blocking_transactions(
               document,
               forward_compat_stage::WWC_REPLACING,
-              [this, existing_sm = std::move(existing_sm), document = std::move(document), cb = std::move(cb), content](
-                std::optional<transaction_operation_failed> err) {
+              [this,
+               existing_sm = std::move(existing_sm),
+               document = std::move(document),
+               cb = std::move(cb),
+               content = shared_content(content)](std::optional<transaction_operation_failed> err) {
                   if (err) {
                       return op_completed_with_error(cb, *err);
                   }
@@ -331,7 +416,7 @@ attempt_context_impl::replace_raw(const transaction_get_result& document, const
 
 template<typename Handler>
 void
-attempt_context_impl::create_staged_replace(const transaction_get_result& document, const std::string& content, Handler&& cb)
+attempt_context_impl::create_staged_replace(const transaction_get_result& document, const shared_content& content, Handler&& cb)
 {
     auto req = create_staging_request(document.id(), &document, "replace", content);
     req.cas = couchbase::cas(document.cas());
@@ -424,7 +509,7 @@ attempt_context_impl::insert_raw(const core::document_id& id, const std::string&
             }
             select_atr_if_needed_unlocked(
               id,
-              [this, existing_sm = std::move(existing_sm), cb = std::move(cb), id, content](
+              [this, existing_sm = std::move(existing_sm), cb = std::move(cb), id, content = shared_content(content)](
                 std::optional<transaction_operation_failed> err) {
                   if (err) {
                       return op_completed_with_error(cb, *err);
@@ -443,32 +528,189 @@ attempt_context_impl::insert_raw(const core::document_id& id, const std::string&
     });
 }
 
+std::vector<transaction_get_result>
+attempt_context_impl::insert_many_raw(std::vector<std::pair<core::document_id, std::string>>&& docs)
+{
+    auto barrier = std::make_shared<std::promise<std::vector<transaction_get_result>>>();
+    auto f = barrier->get_future();
+    insert_many_raw(std::move(docs), [barrier](std::exception_ptr err, std::optional<std::vector<transaction_get_result>> res) {
+        if (err) {
+            return barrier->set_exception(err);
+        }
+        barrier->set_value(std::move(*res));
+    });
+    return f.get();
+}
+
+void
+attempt_context_impl::insert_many_raw(std::vector<std::pair<core::document_id, std::string>>&& docs, MultiCallback&& cb)
+{
+    return stage_many<std::pair<core::document_id, std::string>>(
+      std::move(docs),
+      [this](const std::pair<core::document_id, std::string>& doc, Callback&& cb) { insert_raw(doc.first, doc.second, std::move(cb)); },
+      std::move(cb));
+}
+
+std::vector<transaction_get_result>
+attempt_context_impl::replace_many_raw(std::vector<std::pair<transaction_get_result, std::string>>&& docs)
+{
+    auto barrier = std::make_shared<std::promise<std::vector<transaction_get_result>>>();
+    auto f = barrier->get_future();
+    replace_many_raw(std::move(docs), [barrier](std::exception_ptr err, std::optional<std::vector<transaction_get_result>> res) {
+        if (err) {
+            return barrier->set_exception(err);
+        }
+        barrier->set_value(std::move(*res));
+    });
+    return f.get();
+}
+
+void
+attempt_context_impl::replace_many_raw(std::vector<std::pair<transaction_get_result, std::string>>&& docs, MultiCallback&& cb)
+{
+    return stage_many<std::pair<transaction_get_result, std::string>>(
+      std::move(docs),
+      [this](const std::pair<transaction_get_result, std::string>& doc, Callback&& cb) {
+          replace_raw(doc.first, doc.second, std::move(cb));
+      },
+      std::move(cb));
+}
+
+template<typename Item>
+void
+attempt_context_impl::stage_many(std::vector<Item>&& items, std::function<void(const Item&, Callback&&)>&& stage, MultiCallback&& cb)
+{
+    if (items.empty()) {
+        return cb({}, std::vector<transaction_get_result>());
+    }
+    struct stage_many_state {
+        std::vector<Item> items;
+        std::vector<std::optional<transaction_get_result>> results;
+        std::mutex mutex;
+        std::exception_ptr err;
+        std::function<void(const Item&, Callback&&)> stage;
+        MultiCallback cb;
+    };
+    auto state = std::make_shared<stage_many_state>();
+    state->items = std::move(items);
+    state->results.resize(state->items.size());
+    state->stage = std::move(stage);
+    state->cb = std::move(cb);
+
+    // Each item is staged by the single document operation, so it goes through the same error handling.  Here we just
+    // record the result, or the first error, and turn the error into what the windowed_executor expects.
+    auto stage_item = [state](const Item& item, std::function<void(std::optional<transaction_operation_failed>)>&& done) {
+        auto index = static_cast<size_t>(&item - state->items.data());
+        state->stage(item, [state, index, done = std::move(done)](std::exception_ptr err, std::optional<transaction_get_result> res) {
+            if (!err) {
+                state->results[index] = std::move(res);
+                return done(std::nullopt);
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->err) {
+                    state->err = err;
+                }
+            }
+            try {
+                std::rethrow_exception(err);
+            } catch (const transaction_operation_failed& e) {
+                done(e);
+            } catch (const std::exception& e) {
+                done(transaction_operation_failed(FAIL_OTHER, e.what()));
+            } catch (...) {
+                done(transaction_operation_failed(FAIL_OTHER, "unexpected error staging document"));
+            }
+        });
+    };
+    auto finish = [state](std::list<transaction_operation_failed>) {
+        if (state->err) {
+            return state->cb(state->err, std::nullopt);
+        }
+        std::vector<transaction_get_result> docs;
+        docs.reserve(state->results.size());
+        for (auto& doc : state->results) {
+            docs.push_back(std::move(*doc));
+        }
+        state->cb({}, std::move(docs));
+    };
+    // Query mode runs its statements one at a time.
+    auto window = op_list_.get_mode().is_query() ? 1 : overall_.config().staging_concurrency();
+    stage_item(state->items.front(), [state, stage_item, finish, window](std::optional<transaction_operation_failed> err) {
+        if (err) {
+            return finish({ *err });
+        }
+        // the ATR is pending now, so the rest can go concurrently.
+        windowed_executor<typename std::vector<Item>::iterator>::run(
+          std::next(state->items.begin()), state->items.end(), window, stage_item, finish);
+    });
+}
+
 void
 attempt_context_impl::select_atr_if_needed_unlocked(const core::document_id& id,
                                                     std::function<void(std::optional<transaction_operation_failed>)>&& cb)
 {
+    // once cb has been called, queued or passed on, it is for whoever has it to call
+    bool handed_off = false;
     try {
         std::unique_lock<std::mutex> lock(mutex_);
-        if (atr_id_) {
+        if (atr_pending_done_) {
             trace("atr exists, moving on");
-            return cb(std::nullopt);
+            auto err = atr_pending_error_;
+            lock.unlock();
+            handed_off = true;
+            return cb(err);
+        }
+        if (atr_id_) {
+            trace("atr is being set to pending, waiting for it");
+            handed_off = true;
+            atr_pending_waiters_.push_back(std::move(cb));
+            return;
         }
         size_t vbucket_id = 0;
         std::optional<const std::string> hook_atr = hooks_.random_atr_id_for_vbucket(this);
         if (hook_atr) {
             atr_id_ = overall_.config().atr_id_from_bucket_and_key(id.bucket(), hook_atr.value());
         } else {
-            vbucket_id = atr_ids::vbucket_for_key(id.key());
-            atr_id_ = overall_.config().atr_id_from_bucket_and_key(id.bucket(), atr_ids::atr_id_for_vbucket(vbucket_id));
+            vbucket_id = atr_ids::for_config(overall_.config()).vbucket_for_key(id.key());
+            atr_id_ = atr_selector::instance().select(overall_.config(), id.bucket(), vbucket_id, atr_lease_);
         }
         // TODO: cleanup the transaction_context - this should be set (threadsafe) from the above calls
         overall_.atr_collection(collection_spec_from_id(id));
         overall_.atr_id(atr_id_->key());
+        write_staging_prefix();
         state(attempt_state::NOT_STARTED);
         trace("first mutated doc in transaction is \"{}\" on vbucket {}, so using atr \"{}\"", id, vbucket_id, atr_id_.value());
-        set_atr_pending_locked(id, std::move(lock), cb);
+        // nothing else can get here now, so there is no need to hold the lock while we talk to the server.
+        lock.unlock();
+        handed_off = true;
+        set_atr_pending(id, [this, cb = std::move(cb)](std::optional<transaction_operation_failed> err) mutable {
+            atr_pending_completed(err, std::move(cb));
+        });
     } catch (const std::exception& e) {
-        error("unexpected error {} during select atr if needed");
+        error("unexpected error {} during select atr if needed", e.what());
+        if (handed_off) {
+            return;
+        }
+        // we never got as far as setting the ATR pending, so fail this op and any which queued up behind it
+        atr_pending_completed(transaction_operation_failed(FAIL_OTHER, e.what()), std::move(cb));
+    }
+}
+
+void
+attempt_context_impl::atr_pending_completed(std::optional<transaction_operation_failed> err,
+                                            std::function<void(std::optional<transaction_operation_failed>)>&& cb)
+{
+    std::list<std::function<void(std::optional<transaction_operation_failed>)>> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        atr_pending_done_ = true;
+        atr_pending_error_ = err;
+        waiters.swap(atr_pending_waiters_);
+    }
+    cb(err);
+    for (auto& waiter : waiters) {
+        waiter(err);
     }
 }
 template<typename Handler, typename Delay>
@@ -484,28 +726,25 @@ attempt_context_impl::check_atr_entry_for_blocking_document(const transaction_ge
                                  doc.links().atr_scope_name().value(),
                                  doc.links().atr_collection_name().value(),
                                  doc.links().atr_id().value());
-        active_transaction_record::get_atr(
+        atr_cache::instance().get_entry(
           cluster_ref(),
           atr_id,
-          [this, delay = std::move(delay), cb = std::move(cb), doc = std::move(doc)](std::error_code err,
-                                                                                     std::optional<active_transaction_record> atr) {
+          doc.links().staged_attempt_id().value(),
+          true,
+          [this, delay = std::move(delay), cb = std::move(cb), doc = std::move(doc)](std::error_code err, std::optional<atr_entry> entry) {
               if (!err) {
-                  auto entries = atr->entries();
-                  auto it = std::find_if(entries.begin(), entries.end(), [&doc](const atr_entry& e) {
-                      return e.attempt_id() == doc.links().staged_attempt_id();
-                  });
-                  if (it != entries.end()) {
-                      auto fwd_err = forward_compat::check(forward_compat_stage::WWC_READING_ATR, it->forward_compat());
+                  if (entry) {
+                      auto fwd_err = forward_compat::check(forward_compat_stage::WWC_READING_ATR, entry->forward_compat());
                       if (fwd_err) {
                           return cb(fwd_err);
                       }
-                      switch (it->state()) {
+                      switch (entry->state()) {
                           case attempt_state::COMPLETED:
                           case attempt_state::ROLLED_BACK:
-                              debug("existing atr entry can be ignored due to state {}", attempt_state_name(it->state()));
+                              debug("existing atr entry can be ignored due to state {}", attempt_state_name(entry->state()));
                               return cb(std::nullopt);
                           default:
-                              debug("existing atr entry found in state {}, retrying", attempt_state_name(it->state()));
+                              debug("existing atr entry found in state {}, retrying", attempt_state_name(entry->state()));
                       }
                       return check_atr_entry_for_blocking_document(doc, delay, cb);
                   } else {
@@ -596,7 +835,7 @@ attempt_context_impl::remove(const transaction_get_result& document, VoidCallbac
                               // TODO: this copy...  can we do better?
                               transaction_get_result new_res = document;
                               new_res.cas(resp.cas.value());
-                              staged_mutations_->add(staged_mutation(new_res, "", staged_mutation_type::REMOVE));
+                              staged_mutations_->add(staged_mutation(new_res, shared_content(), staged_mutation_type::REMOVE));
                               return op_completed_with_callback(cb);
                           }
                           return error_handler(*ec, resp.ctx.ec().message());
@@ -682,52 +921,55 @@ attempt_context_impl::query_begin_work(Handler&& cb)
 
     // construct the txn_data and query options for the existing transaction
     transaction_query_options opts;
-    auto txdata = nlohmann::json::object();
-    txdata["id"] = nlohmann::json::object();
-    txdata["id"]["atmpt"] = id();
-    txdata["id"]["txn"] = transaction_id();
-    txdata["state"] = nlohmann::json::object();
-    txdata["state"]["timeLeftMs"] = overall_.remaining().count() / 1000000;
-    txdata["config"] = nlohmann::json::object();
-    txdata["config"]["kvTimeoutMs"] =
-      overall_.config().kv_timeout() ? overall_.config().kv_timeout()->count() : core::timeout_defaults::key_value_durable_timeout.count();
-    txdata["config"]["numAtrs"] = 1024;
-    opts.raw("numatrs", jsonify(1024));
-    txdata["config"]["durabilityLevel"] = durability_level_to_string(overall_.config().durability_level());
+    std::string txdata;
+    json_writer<std::string> writer(txdata);
+    writer.begin_object();
+    writer.key("id").begin_object().field("atmpt", id()).field("txn", transaction_id()).end_object();
+    writer.key("state").begin_object().field("timeLeftMs", static_cast<std::int64_t>(overall_.remaining().count() / 1000000)).end_object();
+    writer.key("config")
+      .begin_object()
+      .field("kvTimeoutMs",
+             static_cast<std::int64_t>(overall_.config().kv_timeout() ? overall_.config().kv_timeout()->count()
+                                                                       : core::timeout_defaults::key_value_durable_timeout.count()))
+      .field("numAtrs", static_cast<std::int64_t>(overall_.config().num_atrs()))
+      .field("durabilityLevel", durability_level_to_string(overall_.config().durability_level()))
+      .end_object();
+    opts.raw("numatrs", jsonify(overall_.config().num_atrs()));
     opts.raw("durability_level", jsonify(durability_level_to_string_for_query(overall_.config().durability_level())));
     if (atr_id_) {
-        txdata["atr"] = nlohmann::json::object();
-        txdata["atr"]["scp"] = atr_id_->scope();
-        txdata["atr"]["coll"] = atr_id_->collection();
-        txdata["atr"]["bkt"] = atr_id_->bucket();
-        txdata["atr"]["id"] = atr_id_->key();
+        writer.key("atr")
+          .begin_object()
+          .field("scp", atr_id_->scope())
+          .field("coll", atr_id_->collection())
+          .field("bkt", atr_id_->bucket())
+          .field("id", atr_id_->key())
+          .end_object();
     } else if (overall_.config().custom_metadata_collection()) {
         auto id = overall_.config().atr_id_from_bucket_and_key("", "");
-        txdata["atr"] = nlohmann::json::object();
-        txdata["atr"]["scp"] = id.scope();
-        txdata["atr"]["coll"] = id.collection();
-        txdata["atr"]["bkt"] = id.bucket();
+        writer.key("atr").begin_object().field("scp", id.scope()).field("coll", id.collection()).field("bkt", id.bucket()).end_object();
         opts.raw("atrcollection", fmt::format("\"`{}`.`{}`.`{}`\"", id.bucket(), id.scope(), id.collection()));
     }
-    txdata["mutations"] = nlohmann::json::array();
-    if (!staged_mutations_->empty()) {
-        staged_mutations_->iterate([&txdata](staged_mutation& mut) {
-            auto obj = nlohmann::json::object();
-            obj["scp"] = mut.doc().id().scope();
-            obj["coll"] = mut.doc().id().collection();
-            obj["bkt"] = mut.doc().id().bucket();
-            obj["id"] = mut.doc().id().key();
-            obj["cas"] = std::to_string(mut.doc().cas());
-            obj["type"] = mut.type_as_string();
-            txdata["mutations"].push_back(obj);
-        });
-    }
+    writer.key("mutations").begin_array();
+    staged_mutations_->iterate([&writer](staged_mutation& mut) {
+        const auto& id = mut.doc().id();
+        char cas[24];
+        auto res = std::to_chars(cas, cas + sizeof(cas), mut.doc().cas());
+        writer.begin_object()
+          .field("scp", id.scope())
+          .field("coll", id.collection())
+          .field("bkt", id.bucket())
+          .field("id", id.key())
+          .field("cas", std::string_view(cas, static_cast<size_t>(res.ptr - cas)))
+          .field("type", mut.type_as_string())
+          .end_object();
+    });
+    writer.end_array().end_object();
     std::vector<core::json_string> params;
-    trace("begin_work using txdata: {}", txdata.dump());
+    trace("begin_work using txdata: {}", txdata);
     wrap_query(BEGIN_WORK,
                opts,
                params,
-               txdata,
+               std::move(txdata),
                STAGE_QUERY_BEGIN_WORK,
                true,
                [this, cb = std::move(cb)](std::exception_ptr err, core::operations::query_response resp) mutable {
@@ -858,6 +1100,18 @@ attempt_context_impl::wrap_query(const std::string& statement,
                                  const std::string& hook_point,
                                  bool check_expiry,
                                  std::function<void(std::exception_ptr, core::operations::query_response)>&& cb)
+{
+    wrap_query(statement, opts, params, txdata.empty() ? std::string() : txdata.dump(), hook_point, check_expiry, std::move(cb));
+}
+
+void
+attempt_context_impl::wrap_query(const std::string& statement,
+                                 const transaction_query_options& opts,
+                                 const std::vector<core::json_string>& params,
+                                 std::string txdata,
+                                 const std::string& hook_point,
+                                 bool check_expiry,
+                                 std::function<void(std::exception_ptr, core::operations::query_response)>&& cb)
 {
     auto req = opts.wrap_request(overall_);
     if (statement != BEGIN_WORK) {
@@ -884,7 +1138,7 @@ attempt_context_impl::wrap_query(const std::string& statement,
         req.raw["txid"] = jsonify(id());
     }
     if (!txdata.empty()) {
-        req.raw["txdata"] = txdata.dump();
+        req.raw["txdata"] = std::move(txdata);
     }
     req.statement = statement;
     if (auto ec = hooks_.before_query(this, statement)) {
@@ -1167,6 +1421,7 @@ attempt_context_impl::commit_with_query(VoidCallback&& cb)
                   return cb(std::make_exception_ptr(transaction_operation_failed(FAIL_OTHER, e.what()).no_rollback()));
               }
           }
+          overall_.current_attempt().unstaging_complete = true;
           state(attempt_state::COMPLETED);
           return cb({});
       });
@@ -1203,118 +1458,142 @@ attempt_context_impl::rollback_with_query(VoidCallback&& cb)
                });
 }
 void
-attempt_context_impl::atr_commit(bool ambiguity_resolution_mode)
+attempt_context_impl::atr_commit(bool ambiguity_resolution_mode, std::function<void(std::optional<transaction_operation_failed>)>&& cb)
 {
-    retry_op<void>([this, &ambiguity_resolution_mode]() {
-        try {
-            std::string prefix(ATR_FIELD_ATTEMPTS + "." + id() + ".");
-            core::operations::mutate_in_request req{ atr_id_.value() };
-            req.specs =
-              couchbase::mutate_in_specs{
-                  couchbase::mutate_in_specs::upsert(prefix + ATR_FIELD_STATUS, attempt_state_name(attempt_state::COMMITTED)).xattr(),
-                  couchbase::mutate_in_specs::upsert(prefix + ATR_FIELD_START_COMMIT, subdoc::mutate_in_macro::cas).xattr(),
-                  couchbase::mutate_in_specs::insert(prefix + ATR_FIELD_PREVENT_COLLLISION, 0).xattr(),
+    try {
+        std::string prefix(ATR_FIELD_ATTEMPTS + "." + id() + ".");
+        core::operations::mutate_in_request req{ atr_id_.value() };
+        req.specs =
+          couchbase::mutate_in_specs{
+              couchbase::mutate_in_specs::upsert(prefix + ATR_FIELD_STATUS, attempt_state_name(attempt_state::COMMITTED)).xattr(),
+              couchbase::mutate_in_specs::upsert(prefix + ATR_FIELD_START_COMMIT, subdoc::mutate_in_macro::cas).xattr(),
+              couchbase::mutate_in_specs::insert(prefix + ATR_FIELD_PREVENT_COLLLISION, 0).xattr(),
+          }
+            .specs();
+        wrap_durable_request(req, overall_.config());
+        auto ec = error_if_expired_and_not_in_overtime(STAGE_ATR_COMMIT, {});
+        if (ec) {
+            throw client_error(*ec, "atr_commit check for expiry threw error");
+        }
+        if (!!(ec = hooks_.before_atr_commit(this))) {
+            throw client_error(*ec, "before_atr_commit hook raised error");
+        }
+        auto chunks = staged_mutations_->extract_to(prefix, req, overall_.config().doc_list_chunk_size());
+        doc_list_chunks_ = chunks.size();
+        // the chunks must all be there before the entry says to look for them
+        doc_list_chunks::write(
+          overall_.cluster_ref(),
+          overall_.config(),
+          atr_id_.value(),
+          id(),
+          std::move(chunks),
+          [this, req = std::move(req), ambiguity_resolution_mode, cb = std::move(cb)](std::optional<client_error> err) mutable {
+              if (err) {
+                  return handle_atr_commit_error(*err, ambiguity_resolution_mode, std::move(cb));
               }
-                .specs();
-            wrap_durable_request(req, overall_.config());
-            auto ec = error_if_expired_and_not_in_overtime(STAGE_ATR_COMMIT, {});
-            if (ec) {
-                throw client_error(*ec, "atr_commit check for expiry threw error");
+              trace("updating atr {}", req.id);
+              overall_.atr_batcher().execute(
+                std::move(req),
+                false,
+                overall_.config().atr_group_commit_window(),
+                [this, ambiguity_resolution_mode, cb = std::move(cb)](core::operations::mutate_in_response resp) mutable {
+                    auto res = result::create_from_subdoc_response(resp);
+                    try {
+                        validate_operation_result(res, false);
+                        auto ec = hooks_.after_atr_commit(this);
+                        if (ec) {
+                            throw client_error(*ec, "after_atr_commit hook raised error");
+                        }
+                        state(attempt_state::COMMITTED);
+                    } catch (const client_error& e) {
+                        return handle_atr_commit_error(e, ambiguity_resolution_mode, std::move(cb));
+                    }
+                    cb(std::nullopt);
+                });
+          });
+    } catch (const client_error& e) {
+        return handle_atr_commit_error(e, ambiguity_resolution_mode, std::move(cb));
+    }
+}
+
+void
+attempt_context_impl::handle_atr_commit_error(const client_error& e,
+                                              bool ambiguity_resolution_mode,
+                                              std::function<void(std::optional<transaction_operation_failed>)>&& cb)
+{
+    error_class ec = e.ec();
+    switch (ec) {
+        case FAIL_EXPIRY: {
+            expiry_overtime_mode_ = true;
+            auto out = transaction_operation_failed(ec, e.what()).no_rollback();
+            if (ambiguity_resolution_mode) {
+                out.ambiguous();
+            } else {
+                out.expired();
             }
-            if (!!(ec = hooks_.before_atr_commit(this))) {
-                // for now, throw.  Later, if this is async, we will use error handler no doubt.
-                throw client_error(*ec, "before_atr_commit hook raised error");
+            return cb(out);
+        }
+        case FAIL_AMBIGUOUS:
+            debug("atr_commit got FAIL_AMBIGUOUS, resolving ambiguity...");
+            return overall_.retry_delay(DEFAULT_RETRY_OP_DELAY,
+                                        [this, cb = std::move(cb)]() mutable { atr_commit(true, std::move(cb)); });
+        case FAIL_TRANSIENT:
+            if (ambiguity_resolution_mode) {
+                return overall_.retry_delay(DEFAULT_RETRY_OP_DELAY,
+                                            [this, cb = std::move(cb)]() mutable { atr_commit(true, std::move(cb)); });
             }
-            staged_mutations_->extract_to(prefix, req);
-            auto barrier = std::make_shared<std::promise<result>>();
-            auto f = barrier->get_future();
-            trace("updating atr {}", req.id);
-            overall_.cluster_ref().execute(
-              req, [barrier](core::operations::mutate_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-            auto res = wrap_operation_future(f, false);
-            ec = hooks_.after_atr_commit(this);
-            if (ec) {
-                throw client_error(*ec, "after_atr_commit hook raised error");
+            return cb(transaction_operation_failed(ec, e.what()).retry());
+        case FAIL_PATH_ALREADY_EXISTS:
+            return atr_commit_ambiguity_resolution(std::move(cb));
+        case FAIL_HARD: {
+            auto out = transaction_operation_failed(ec, e.what()).no_rollback();
+            if (ambiguity_resolution_mode) {
+                out.ambiguous();
             }
-            state(attempt_state::COMMITTED);
-        } catch (const client_error& e) {
-            error_class ec = e.ec();
-            switch (ec) {
-                case FAIL_EXPIRY: {
-                    expiry_overtime_mode_ = true;
-                    auto out = transaction_operation_failed(ec, e.what()).no_rollback();
-                    if (ambiguity_resolution_mode) {
-                        out.ambiguous();
-                    } else {
-                        out.expired();
-                    }
-                    throw out;
-                }
-                case FAIL_AMBIGUOUS:
-                    debug("atr_commit got FAIL_AMBIGUOUS, resolving ambiguity...");
-                    ambiguity_resolution_mode = true;
-                    throw retry_operation(e.what());
-                case FAIL_TRANSIENT:
-                    if (ambiguity_resolution_mode) {
-                        throw retry_operation(e.what());
-                    }
-                    throw transaction_operation_failed(ec, e.what()).retry();
-
-                case FAIL_PATH_ALREADY_EXISTS:
-                    // Need retry_op as atr_commit_ambiguity_resolution can throw retry_operation
-                    return retry_op<void>([&]() { return atr_commit_ambiguity_resolution(); });
-                case FAIL_HARD: {
-                    auto out = transaction_operation_failed(ec, e.what()).no_rollback();
-                    if (ambiguity_resolution_mode) {
-                        out.ambiguous();
-                    }
-                    throw out;
-                }
-                case FAIL_DOC_NOT_FOUND: {
-                    auto out = transaction_operation_failed(ec, e.what())
-                                 .cause(external_exception::ACTIVE_TRANSACTION_RECORD_NOT_FOUND)
-                                 .no_rollback();
-                    if (ambiguity_resolution_mode) {
-                        out.ambiguous();
-                    }
-                    throw out;
-                }
-                case FAIL_PATH_NOT_FOUND: {
-                    auto out = transaction_operation_failed(ec, e.what())
-                                 .cause(external_exception::ACTIVE_TRANSACTION_RECORD_ENTRY_NOT_FOUND)
-                                 .no_rollback();
-                    if (ambiguity_resolution_mode) {
-                        out.ambiguous();
-                    }
-                    throw out;
-                }
-                case FAIL_ATR_FULL: {
-                    auto out =
-                      transaction_operation_failed(ec, e.what()).cause(external_exception::ACTIVE_TRANSACTION_RECORD_FULL).no_rollback();
-                    if (ambiguity_resolution_mode) {
-                        out.ambiguous();
-                    }
-                    throw out;
-                }
-                default: {
-                    error("failed to commit transaction {}, attempt {}, ambiguity_resolution_mode {}, with error {}",
-                          transaction_id(),
-                          id(),
-                          ambiguity_resolution_mode,
-                          e.what());
-                    auto out = transaction_operation_failed(ec, e.what());
-                    if (ambiguity_resolution_mode) {
-                        out.no_rollback().ambiguous();
-                    }
-                    throw out;
-                }
+            return cb(out);
+        }
+        case FAIL_DOC_NOT_FOUND: {
+            auto out =
+              transaction_operation_failed(ec, e.what()).cause(external_exception::ACTIVE_TRANSACTION_RECORD_NOT_FOUND).no_rollback();
+            if (ambiguity_resolution_mode) {
+                out.ambiguous();
             }
+            return cb(out);
         }
-    });
+        case FAIL_PATH_NOT_FOUND: {
+            auto out = transaction_operation_failed(ec, e.what())
+                         .cause(external_exception::ACTIVE_TRANSACTION_RECORD_ENTRY_NOT_FOUND)
+                         .no_rollback();
+            if (ambiguity_resolution_mode) {
+                out.ambiguous();
+            }
+            return cb(out);
+        }
+        case FAIL_ATR_FULL: {
+            atr_selector::instance().mark_full(atr_id_.value());
+            auto out = transaction_operation_failed(ec, e.what()).cause(external_exception::ACTIVE_TRANSACTION_RECORD_FULL).no_rollback();
+            if (ambiguity_resolution_mode) {
+                out.ambiguous();
+            }
+            return cb(out);
+        }
+        default: {
+            error("failed to commit transaction {}, attempt {}, ambiguity_resolution_mode {}, with error {}",
+                  transaction_id(),
+                  id(),
+                  ambiguity_resolution_mode,
+                  e.what());
+            auto out = transaction_operation_failed(ec, e.what());
+            if (ambiguity_resolution_mode) {
+                out.no_rollback().ambiguous();
+            }
+            return cb(out);
+        }
+    }
 }
 
 void
-attempt_context_impl::atr_commit_ambiguity_resolution()
+attempt_context_impl::atr_commit_ambiguity_resolution(std::function<void(std::optional<transaction_operation_failed>)>&& cb)
 {
     try {
         auto ec = error_if_expired_and_not_in_overtime(STAGE_ATR_COMMIT_AMBIGUITY_RESOLUTION, {});
@@ -1328,50 +1607,74 @@ attempt_context_impl::atr_commit_ambiguity_resolution()
         core::operations::lookup_in_request req{ atr_id_.value() };
         req.specs = lookup_in_specs{ lookup_in_specs::get(prefix + ATR_FIELD_STATUS).xattr() }.specs();
         wrap_request(req, overall_.config());
-        auto barrier = std::make_shared<std::promise<result>>();
-        auto f = barrier->get_future();
-        overall_.cluster_ref().execute(
-          req, [barrier](core::operations::lookup_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-        auto res = wrap_operation_future(f);
-        auto atr_status_raw = res.values[0].content_as<std::string>();
-        debug("atr_commit_ambiguity_resolution read atr state {}", atr_status_raw);
-        auto atr_status = attempt_state_value(atr_status_raw);
-        switch (atr_status) {
-            case attempt_state::COMMITTED:
-                return;
-            case attempt_state::ABORTED:
-                // aborted by another process?
-                throw transaction_operation_failed(FAIL_OTHER, "transaction aborted externally").retry();
-            default:
-                throw transaction_operation_failed(FAIL_OTHER, "unexpected state found on ATR ambiguity resolution")
-                  .cause(ILLEGAL_STATE_EXCEPTION)
-                  .no_rollback();
-        }
+        overall_.cluster_ref().execute(req, [this, cb = std::move(cb)](core::operations::lookup_in_response resp) mutable {
+            auto res = result::create_from_subdoc_response(resp);
+            attempt_state atr_status;
+            try {
+                validate_operation_result(res);
+                auto atr_status_raw = res.values[0].content_as<std::string>();
+                debug("atr_commit_ambiguity_resolution read atr state {}", atr_status_raw);
+                atr_status = attempt_state_value(atr_status_raw);
+            } catch (const client_error& e) {
+                return handle_atr_commit_ambiguity_resolution_error(e, std::move(cb));
+            } catch (const std::exception& e) {
+                return cb(transaction_operation_failed(FAIL_OTHER, e.what()).no_rollback().ambiguous());
+            }
+            switch (atr_status) {
+                case attempt_state::COMMITTED:
+                    return cb(std::nullopt);
+                case attempt_state::ABORTED:
+                    // aborted by another process?
+                    return cb(transaction_operation_failed(FAIL_OTHER, "transaction aborted externally").retry());
+                default:
+                    return cb(transaction_operation_failed(FAIL_OTHER, "unexpected state found on ATR ambiguity resolution")
+                                .cause(ILLEGAL_STATE_EXCEPTION)
+                                .no_rollback());
+            }
+        });
     } catch (const client_error& e) {
-        error_class ec = e.ec();
-        switch (ec) {
-            case FAIL_EXPIRY:
-                throw transaction_operation_failed(ec, e.what()).no_rollback().ambiguous();
-            case FAIL_HARD:
-                throw transaction_operation_failed(ec, e.what()).no_rollback().ambiguous();
-            case FAIL_TRANSIENT:
-            case FAIL_OTHER:
-                throw retry_operation(e.what());
-            case FAIL_PATH_NOT_FOUND:
-                throw transaction_operation_failed(ec, e.what()).cause(ACTIVE_TRANSACTION_RECORD_ENTRY_NOT_FOUND).no_rollback().ambiguous();
-            case FAIL_DOC_NOT_FOUND:
-                throw transaction_operation_failed(ec, e.what()).cause(ACTIVE_TRANSACTION_RECORD_NOT_FOUND).no_rollback().ambiguous();
-            default:
-                throw transaction_operation_failed(ec, e.what()).no_rollback().ambiguous();
-        }
+        return handle_atr_commit_ambiguity_resolution_error(e, std::move(cb));
+    }
+}
+
+void
+attempt_context_impl::handle_atr_commit_ambiguity_resolution_error(const client_error& e,
+                                                                   std::function<void(std::optional<transaction_operation_failed>)>&& cb)
+{
+    error_class ec = e.ec();
+    switch (ec) {
+        case FAIL_EXPIRY:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().ambiguous());
+        case FAIL_HARD:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().ambiguous());
+        case FAIL_TRANSIENT:
+        case FAIL_OTHER:
+            return overall_.retry_delay(DEFAULT_RETRY_OP_DELAY,
+                                        [this, cb = std::move(cb)]() mutable { atr_commit_ambiguity_resolution(std::move(cb)); });
+        case FAIL_PATH_NOT_FOUND:
+            return cb(
+              transaction_operation_failed(ec, e.what()).cause(ACTIVE_TRANSACTION_RECORD_ENTRY_NOT_FOUND).no_rollback().ambiguous());
+        case FAIL_DOC_NOT_FOUND:
+            return cb(transaction_operation_failed(ec, e.what()).cause(ACTIVE_TRANSACTION_RECORD_NOT_FOUND).no_rollback().ambiguous());
+        default:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().ambiguous());
     }
 }
 
 void
-attempt_context_impl::atr_complete()
+attempt_context_impl::atr_complete(std::function<void(std::optional<transaction_operation_failed>)>&& cb)
 {
+    auto error_handler = [this](const client_error& er) -> std::optional<transaction_operation_failed> {
+        error_class ec = er.ec();
+        switch (ec) {
+            case FAIL_HARD:
+                return transaction_operation_failed(ec, er.what()).no_rollback().failed_post_commit();
+            default:
+                info("ignoring error in atr_complete {}", er.what());
+                return std::nullopt;
+        }
+    };
     try {
-        result atr_res;
         auto ec = hooks_.before_atr_complete(this);
         if (ec) {
             throw client_error(*ec, "before_atr_complete hook threw error");
@@ -1389,86 +1692,169 @@ attempt_context_impl::atr_complete()
           }
             .specs();
         wrap_durable_request(req, overall_.config());
-        auto barrier = std::make_shared<std::promise<result>>();
-        auto f = barrier->get_future();
-        overall_.cluster_ref().execute(
-          req, [barrier](core::operations::mutate_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-        wrap_operation_future(f);
-        ec = hooks_.after_atr_complete(this);
-        if (ec) {
-            throw client_error(*ec, "after_atr_complete hook threw error");
-        }
-        state(attempt_state::COMPLETED);
+        // the chunks go first: were the entry to go first, and we fail in between, nothing would know they were there.
+        doc_list_chunks::remove(
+          overall_.cluster_ref(),
+          overall_.config(),
+          overall_.config().durability_level(),
+          atr_id_.value(),
+          id(),
+          doc_list_chunks_,
+          [this, req = std::move(req), error_handler, cb = std::move(cb)](std::optional<client_error> err) mutable {
+              if (err) {
+                  return cb(error_handler(*err));
+              }
+              overall_.atr_batcher().execute(
+                std::move(req),
+                false,
+                overall_.config().atr_group_commit_window(),
+                [this, error_handler, cb = std::move(cb)](core::operations::mutate_in_response resp) mutable {
+                    auto res = result::create_from_subdoc_response(resp);
+                    try {
+                        validate_operation_result(res);
+                        auto ec = hooks_.after_atr_complete(this);
+                        if (ec) {
+                            throw client_error(*ec, "after_atr_complete hook threw error");
+                        }
+                        state(attempt_state::COMPLETED);
+                    } catch (const client_error& er) {
+                        return cb(error_handler(er));
+                    }
+                    cb(std::nullopt);
+                });
+          });
     } catch (const client_error& er) {
-        error_class ec = er.ec();
-        switch (ec) {
-            case FAIL_HARD:
-                throw transaction_operation_failed(ec, er.what()).no_rollback().failed_post_commit();
-            default:
-                info("ignoring error in atr_complete {}", er.what());
-        }
+        return cb(error_handler(er));
     }
 }
+
+void
+attempt_context_impl::defer_atr_complete()
+{
+    std::string prefix(ATR_FIELD_ATTEMPTS + "." + id());
+    core::operations::mutate_in_request req{ atr_id_.value() };
+    req.specs =
+      couchbase::mutate_in_specs{
+          couchbase::mutate_in_specs::remove(prefix).xattr(),
+      }
+        .specs();
+    wrap_durable_request(req, overall_.config());
+    debug("leaving removal of attempt {} from atr {} to the background", id(), atr_id_.value());
+    // we write nothing more to the ATR ourselves
+    atr_lease_.reset();
+    auto& batcher = overall_.atr_batcher();
+    auto& background_ops = overall_.background_ops();
+    try {
+        background_ops.increment_ops();
+    } catch (const async_operation_conflict&) {
+        txn_log->info("leaving entry in atr {} for lost attempts cleanup: transactions are closing", req.id);
+        return;
+    }
+    auto window = std::max<std::chrono::microseconds>(overall_.config().atr_group_commit_window(), DEFERRED_ATR_COMPLETE_WINDOW);
+    // this attempt may well be gone before these run, so they must not refer to it - but the transactions object waits for
+    // them before it closes, so they can refer to what it owns
+    doc_list_chunks::remove(
+      overall_.cluster_ref(),
+      overall_.config(),
+      overall_.config().durability_level(),
+      atr_id_.value(),
+      id(),
+      doc_list_chunks_,
+      [&batcher, &background_ops, window, req = std::move(req)](std::optional<client_error> err) mutable {
+          if (err) {
+              txn_log->info("leaving entry in atr {} for lost attempts cleanup: {}", req.id, err->what());
+              return background_ops.decrement_ops();
+          }
+          batcher.execute(std::move(req), false, window, [&background_ops](core::operations::mutate_in_response resp) {
+              auto ec = error_class_from_response(resp);
+              // not found means cleanup got there first
+              if (ec && *ec != FAIL_PATH_NOT_FOUND && *ec != FAIL_DOC_NOT_FOUND) {
+                  txn_log->info("leaving entry in atr {} for lost attempts cleanup: removing it failed with {}",
+                                resp.ctx.id(),
+                                resp.ctx.ec().message());
+              }
+              background_ops.decrement_ops();
+          });
+      });
+}
+
 void
 attempt_context_impl::commit(VoidCallback&& cb)
 {
-    // for now, lets keep the blocking implementation
-    std::thread t([cb = std::move(cb), this]() mutable {
+    debug("waiting on ops to finish...");
+    op_list_.wait_and_block_ops([this, cb = std::move(cb)]() mutable {
+        auto on_error = [cb](std::optional<transaction_operation_failed> err) {
+            if (err) {
+                return cb(std::make_exception_ptr(*err));
+            }
+            cb({});
+        };
         try {
-            commit();
-            return cb({});
+            existing_error();
+            debug("commit {}", id());
+            if (op_list_.get_mode().is_query()) {
+                return commit_with_query(std::move(cb));
+            }
+            if (check_expiry_pre_commit(STAGE_BEFORE_COMMIT, {})) {
+                return on_error(transaction_operation_failed(FAIL_EXPIRY, "transaction expired").expired());
+            }
+            if (!atr_id_ || atr_id_->key().empty() || is_done_) {
+                // no mutation, no need to commit
+                if (!is_done_) {
+                    debug("calling commit on attempt that has got no mutations, skipping");
+                    is_done_ = true;
+                    return on_error(std::nullopt);
+                }
+                // do not rollback or retry
+                return on_error(
+                  transaction_operation_failed(FAIL_OTHER, "calling commit on attempt that is already completed").no_rollback());
+            }
         } catch (const transaction_operation_failed& e) {
-            return cb(std::current_exception());
+            return on_error(e);
         } catch (const std::exception& e) {
-            return cb(std::make_exception_ptr(transaction_operation_failed(FAIL_OTHER, e.what())));
+            return on_error(transaction_operation_failed(FAIL_OTHER, e.what()));
         }
+        atr_commit(false, [this, on_error](std::optional<transaction_operation_failed> err) {
+            if (err) {
+                return on_error(err);
+            }
+            staged_mutations_->commit(*this, [this, on_error](std::optional<transaction_operation_failed> err) {
+                if (err) {
+                    return on_error(err);
+                }
+                overall_.current_attempt().unstaging_complete = true;
+                if (overall_.config().defer_atr_complete()) {
+                    defer_atr_complete();
+                    is_done_ = true;
+                    return on_error(std::nullopt);
+                }
+                atr_complete([this, on_error](std::optional<transaction_operation_failed> err) {
+                    if (!err) {
+                        is_done_ = true;
+                    }
+                    on_error(err);
+                });
+            });
+        });
     });
-    t.detach();
 }
 
 void
 attempt_context_impl::commit()
 {
-    debug("waiting on ops to finish...");
-    op_list_.wait_and_block_ops();
-    existing_error();
-    debug("commit {}", id());
-    if (op_list_.get_mode().is_query()) {
-        auto barrier = std::make_shared<std::promise<void>>();
-        auto f = barrier->get_future();
-        commit_with_query([barrier](std::exception_ptr err) {
-            if (err) {
-                barrier->set_exception(err);
-            } else {
-                barrier->set_value();
-            }
-        });
-        f.get();
-    } else {
-        if (check_expiry_pre_commit(STAGE_BEFORE_COMMIT, {})) {
-            throw transaction_operation_failed(FAIL_EXPIRY, "transaction expired").expired();
-        }
-        if (atr_id_ && !atr_id_->key().empty() && !is_done_) {
-            retry_op_exp<void>([&]() { atr_commit(false); });
-            staged_mutations_->commit(*this);
-            atr_complete();
-            is_done_ = true;
-        } else {
-            // no mutation, no need to commit
-            if (!is_done_) {
-                debug("calling commit on attempt that has got no mutations, skipping");
-                is_done_ = true;
-                return;
-            } else {
-                // do not rollback or retry
-                throw transaction_operation_failed(FAIL_OTHER, "calling commit on attempt that is already completed").no_rollback();
-            }
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    commit([barrier](std::exception_ptr err) {
+        if (err) {
+            return barrier->set_exception(err);
         }
-    }
+        barrier->set_value();
+    });
+    f.get();
 }
 
 void
-attempt_context_impl::atr_abort()
+attempt_context_impl::atr_abort(size_t retries, std::function<void(std::optional<transaction_operation_failed>)>&& cb)
 {
     try {
         auto ec = error_if_expired_and_not_in_overtime(STAGE_ATR_ABORT, {});
@@ -1490,49 +1876,85 @@ attempt_context_impl::atr_abort()
                 .create_path(),
           }
             .specs();
-        staged_mutations_->extract_to(prefix, req);
+        auto chunks = staged_mutations_->extract_to(prefix, req, overall_.config().doc_list_chunk_size());
+        doc_list_chunks_ = chunks.size();
         wrap_durable_request(req, overall_.config());
-        auto barrier = std::make_shared<std::promise<result>>();
-        auto f = barrier->get_future();
-        overall_.cluster_ref().execute(
-          req, [barrier](core::operations::mutate_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-        wrap_operation_future(f);
-        state(attempt_state::ABORTED);
-        ec = hooks_.after_atr_aborted(this);
-        if (ec) {
-            throw client_error(*ec, "after_atr_aborted hook threw error");
-        }
-        debug("rollback completed atr abort phase");
+        doc_list_chunks::write(
+          overall_.cluster_ref(),
+          overall_.config(),
+          atr_id_.value(),
+          id(),
+          std::move(chunks),
+          [this, req = std::move(req), retries, cb = std::move(cb)](std::optional<client_error> err) mutable {
+              if (err) {
+                  return handle_atr_abort_error(*err, retries, std::move(cb));
+              }
+              overall_.atr_batcher().execute(
+                std::move(req),
+                false,
+                overall_.config().atr_group_commit_window(),
+                [this, retries, cb = std::move(cb)](core::operations::mutate_in_response resp) mutable {
+                  auto res = result::create_from_subdoc_response(resp);
+                  try {
+                      validate_operation_result(res);
+                      state(attempt_state::ABORTED);
+                      auto ec = hooks_.after_atr_aborted(this);
+                      if (ec) {
+                          throw client_error(*ec, "after_atr_aborted hook threw error");
+                      }
+                      debug("rollback completed atr abort phase");
+                  } catch (const client_error& e) {
+                      return handle_atr_abort_error(e, retries, std::move(cb));
+                  }
+                  cb(std::nullopt);
+              });
+          });
     } catch (const client_error& e) {
-        auto ec = e.ec();
-        trace("atr_abort got {} {}", ec, e.what());
-        if (expiry_overtime_mode_.load()) {
-            debug("atr_abort got error {} while in overtime mode", e.what());
-            throw transaction_operation_failed(FAIL_EXPIRY, std::string("expired in atr_abort with {} ") + e.what())
-              .no_rollback()
-              .expired();
-        }
-        debug("atr_abort got error {}", ec);
-        switch (ec) {
-            case FAIL_EXPIRY:
-                expiry_overtime_mode_ = true;
-                throw retry_operation("expired, setting overtime mode and retry atr_abort");
-            case FAIL_PATH_NOT_FOUND:
-                throw transaction_operation_failed(ec, e.what()).no_rollback().cause(ACTIVE_TRANSACTION_RECORD_ENTRY_NOT_FOUND);
-            case FAIL_DOC_NOT_FOUND:
-                throw transaction_operation_failed(ec, e.what()).no_rollback().cause(ACTIVE_TRANSACTION_RECORD_NOT_FOUND);
-            case FAIL_ATR_FULL:
-                throw transaction_operation_failed(ec, e.what()).no_rollback().cause(ACTIVE_TRANSACTION_RECORD_FULL);
-            case FAIL_HARD:
-                throw transaction_operation_failed(ec, e.what()).no_rollback();
-            default:
-                throw retry_operation("retry atr_abort");
+        return handle_atr_abort_error(e, retries, std::move(cb));
+    }
+}
+
+void
+attempt_context_impl::handle_atr_abort_error(const client_error& e,
+                                             size_t retries,
+                                             std::function<void(std::optional<transaction_operation_failed>)>&& cb)
+{
+    auto ec = e.ec();
+    trace("atr_abort got {} {}", ec, e.what());
+    if (expiry_overtime_mode_.load()) {
+        debug("atr_abort got error {} while in overtime mode", e.what());
+        return cb(
+          transaction_operation_failed(FAIL_EXPIRY, std::string("expired in atr_abort with {} ") + e.what()).no_rollback().expired());
+    }
+    debug("atr_abort got error {}", ec);
+    auto retry = [this, retries, &cb]() {
+        if (retries >= DEFAULT_RETRY_OP_MAX_RETRIES) {
+            return cb(transaction_operation_failed(FAIL_OTHER, "retries exhausted in atr_abort").no_rollback());
         }
+        overall_.retry_delay(retry_op_exp_delay(retries),
+                             [this, retries, cb = std::move(cb)]() mutable { atr_abort(retries + 1, std::move(cb)); });
+    };
+    switch (ec) {
+        case FAIL_EXPIRY:
+            expiry_overtime_mode_ = true;
+            debug("expired, setting overtime mode and retry atr_abort");
+            return retry();
+        case FAIL_PATH_NOT_FOUND:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().cause(ACTIVE_TRANSACTION_RECORD_ENTRY_NOT_FOUND));
+        case FAIL_DOC_NOT_FOUND:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().cause(ACTIVE_TRANSACTION_RECORD_NOT_FOUND));
+        case FAIL_ATR_FULL:
+            atr_selector::instance().mark_full(atr_id_.value());
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().cause(ACTIVE_TRANSACTION_RECORD_FULL));
+        case FAIL_HARD:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback());
+        default:
+            return retry();
     }
 }
 
 void
-attempt_context_impl::atr_rollback_complete()
+attempt_context_impl::atr_rollback_complete(size_t retries, std::function<void(std::optional<transaction_operation_failed>)>&& cb)
 {
     try {
         auto ec = error_if_expired_and_not_in_overtime(STAGE_ATR_ROLLBACK_COMPLETE, std::nullopt);
@@ -1550,116 +1972,148 @@ attempt_context_impl::atr_rollback_complete()
           }
             .specs();
         wrap_durable_request(req, overall_.config());
-        auto barrier = std::make_shared<std::promise<result>>();
-        auto f = barrier->get_future();
-        overall_.cluster_ref().execute(
-          req, [barrier](core::operations::mutate_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-        wrap_operation_future(f);
-        state(attempt_state::ROLLED_BACK);
-        ec = hooks_.after_atr_rolled_back(this);
-        if (ec) {
-            throw client_error(*ec, "after_atr_rolled_back hook threw error");
-        }
-        is_done_ = true;
-
+        // as in atr_complete, the chunks go first
+        doc_list_chunks::remove(
+          overall_.cluster_ref(),
+          overall_.config(),
+          overall_.config().durability_level(),
+          atr_id_.value(),
+          id(),
+          doc_list_chunks_,
+          [this, req = std::move(req), retries, cb = std::move(cb)](std::optional<client_error> err) mutable {
+              if (err) {
+                  return handle_atr_rollback_complete_error(*err, retries, std::move(cb));
+              }
+              overall_.atr_batcher().execute(
+                std::move(req),
+                false,
+                overall_.config().atr_group_commit_window(),
+                [this, retries, cb = std::move(cb)](core::operations::mutate_in_response resp) mutable {
+                  auto res = result::create_from_subdoc_response(resp);
+                  try {
+                      validate_operation_result(res);
+                      state(attempt_state::ROLLED_BACK);
+                      auto ec = hooks_.after_atr_rolled_back(this);
+                      if (ec) {
+                          throw client_error(*ec, "after_atr_rolled_back hook threw error");
+                      }
+                      is_done_ = true;
+                  } catch (const client_error& e) {
+                      return handle_atr_rollback_complete_error(e, retries, std::move(cb));
+                  }
+                  cb(std::nullopt);
+              });
+          });
     } catch (const client_error& e) {
-        auto ec = e.ec();
-        if (expiry_overtime_mode_.load()) {
-            debug("atr_rollback_complete error while in overtime mode {}", e.what());
-            throw transaction_operation_failed(FAIL_EXPIRY, std::string("expired in atr_rollback_complete with {} ") + e.what())
-              .no_rollback()
-              .expired();
-        }
-        debug("atr_rollback_complete got error {}", ec);
-        switch (ec) {
-            case FAIL_DOC_NOT_FOUND:
-            case FAIL_PATH_NOT_FOUND:
-                debug("atr {} not found, ignoring", atr_id_->key());
-                is_done_ = true;
-                break;
-            case FAIL_ATR_FULL:
-                debug("atr {} full!", atr_id_->key());
-                throw retry_operation(e.what());
-            case FAIL_HARD:
-                throw transaction_operation_failed(ec, e.what()).no_rollback();
-            case FAIL_EXPIRY:
-                debug("timed out writing atr {}", atr_id_->key());
-                throw transaction_operation_failed(ec, e.what()).no_rollback().expired();
-            default:
-                debug("retrying atr_rollback_complete");
-                throw retry_operation(e.what());
+        return handle_atr_rollback_complete_error(e, retries, std::move(cb));
+    }
+}
+
+void
+attempt_context_impl::handle_atr_rollback_complete_error(const client_error& e,
+                                                         size_t retries,
+                                                         std::function<void(std::optional<transaction_operation_failed>)>&& cb)
+{
+    auto ec = e.ec();
+    if (expiry_overtime_mode_.load()) {
+        debug("atr_rollback_complete error while in overtime mode {}", e.what());
+        return cb(transaction_operation_failed(FAIL_EXPIRY, std::string("expired in atr_rollback_complete with {} ") + e.what())
+                    .no_rollback()
+                    .expired());
+    }
+    debug("atr_rollback_complete got error {}", ec);
+    auto retry = [this, retries, &cb]() {
+        if (retries >= DEFAULT_RETRY_OP_MAX_RETRIES) {
+            return cb(transaction_operation_failed(FAIL_OTHER, "retries exhausted in atr_rollback_complete").no_rollback());
         }
+        overall_.retry_delay(retry_op_exp_delay(retries),
+                             [this, retries, cb = std::move(cb)]() mutable { atr_rollback_complete(retries + 1, std::move(cb)); });
+    };
+    switch (ec) {
+        case FAIL_DOC_NOT_FOUND:
+        case FAIL_PATH_NOT_FOUND:
+            debug("atr {} not found, ignoring", atr_id_->key());
+            is_done_ = true;
+            return cb(std::nullopt);
+        case FAIL_ATR_FULL:
+            debug("atr {} full!", atr_id_->key());
+            return retry();
+        case FAIL_HARD:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback());
+        case FAIL_EXPIRY:
+            debug("timed out writing atr {}", atr_id_->key());
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().expired());
+        default:
+            debug("retrying atr_rollback_complete");
+            return retry();
     }
 }
+
 void
 attempt_context_impl::rollback(VoidCallback&& cb)
 {
-    // for now, lets keep the blocking implementation
-    std::thread t([cb = std::move(cb), this]() mutable {
-        if (op_list_.get_mode().is_query()) {
-            return rollback_with_query(std::move(cb));
-        }
+    op_list_.wait_and_block_ops([this, cb = std::move(cb)]() mutable {
+        auto on_error = [cb](std::optional<transaction_operation_failed> err) {
+            if (err) {
+                return cb(std::make_exception_ptr(*err));
+            }
+            cb({});
+        };
+        // this may be running in the callback of the last op to complete, which must not see it throw
         try {
-            rollback();
-            return cb({});
+            debug("rolling back {}", id());
+            if (op_list_.get_mode().is_query()) {
+                return rollback_with_query(std::move(cb));
+            }
+            // check for expiry
+            check_expiry_during_commit_or_rollback(STAGE_ROLLBACK, std::nullopt);
+            if (!atr_id_ || atr_id_->key().empty() || state() == attempt_state::NOT_STARTED) {
+                // TODO: check this, but if we try to rollback an empty txn, we should prevent a subsequent commit
+                debug("rollback called on txn with no mutations");
+                is_done_ = true;
+                return on_error(std::nullopt);
+            }
+            if (is_done()) {
+                std::string msg("Transaction already done, cannot rollback");
+                error(msg);
+                // need to raise a FAIL_OTHER which is not retryable or rollback-able
+                return on_error(transaction_operation_failed(FAIL_OTHER, msg).no_rollback());
+            }
         } catch (const transaction_operation_failed& e) {
-            return cb(std::current_exception());
+            return on_error(e);
         } catch (const std::exception& e) {
-            return cb(std::make_exception_ptr(transaction_operation_failed(FAIL_OTHER, e.what()).no_rollback()));
-        } catch (...) {
-            return cb(std::make_exception_ptr(transaction_operation_failed(FAIL_OTHER, "unexpected exception during rollback")));
+            return on_error(transaction_operation_failed(FAIL_OTHER, e.what()));
         }
+        // (1) atr_abort
+        atr_abort(0, [this, on_error](std::optional<transaction_operation_failed> err) {
+            if (err) {
+                return on_error(err);
+            }
+            // (2) rollback staged mutations
+            staged_mutations_->rollback(*this, [this, on_error](std::optional<transaction_operation_failed> err) {
+                if (err) {
+                    return on_error(err);
+                }
+                debug("rollback completed unstaging docs");
+                // (3) atr_rollback
+                atr_rollback_complete(0, on_error);
+            });
+        });
     });
-    t.detach();
 }
 
 void
 attempt_context_impl::rollback()
 {
-    op_list_.wait_and_block_ops();
-    debug("rolling back {}", id());
-    if (op_list_.get_mode().is_query()) {
-        auto barrier = std::make_shared<std::promise<void>>();
-        auto f = barrier->get_future();
-        rollback_with_query([barrier](std::exception_ptr err) {
-            if (err) {
-                barrier->set_exception(err);
-            } else {
-                barrier->set_value();
-            }
-        });
-        return f.get();
-    }
-    // check for expiry
-    check_expiry_during_commit_or_rollback(STAGE_ROLLBACK, std::nullopt);
-    if (!atr_id_ || atr_id_->key().empty() || state() == attempt_state::NOT_STARTED) {
-        // TODO: check this, but if we try to rollback an empty txn, we should prevent a subsequent commit
-        debug("rollback called on txn with no mutations");
-        is_done_ = true;
-        return;
-    }
-    if (is_done()) {
-        std::string msg("Transaction already done, cannot rollback");
-        error(msg);
-        // need to raise a FAIL_OTHER which is not retryable or rollback-able
-        throw transaction_operation_failed(FAIL_OTHER, msg).no_rollback();
-    }
-    try {
-        // (1) atr_abort
-        retry_op_exp<void>([&] { atr_abort(); });
-        // (2) rollback staged mutations
-        staged_mutations_->rollback(*this);
-        debug("rollback completed unstaging docs");
-
-        // (3) atr_rollback
-        retry_op_exp<void>([&] { atr_rollback_complete(); });
-    } catch (const client_error& e) {
-        error_class ec = e.ec();
-        error("rollback transaction {}, attempt {} fail with error {}", transaction_id(), id(), e.what());
-        if (ec == FAIL_HARD) {
-            throw transaction_operation_failed(ec, e.what()).no_rollback();
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    rollback([barrier](std::exception_ptr err) {
+        if (err) {
+            return barrier->set_exception(err);
         }
-    }
+        barrier->set_value();
+    });
+    f.get();
 }
 
 bool
@@ -1717,9 +2171,8 @@ attempt_context_impl::check_expiry_during_commit_or_rollback(const std::string&
         debug("{} ignoring expiry in stage {}  as in expiry-overtime mode", id(), stage);
     }
 }
-template<typename Handler>
 void
-attempt_context_impl::set_atr_pending_locked(const core::document_id& id, std::unique_lock<std::mutex>&& lock, Handler&& fn)
+attempt_context_impl::set_atr_pending(const core::document_id& id, std::function<void(std::optional<transaction_operation_failed>)>&& fn)
 {
     try {
         if (staged_mutations_->empty()) {
@@ -1730,7 +2183,7 @@ attempt_context_impl::set_atr_pending_locked(const core::document_id& id, std::u
             if (auto ec = error_if_expired_and_not_in_overtime(STAGE_ATR_PENDING, {})) {
                 return fn(transaction_operation_failed(*ec, "transaction expired setting ATR").expired());
             }
-            auto error_handler = [this, &lock, fn](error_class ec, const std::string& message, const core::document_id& id) {
+            auto error_handler = [this, fn](error_class ec, const std::string& message, const core::document_id& id) {
                 transaction_operation_failed err(ec, message);
                 trace("got {} trying to set atr to pending", message);
                 if (expiry_overtime_mode_.load()) {
@@ -1742,16 +2195,16 @@ attempt_context_impl::set_atr_pending_locked(const core::document_id& id, std::u
                         // this should trigger rollback (unlike the above when already in overtime mode)
                         return fn(err.expired());
                     case FAIL_ATR_FULL:
-                        return fn(err);
+                        // nothing has been written to the ATR yet, so the next attempt can just pick another one
+                        atr_selector::instance().mark_full(atr_id_.value());
+                        return fn(err.retry());
                     case FAIL_PATH_ALREADY_EXISTS:
                         // assuming this got resolved, moving on as if ok
                         return fn(std::nullopt);
                     case FAIL_AMBIGUOUS:
-                        // Retry just this
-                        overall_.retry_delay();
-                        // keep it locked!
+                        // Retry just this, after a delay.  Anyone else needing the ATR keeps waiting for us.
                         debug("got {}, retrying set atr pending", ec);
-                        return set_atr_pending_locked(id, std::move(lock), fn);
+                        return overall_.retry_delay([this, id, fn]() mutable { set_atr_pending(id, std::move(fn)); });
                     case FAIL_TRANSIENT:
                         // Retry txn
                         return fn(err.retry());
@@ -1792,15 +2245,16 @@ attempt_context_impl::set_atr_pending_locked(const core::document_id& id, std::u
                                                      store_durability_level_to_string(overall_.config().durability_level()))
                     .xattr()
                     .create_path(),
-                  // subdoc::opcode::set_doc used in replace w/ empty path
-                  // ExtBinaryMetadata
-                  couchbase::mutate_in_specs::replace({}, std::string({ 0x00 })),
               }
                 .specs();
-            req.store_semantics = couchbase::store_semantics::upsert;
 
             wrap_durable_request(req, overall_.config());
-            overall_.cluster_ref().execute(req, [this, fn, error_handler](core::operations::mutate_in_response resp) {
+            // the batcher sets the ATR's body and creates it if need be, once for all the attempts it sends along with this one
+            overall_.atr_batcher().execute(
+              std::move(req),
+              true,
+              overall_.config().atr_group_commit_window(),
+              [this, fn, error_handler](core::operations::mutate_in_response resp) {
                 auto ec = error_class_from_response(resp);
                 if (!ec) {
                     ec = hooks_.after_atr_pending(this);
@@ -1823,13 +2277,9 @@ attempt_context_impl::set_atr_pending_locked(const core::document_id& id, std::u
 staged_mutation*
 attempt_context_impl::check_for_own_write(const core::document_id& id)
 {
-    staged_mutation* own_replace = staged_mutations_->find_replace(id);
-    if (own_replace) {
-        return own_replace;
-    }
-    staged_mutation* own_insert = staged_mutations_->find_insert(id);
-    if (own_insert) {
-        return own_insert;
+    staged_mutation* own_write = staged_mutations_->find_any(id);
+    if (own_write && (own_write->type() == staged_mutation_type::REPLACE || own_write->type() == staged_mutation_type::INSERT)) {
+        return own_write;
     }
     return nullptr;
 }
@@ -1857,7 +2307,7 @@ attempt_context_impl::do_get(const core::document_id& id, const std::optional<st
         staged_mutation* own_write = check_for_own_write(id);
         if (own_write) {
             debug("found own-write of mutated doc {}", id);
-            return cb(std::nullopt, std::nullopt, transaction_get_result::create_from(own_write->doc(), own_write->content()));
+            return cb(std::nullopt, std::nullopt, transaction_get_result::create_from(own_write->doc(), own_write->content_buffer()));
         }
         staged_mutation* own_remove = staged_mutations_->find_remove(id);
         if (own_remove) {
@@ -1898,26 +2348,20 @@ attempt_context_impl::do_get(const core::document_id& id, const std::optional<st
                                                           doc->links().atr_scope_name().value(),
                                                           doc->links().atr_collection_name().value(),
                                                           doc->links().atr_id().value() };
-                            active_transaction_record::get_atr(
+                            atr_cache::instance().get_entry(
                               cluster_ref(),
                               doc_atr_id,
-                              [this, id, doc, cb = std::move(cb)](std::error_code ec, std::optional<active_transaction_record> atr) {
-                                  if (!ec && atr) {
-                                      active_transaction_record& atr_doc = atr.value();
-                                      std::optional<atr_entry> entry;
-                                      for (auto& e : atr_doc.entries()) {
-                                          if (doc->links().staged_attempt_id().value() == e.attempt_id()) {
-                                              entry.emplace(e);
-                                              break;
-                                          }
-                                      }
+                              doc->links().staged_attempt_id().value(),
+                              false,
+                              [this, id, doc, cb = std::move(cb)](std::error_code ec, std::optional<atr_entry> entry) {
+                                  if (!ec) {
                                       bool ignore_doc = false;
-                                      auto content = doc->content<std::string>();
+                                      auto content = doc->content_buffer();
                                       if (entry) {
                                           if (doc->links().staged_attempt_id() && entry->attempt_id() == this->id()) {
                                               // Attempt is reading its own writes
                                               // This is here as backup, it should be returned from the in-memory cache instead
-                                              content = doc->links().staged_content();
+                                              content = doc->links().staged_content_buffer();
                                           } else {
                                               auto err =
                                                 forward_compat::check(forward_compat_stage::GETS_READING_ATR, entry->forward_compat());
@@ -1930,7 +2374,7 @@ attempt_context_impl::do_get(const core::document_id& id, const std::optional<st
                                                       if (doc->links().is_document_being_removed()) {
                                                           ignore_doc = true;
                                                       } else {
-                                                          content = doc->links().staged_content();
+                                                          content = doc->links().staged_content_buffer();
                                                       }
                                                       break;
                                                   default:
@@ -1986,23 +2430,7 @@ attempt_context_impl::get_doc(
   std::function<void(std::optional<error_class>, std::optional<std::string>, std::optional<transaction_get_result>)>&& cb)
 {
     core::operations::lookup_in_request req{ id };
-    req.specs =
-      lookup_in_specs{
-          lookup_in_specs::get(ATR_ID).xattr(),
-          lookup_in_specs::get(TRANSACTION_ID).xattr(),
-          lookup_in_specs::get(ATTEMPT_ID).xattr(),
-          lookup_in_specs::get(STAGED_DATA).xattr(),
-          lookup_in_specs::get(ATR_BUCKET_NAME).xattr(),
-          lookup_in_specs::get(ATR_SCOPE_NAME).xattr(),
-          lookup_in_specs::get(ATR_COLL_NAME).xattr(),
-          lookup_in_specs::get(TRANSACTION_RESTORE_PREFIX_ONLY).xattr(),
-          lookup_in_specs::get(TYPE).xattr(),
-          lookup_in_specs::get(subdoc::lookup_in_macro::document).xattr(),
-          lookup_in_specs::get(CRC32_OF_STAGING).xattr(),
-          lookup_in_specs::get(FORWARD_COMPAT).xattr(),
-          lookup_in_specs::get(""),
-      }
-        .specs();
+    req.specs = transaction_get_result::lookup_specs();
     req.access_deleted = true;
     wrap_request(req, overall_.config());
     try {
@@ -2028,7 +2456,7 @@ attempt_context_impl::get_doc(
 template<typename Handler, typename Delay>
 void
 attempt_context_impl::create_staged_insert_error_handler(const core::document_id& id,
-                                                         const std::string& content,
+                                                         const shared_content& content,
                                                          uint64_t cas,
                                                          Delay&& delay,
                                                          Handler&& cb,
@@ -2145,7 +2573,7 @@ attempt_context_impl::create_staged_insert_error_handler(const core::document_id
 template<typename Handler, typename Delay>
 void
 attempt_context_impl::create_staged_insert(const core::document_id& id,
-                                           const std::string& content,
+                                           const shared_content& content,
                                            uint64_t cas,
                                            Delay&& delay,
                                            Handler&& cb)
@@ -2185,8 +2613,6 @@ attempt_context_impl::create_staged_insert(const core::document_id& id,
                                     content,
                                     std::nullopt,
                                     std::nullopt,
-                                    std::nullopt,
-                                    std::nullopt,
                                     std::string("insert"),
                                     std::nullopt,
                                     true);
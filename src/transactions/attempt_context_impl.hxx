@@ -28,6 +28,7 @@
 #include <couchbase/transactions/attempt_state.hxx>
 #include <couchbase/transactions/transaction_get_result.hxx>
 
+#include "atr_selector.hxx"
 #include "attempt_context_testing_hooks.hxx"
 #include "couchbase/transactions/internal/atr_cleanup_entry.hxx"
 #include "couchbase/transactions/internal/exceptions_internal.hxx"
@@ -55,12 +56,24 @@ namespace transactions
       private:
         transaction_context& overall_;
         std::optional<core::document_id> atr_id_;
+        // keeps other attempts in this process off atr_id_ where they can, until we are done with it
+        atr_selector::lease atr_lease_;
         bool is_done_;
         std::unique_ptr<staged_mutation_queue> staged_mutations_;
         attempt_context_testing_hooks& hooks_;
         error_list errors_;
         std::mutex mutex_;
+        // Setting the ATR to pending happens once per attempt.  Ops which need it while it is in flight wait here, and
+        // once it is done they all get its outcome.  All guarded by mutex_.
+        bool atr_pending_done_{ false };
+        std::optional<transaction_operation_failed> atr_pending_error_;
+        std::list<std::function<void(std::optional<transaction_operation_failed>)>> atr_pending_waiters_;
+        // The start of the txn xattr every staged mutation writes - everything but the op and restore blocks.  Written
+        // once the atr is chosen, and only read after that.
+        std::vector<std::byte> staging_prefix_;
         waitable_op_list op_list_;
+        // how many chunks our doc lists were written to, which must be removed along with our ATR entry
+        size_t doc_list_chunks_{ 0 };
 
         // commit needs to access the hooks
         friend class staged_mutation_queue;
@@ -75,6 +88,17 @@ namespace transactions
         virtual transaction_get_result replace_raw(const transaction_get_result& document, const std::string& content);
         virtual void replace_raw(const transaction_get_result& document, const std::string& content, Callback&& cb);
 
+        virtual std::vector<transaction_get_result> insert_many_raw(std::vector<std::pair<core::document_id, std::string>>&& docs);
+        virtual void insert_many_raw(std::vector<std::pair<core::document_id, std::string>>&& docs, MultiCallback&& cb);
+
+        virtual std::vector<transaction_get_result> replace_many_raw(std::vector<std::pair<transaction_get_result, std::string>>&& docs);
+        virtual void replace_many_raw(std::vector<std::pair<transaction_get_result, std::string>>&& docs, MultiCallback&& cb);
+
+        // stages the first item on its own, so it can set the ATR pending, then the rest concurrently with at most
+        // staging_concurrency() in flight.
+        template<typename Item>
+        void stage_many(std::vector<Item>&& items, std::function<void(const Item&, Callback&&)>&& stage, MultiCallback&& cb);
+
         void remove_staged_insert(const core::document_id& id, VoidCallback&& cb);
 
         // These are all just stubs for now
@@ -98,6 +122,14 @@ namespace transactions
                         const std::string& hook_point,
                         bool check_expiry,
                         std::function<void(std::exception_ptr, core::operations::query_response)>&& cb);
+        // as above, with txdata already serialized (or empty, for none)
+        void wrap_query(const std::string& statement,
+                        const transaction_query_options& opts,
+                        const std::vector<core::json_string>& params,
+                        std::string txdata,
+                        const std::string& hook_point,
+                        bool check_expiry,
+                        std::function<void(std::exception_ptr, core::operations::query_response)>&& cb);
 
         void handle_err_from_callback(std::exception_ptr e)
         {
@@ -293,6 +325,9 @@ namespace transactions
         virtual std::optional<transaction_get_result> get_optional(const core::document_id& id);
         virtual void get_optional(const core::document_id& id, Callback&& cb);
 
+        virtual std::vector<transaction_get_result> get_multi(const std::vector<core::document_id>& ids);
+        virtual void get_multi(const std::vector<core::document_id>& ids, MultiCallback&& cb);
+
         virtual void remove(const transaction_get_result& document);
         virtual void remove(const transaction_get_result& document, VoidCallback&& cb);
 
@@ -316,6 +351,12 @@ namespace transactions
             return is_done_;
         }
 
+        // calls cb once every op started so far - including those started from other ops' callbacks - is done
+        void when_ops_done(std::function<void()>&& cb)
+        {
+            op_list_.when_ops_done(std::move(cb));
+        }
+
         CB_NODISCARD const std::string& transaction_id()
         {
             return overall_.transaction_id();
@@ -334,6 +375,10 @@ namespace transactions
         void state(attempt_state s)
         {
             overall_.current_attempt().state = s;
+            if (s == attempt_state::COMPLETED || s == attempt_state::ROLLED_BACK) {
+                // nothing more for us to write to the ATR
+                atr_lease_.reset();
+            }
         }
 
         CB_NODISCARD const std::string atr_id()
@@ -365,8 +410,7 @@ namespace transactions
 
         void check_expiry_during_commit_or_rollback(const std::string& stage, std::optional<const std::string> doc_id);
 
-        template<typename Handler>
-        void set_atr_pending_locked(const core::document_id& collection, std::unique_lock<std::mutex>&& lock, Handler&& cb);
+        void set_atr_pending(const core::document_id& id, std::function<void(std::optional<transaction_operation_failed>)>&& cb);
 
         std::optional<error_class> error_if_expired_and_not_in_overtime(const std::string& stage, std::optional<const std::string> doc_id);
 
@@ -381,19 +425,41 @@ namespace transactions
         template<typename Handler>
         void check_if_done(Handler& cb);
 
-        void atr_commit(bool ambiguity_resolution_mode);
+        void atr_commit(bool ambiguity_resolution_mode, std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+
+        void handle_atr_commit_error(const client_error& e,
+                                     bool ambiguity_resolution_mode,
+                                     std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+
+        void atr_commit_ambiguity_resolution(std::function<void(std::optional<transaction_operation_failed>)>&& cb);
 
-        void atr_commit_ambiguity_resolution();
+        void handle_atr_commit_ambiguity_resolution_error(const client_error& e,
+                                                          std::function<void(std::optional<transaction_operation_failed>)>&& cb);
 
-        void atr_complete();
+        void atr_complete(std::function<void(std::optional<transaction_operation_failed>)>&& cb);
 
-        void atr_abort();
+        // hands removing our entry (and doc list chunks) to the ATR batcher, without waiting for it
+        void defer_atr_complete();
 
-        void atr_rollback_complete();
+        void atr_abort(size_t retries, std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+
+        void handle_atr_abort_error(const client_error& e,
+                                    size_t retries,
+                                    std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+
+        void atr_rollback_complete(size_t retries, std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+
+        void handle_atr_rollback_complete_error(const client_error& e,
+                                                size_t retries,
+                                                std::function<void(std::optional<transaction_operation_failed>)>&& cb);
 
         void select_atr_if_needed_unlocked(const core::document_id& id,
                                            std::function<void(std::optional<transaction_operation_failed>)>&& cb);
 
+        // records how setting the ATR pending went, then passes that on to cb and every op waiting on it
+        void atr_pending_completed(std::optional<transaction_operation_failed> err,
+                                   std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+
         template<typename Handler>
         void do_get(const core::document_id& id, const std::optional<std::string> resolving_missing_atr_entry, Handler&& cb);
 
@@ -401,20 +467,23 @@ namespace transactions
           const core::document_id& id,
           std::function<void(std::optional<error_class>, std::optional<std::string>, std::optional<transaction_get_result>)>&& cb);
 
+        // writes staging_prefix_, must be called with mutex_ held, once atr_id_ is set
+        void write_staging_prefix();
+
         core::operations::mutate_in_request create_staging_request(const core::document_id& in,
                                                                    const transaction_get_result* document,
                                                                    const std::string type,
-                                                                   std::optional<std::string> content = std::nullopt);
+                                                                   const shared_content& content = {});
 
         template<typename Handler, typename Delay>
-        void create_staged_insert(const core::document_id& id, const std::string& content, uint64_t cas, Delay&& delay, Handler&& cb);
+        void create_staged_insert(const core::document_id& id, const shared_content& content, uint64_t cas, Delay&& delay, Handler&& cb);
 
         template<typename Handler>
-        void create_staged_replace(const transaction_get_result& document, const std::string& content, Handler&& cb);
+        void create_staged_replace(const transaction_get_result& document, const shared_content& content, Handler&& cb);
 
         template<typename Handler, typename Delay>
         void create_staged_insert_error_handler(const core::document_id& id,
-                                                const std::string& content,
+                                                const shared_content& content,
                                                 uint64_t cas,
                                                 Delay&& delay,
                                                 Handler&& cb,
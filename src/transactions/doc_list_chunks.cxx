@@ -0,0 +1,183 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "doc_list_chunks.hxx"
+#include "couchbase/transactions/internal/transaction_fields.hxx"
+#include "couchbase/transactions/internal/utils.hxx"
+#include "json_writer.hxx"
+
+#include <future>
+#include <memory>
+#include <mutex>
+
+namespace tx = couchbase::transactions;
+
+const std::string tx::doc_list_chunks::EXTENSION = "DL";
+
+namespace
+{
+// Waits for a number of requests, then calls back with the first error any of them saw.
+struct pending_requests {
+    std::mutex mutex;
+    std::size_t remaining;
+    std::optional<tx::client_error> error;
+    tx::doc_list_chunks::callback cb;
+
+    pending_requests(std::size_t count, tx::doc_list_chunks::callback&& callback)
+      : remaining(count)
+      , cb(std::move(callback))
+    {
+    }
+
+    void completed(std::optional<tx::client_error> err)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (err && !error) {
+                error = std::move(err);
+            }
+            if (--remaining > 0) {
+                return;
+            }
+        }
+        cb(std::move(error));
+    }
+};
+
+std::vector<tx::doc_record>
+parse_doc_records(nlohmann::json& body, const std::string& field)
+{
+    std::vector<tx::doc_record> records;
+    auto list = body.find(field);
+    if (list == body.end()) {
+        return records;
+    }
+    records.reserve(list->size());
+    for (auto& record : *list) {
+        records.push_back(tx::doc_record::create_from(record));
+    }
+    return records;
+}
+} // namespace
+
+couchbase::core::document_id
+tx::doc_list_chunks::chunk_id(const core::document_id& atr_id, const std::string& attempt_id, std::size_t index)
+{
+    return { atr_id.bucket(), atr_id.scope(), atr_id.collection(), "_txn:dl-" + attempt_id + "-" + std::to_string(index) };
+}
+
+tx::doc_list_chunks::buffer
+tx::doc_list_chunks::forward_compat()
+{
+    // {"CL_E":[{"e":"DL","b":"f"}]}
+    buffer out;
+    json_writer<buffer>(out)
+      .begin_object()
+      .key("CL_E")
+      .begin_array()
+      .begin_object()
+      .field("e", EXTENSION)
+      .field("b", "f")
+      .end_object()
+      .end_array()
+      .end_object();
+    return out;
+}
+
+tx::doc_list_chunks::chunk
+tx::doc_list_chunks::parse(std::string_view raw)
+{
+    auto body = nlohmann::json::parse(raw.begin(), raw.end());
+    return { parse_doc_records(body, ATR_FIELD_DOCS_INSERTED),
+             parse_doc_records(body, ATR_FIELD_DOCS_REPLACED),
+             parse_doc_records(body, ATR_FIELD_DOCS_REMOVED) };
+}
+
+void
+tx::doc_list_chunks::write(core::cluster& cluster,
+                           const transaction_config& config,
+                           const core::document_id& atr_id,
+                           const std::string& attempt_id,
+                           std::vector<buffer> chunks,
+                           callback&& cb)
+{
+    if (chunks.empty()) {
+        return cb(std::nullopt);
+    }
+    auto pending = std::make_shared<pending_requests>(chunks.size(), std::move(cb));
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        core::operations::upsert_request req{ chunk_id(atr_id, attempt_id, i) };
+        req.value = std::move(chunks[i]);
+        wrap_durable_request(req, config);
+        cluster.execute(req, [pending](core::operations::upsert_response resp) {
+            if (auto ec = error_class_from_response(resp); ec) {
+                return pending->completed(
+                  client_error(*ec, "writing doc list chunk " + resp.ctx.id() + " failed: " + resp.ctx.ec().message()));
+            }
+            pending->completed(std::nullopt);
+        });
+    }
+}
+
+void
+tx::doc_list_chunks::remove(core::cluster& cluster,
+                            const transaction_config& config,
+                            durability_level dl,
+                            const core::document_id& atr_id,
+                            const std::string& attempt_id,
+                            std::size_t count,
+                            callback&& cb)
+{
+    if (count == 0) {
+        return cb(std::nullopt);
+    }
+    auto pending = std::make_shared<pending_requests>(count, std::move(cb));
+    for (std::size_t i = 0; i < count; ++i) {
+        core::operations::remove_request req{ chunk_id(atr_id, attempt_id, i) };
+        wrap_durable_request(req, config, dl);
+        cluster.execute(req, [pending](core::operations::remove_response resp) {
+            auto ec = error_class_from_response(resp);
+            if (ec && *ec != FAIL_DOC_NOT_FOUND) {
+                return pending->completed(
+                  client_error(*ec, "removing doc list chunk " + resp.ctx.id() + " failed: " + resp.ctx.ec().message()));
+            }
+            pending->completed(std::nullopt);
+        });
+    }
+}
+
+std::optional<tx::doc_list_chunks::chunk>
+tx::doc_list_chunks::read(core::cluster& cluster,
+                          const transaction_config& config,
+                          const core::document_id& atr_id,
+                          const std::string& attempt_id,
+                          std::size_t index)
+{
+    core::operations::get_request req{ chunk_id(atr_id, attempt_id, index) };
+    wrap_request(req, config);
+    auto barrier = std::make_shared<std::promise<result>>();
+    auto f = barrier->get_future();
+    cluster.execute(req, [barrier](core::operations::get_response resp) { barrier->set_value(result::create_from_response(resp)); });
+    try {
+        auto res = wrap_operation_future(f);
+        return parse(res.raw_value);
+    } catch (const client_error& e) {
+        if (e.ec() == FAIL_DOC_NOT_FOUND) {
+            return std::nullopt;
+        }
+        throw;
+    }
+}
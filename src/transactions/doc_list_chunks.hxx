@@ -0,0 +1,104 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <core/cluster.hxx>
+#include <couchbase/transactions/durability_level.hxx>
+#include <couchbase/transactions/transaction_config.hxx>
+
+#include "couchbase/transactions/internal/doc_record.hxx"
+#include "couchbase/transactions/internal/exceptions_internal.hxx"
+
+namespace couchbase
+{
+namespace transactions
+{
+    /**
+     * The doc lists of an attempt which has staged too many mutations to list them all in its ATR entry.
+     *
+     * Each chunk of the lists is a document of its own, in the ATR's collection, written before the entry is committed
+     * or aborted.  The entry then records how many chunks there are, instead of the lists, along with a forward
+     * compatibility requirement which stops cleanup that knows nothing of chunks from removing it.
+     *
+     * The chunks are removed before the entry is, and only once the attempt is done with its documents - so a chunk
+     * which has gone can be taken as having nothing left to clean.  An attempt which dies after writing its chunks but
+     * before writing its entry does leave them behind.
+     */
+    class doc_list_chunks
+    {
+      public:
+        using buffer = std::vector<std::byte>;
+        using callback = std::function<void(std::optional<client_error>)>;
+
+        struct chunk {
+            std::vector<doc_record> inserted;
+            std::vector<doc_record> replaced;
+            std::vector<doc_record> removed;
+        };
+
+        // the extension an entry with chunks requires of cleanup
+        static const std::string EXTENSION;
+
+        static core::document_id chunk_id(const core::document_id& atr_id, const std::string& attempt_id, std::size_t index);
+
+        /**
+         * The forward compatibility block for an entry with chunks.
+         */
+        static buffer forward_compat();
+
+        static chunk parse(std::string_view raw);
+
+        /**
+         * Durably writes the chunks, all at once, calling cb with the first error if any fail.  Calls cb straight away
+         * if there are none.
+         */
+        static void write(core::cluster& cluster,
+                          const transaction_config& config,
+                          const core::document_id& atr_id,
+                          const std::string& attempt_id,
+                          std::vector<buffer> chunks,
+                          callback&& cb);
+
+        /**
+         * Durably removes the first count chunks.  Chunks which have already gone are not an error.
+         */
+        static void remove(core::cluster& cluster,
+                           const transaction_config& config,
+                           durability_level dl,
+                           const core::document_id& atr_id,
+                           const std::string& attempt_id,
+                           std::size_t count,
+                           callback&& cb);
+
+        /**
+         * Fetches one chunk, or nothing if it has already been removed.  Throws client_error if it cannot.
+         */
+        static std::optional<chunk> read(core::cluster& cluster,
+                                         const transaction_config& config,
+                                         const core::document_id& atr_id,
+                                         const std::string& attempt_id,
+                                         std::size_t index);
+    };
+} // namespace transactions
+} // namespace couchbase
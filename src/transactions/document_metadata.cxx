@@ -0,0 +1,110 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <couchbase/internal/nlohmann/json.hpp>
+#include <couchbase/transactions/document_metadata.hxx>
+
+#include <mutex>
+
+namespace couchbase::transactions
+{
+struct document_metadata::state {
+    // the $document xattr, if we were created from it and have yet to parse it
+    std::string raw;
+    std::once_flag parse_once;
+
+    std::optional<std::string> cas;
+    std::optional<std::string> revid;
+    std::optional<std::uint32_t> exptime;
+    std::optional<std::string> crc32;
+};
+
+document_metadata::document_metadata(std::optional<std::string> cas,
+                                     std::optional<std::string> revid,
+                                     std::optional<std::uint32_t> exptime,
+                                     std::optional<std::string> crc32)
+  : state_(std::make_shared<state>())
+{
+    state_->cas = std::move(cas);
+    state_->revid = std::move(revid);
+    state_->exptime = exptime;
+    state_->crc32 = std::move(crc32);
+}
+
+document_metadata::document_metadata(std::string cas)
+  : state_(std::make_shared<state>())
+{
+    state_->cas = std::move(cas);
+}
+
+document_metadata::document_metadata(std::shared_ptr<state> state)
+  : state_(std::move(state))
+{
+}
+
+document_metadata
+document_metadata::from_document_xattr(std::string document)
+{
+    auto s = std::make_shared<state>();
+    s->raw = std::move(document);
+    return document_metadata(std::move(s));
+}
+
+const document_metadata::state&
+document_metadata::parsed() const
+{
+    std::call_once(state_->parse_once, [s = state_.get()]() {
+        if (s->raw.empty()) {
+            return;
+        }
+        auto doc = nlohmann::json::parse(s->raw);
+        s->cas = doc["CAS"].get<std::string>();
+        // only present in 6.5+
+        if (doc.contains("revid")) {
+            s->revid = doc["revid"].get<std::string>();
+        }
+        s->exptime = doc["exptime"].get<std::uint32_t>();
+        s->crc32 = doc["value_crc32c"].get<std::string>();
+        s->raw.clear();
+        s->raw.shrink_to_fit();
+    });
+    return *state_;
+}
+
+std::optional<std::string>
+document_metadata::cas() const
+{
+    return parsed().cas;
+}
+
+std::optional<std::string>
+document_metadata::revid() const
+{
+    return parsed().revid;
+}
+
+std::optional<std::uint32_t>
+document_metadata::exptime() const
+{
+    return parsed().exptime;
+}
+
+std::optional<std::string>
+document_metadata::crc32() const
+{
+    return parsed().crc32;
+}
+} // namespace couchbase::transactions
@@ -120,7 +120,9 @@ namespace transactions
     struct forward_compat_supported {
         uint32_t protocol_major = 2;
         uint32_t protocol_minor = 0;
-        std::list<std::string> extensions{ "TI", "MO", "BM", "QU", "SD", "BF3787", "BF3705", "BF3838", "RC", "UA", "CO", "BF3791", "CM" };
+        std::list<std::string> extensions{
+            "TI", "MO", "BM", "QU", "SD", "BF3787", "BF3705", "BF3838", "RC", "UA", "CO", "BF3791", "CM", "DL"
+        };
     };
 
     struct forward_compat_requirement {
@@ -0,0 +1,189 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+namespace couchbase
+{
+namespace transactions
+{
+    /**
+     * Writes JSON straight into a buffer (a std::string or std::vector<std::byte>), without building a DOM first.
+     *
+     * Only does what our metadata needs: objects, arrays, strings and integers.  Commas and colons are added as needed,
+     * but nothing checks the calls are balanced - that is up to the caller.
+     */
+    template<typename Buffer>
+    class json_writer
+    {
+      public:
+        explicit json_writer(Buffer& out)
+          : out_(out)
+        {
+        }
+
+        // Carries on writing into a container which out already holds some members of, for instance a prefix that has
+        // been cached.
+        json_writer(Buffer& out, bool has_members)
+          : out_(out)
+          , first_(!has_members)
+        {
+        }
+
+        json_writer& begin_object()
+        {
+            separator();
+            put('{');
+            first_ = true;
+            return *this;
+        }
+
+        json_writer& end_object()
+        {
+            put('}');
+            first_ = false;
+            return *this;
+        }
+
+        json_writer& begin_array()
+        {
+            separator();
+            put('[');
+            first_ = true;
+            return *this;
+        }
+
+        json_writer& end_array()
+        {
+            put(']');
+            first_ = false;
+            return *this;
+        }
+
+        json_writer& key(std::string_view name)
+        {
+            separator();
+            quoted(name);
+            put(':');
+            after_key_ = true;
+            return *this;
+        }
+
+        json_writer& value(std::string_view str)
+        {
+            separator();
+            quoted(str);
+            return *this;
+        }
+
+        json_writer& value(std::int64_t num)
+        {
+            separator();
+            char buf[24];
+            auto res = std::to_chars(buf, buf + sizeof(buf), num);
+            append(std::string_view(buf, static_cast<size_t>(res.ptr - buf)));
+            return *this;
+        }
+
+        json_writer& field(std::string_view name, std::string_view str)
+        {
+            return key(name).value(str);
+        }
+
+        json_writer& field(std::string_view name, std::int64_t num)
+        {
+            return key(name).value(num);
+        }
+
+      private:
+        using byte_type = typename Buffer::value_type;
+
+        Buffer& out_;
+        bool first_{ true };
+        bool after_key_{ false };
+
+        void put(char c)
+        {
+            out_.push_back(static_cast<byte_type>(c));
+        }
+
+        void append(std::string_view str)
+        {
+            auto begin = reinterpret_cast<const byte_type*>(str.data());
+            out_.insert(out_.end(), begin, begin + str.size());
+        }
+
+        void separator()
+        {
+            if (after_key_) {
+                after_key_ = false;
+            } else if (!first_) {
+                put(',');
+            }
+            first_ = false;
+        }
+
+        void quoted(std::string_view str)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+            put('"');
+            // copy runs of characters which need no escaping in one go
+            size_t start = 0;
+            for (size_t i = 0; i < str.size(); ++i) {
+                auto c = static_cast<unsigned char>(str[i]);
+                if (c >= 0x20 && c != '"' && c != '\\') {
+                    continue;
+                }
+                append(str.substr(start, i - start));
+                start = i + 1;
+                put('\\');
+                switch (c) {
+                    case '"':
+                    case '\\':
+                        put(static_cast<char>(c));
+                        break;
+                    case '\b':
+                        put('b');
+                        break;
+                    case '\f':
+                        put('f');
+                        break;
+                    case '\n':
+                        put('n');
+                        break;
+                    case '\r':
+                        put('r');
+                        break;
+                    case '\t':
+                        put('t');
+                        break;
+                    default:
+                        append("u00");
+                        put(hex[c >> 4]);
+                        put(hex[c & 0xf]);
+                        break;
+                }
+            }
+            append(str.substr(start));
+            put('"');
+        }
+    };
+} // namespace transactions
+} // namespace couchbase
@@ -102,10 +102,9 @@ namespace transactions
         template<typename T>
         T content_as() const
         {
-            // this will always be a json string.  To not have extraneous
-            // "" when asked to return as a string, we parse it first.
-            // NOTE: lets do better.
-            return nlohmann::json::parse(raw_value).get<T>();
+            // this will always be json, so a string comes back without the extraneous "".  To just get at the json,
+            // use raw_value, which saves parsing it at all.
+            return default_json_serializer::deserialize_from_json_string<T>(raw_value);
         }
     };
 
@@ -230,10 +229,7 @@ namespace transactions
             res.is_deleted = resp.deleted;
 
             for (std::size_t i = 0; i < resp.fields.size(); ++i) {
-                auto value = resp.fields[i].value.size() > 0
-                               ? core::utils::json::generate(core::utils::json::parse_binary(resp.fields[i].value))
-                               : std::string();
-                res.values.emplace_back(value, static_cast<uint32_t>(resp.fields[i].status));
+                res.values.emplace_back(to_string(resp.fields[i].value), static_cast<uint32_t>(resp.fields[i].status));
             }
             return res;
         }
@@ -18,11 +18,41 @@
 #include "attempt_context_impl.hxx"
 #include "couchbase/transactions/internal/transaction_fields.hxx"
 #include "couchbase/transactions/internal/utils.hxx"
+#include "doc_list_chunks.hxx"
+#include "json_writer.hxx"
 #include "result.hxx"
+#include "windowed_executor.hxx"
+
+#include <iterator>
+#include <list>
 #include <utility>
 
 namespace tx = couchbase::transactions;
 
+namespace
+{
+// {"id":"","bkt":"","scp":"","col":""}, less the values
+constexpr size_t doc_record_overhead = 37;
+
+size_t
+doc_record_size(const couchbase::core::document_id& id)
+{
+    return doc_record_overhead + id.key().size() + id.bucket().size() + id.scope().size() + id.collection().size();
+}
+
+template<typename Buffer>
+void
+write_doc_record(tx::json_writer<Buffer>& writer, const couchbase::core::document_id& id)
+{
+    writer.begin_object()
+      .field(tx::ATR_FIELD_PER_DOC_ID, id.key())
+      .field(tx::ATR_FIELD_PER_DOC_BUCKET, id.bucket())
+      .field(tx::ATR_FIELD_PER_DOC_SCOPE, id.scope())
+      .field(tx::ATR_FIELD_PER_DOC_COLLECTION, id.collection())
+      .end_object();
+}
+} // namespace
+
 bool
 tx::staged_mutation_queue::empty()
 {
@@ -34,108 +64,155 @@ void
 tx::staged_mutation_queue::add(const tx::staged_mutation& mutation)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    // Can only have one staged mutation per document.
-    auto new_end = std::remove_if(
-      queue_.begin(), queue_.end(), [&mutation](const staged_mutation& item) { return document_ids_equal(item.id(), mutation.id()); });
-    queue_.erase(new_end, queue_.end());
+    // Can only have one staged mutation per document.  Overwrite it in place, so pointers to it stay valid.
+    auto it = index_.find(mutation.id());
+    if (it != index_.end()) {
+        *it->second = mutation;
+        return;
+    }
     queue_.push_back(mutation);
+    index_.emplace(mutation.id(), std::prev(queue_.end()));
 }
 
-void
-tx::staged_mutation_queue::extract_to(const std::string& prefix, core::operations::mutate_in_request& req)
+std::vector<std::vector<std::byte>>
+tx::staged_mutation_queue::extract_to(const std::string& prefix, core::operations::mutate_in_request& req, size_t chunk_size)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    nlohmann::json inserts;
-    nlohmann::json replaces;
-    nlohmann::json removes;
+    using buffer = std::vector<std::byte>;
+    if (chunk_size > 0 && queue_.size() > chunk_size) {
+        // each chunk is {"ins":[...],"rep":[...],"rem":[...]}, for the next chunk_size mutations
+        static const std::pair<std::string, staged_mutation_type> lists[] = {
+            { ATR_FIELD_DOCS_INSERTED, staged_mutation_type::INSERT },
+            { ATR_FIELD_DOCS_REPLACED, staged_mutation_type::REPLACE },
+            { ATR_FIELD_DOCS_REMOVED, staged_mutation_type::REMOVE },
+        };
+        std::vector<buffer> chunks;
+        chunks.reserve((queue_.size() + chunk_size - 1) / chunk_size);
+        for (auto begin = queue_.begin(); begin != queue_.end();) {
+            auto end = begin;
+            size_t size = 32;
+            for (size_t n = 0; n < chunk_size && end != queue_.end(); ++n, ++end) {
+                size += doc_record_size(end->id());
+            }
+            auto& chunk = chunks.emplace_back();
+            chunk.reserve(size);
+            json_writer<buffer> writer(chunk);
+            writer.begin_object();
+            for (const auto& [name, type] : lists) {
+                writer.key(name).begin_array();
+                for (auto it = begin; it != end; ++it) {
+                    if (it->type() == type) {
+                        write_doc_record(writer, it->id());
+                    }
+                }
+                writer.end_array();
+            }
+            writer.end_object();
+            begin = end;
+        }
+        auto specs =
+          couchbase::mutate_in_specs{
+              couchbase::mutate_in_specs::upsert(prefix + ATR_FIELD_DOC_LIST_CHUNKS, chunks.size()).xattr().create_path(),
+              couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_FORWARD_COMPAT, doc_list_chunks::forward_compat())
+                .xattr()
+                .create_path(),
+          }
+            .specs();
+        req.specs.insert(req.specs.end(), std::make_move_iterator(specs.begin()), std::make_move_iterator(specs.end()));
+        return chunks;
+    }
+
+    auto index = [](staged_mutation_type type) { return static_cast<size_t>(type); };
 
+    // one array per type of mutation, sized up front so writing it never reallocates (unless there is something to escape)
+    buffer docs[3];
+    size_t sizes[3] = { 2, 2, 2 };
     for (auto& mutation : queue_) {
-        nlohmann::json doc{ { ATR_FIELD_PER_DOC_ID, mutation.doc().id().key() },
-                            { ATR_FIELD_PER_DOC_BUCKET, mutation.doc().id().bucket() },
-                            { ATR_FIELD_PER_DOC_SCOPE, mutation.doc().id().scope() },
-                            { ATR_FIELD_PER_DOC_COLLECTION, mutation.doc().id().collection() } };
-        switch (mutation.type()) {
-            case staged_mutation_type::INSERT:
-                inserts.push_back(doc);
-                break;
-            case staged_mutation_type::REMOVE:
-                removes.push_back(doc);
-                break;
-            case staged_mutation_type::REPLACE:
-                replaces.push_back(doc);
-                break;
-        }
+        sizes[index(mutation.type())] += doc_record_size(mutation.id());
+    }
+    for (size_t i = 0; i < 3; i++) {
+        docs[i].reserve(sizes[i]);
+    }
+    json_writer<buffer> writers[3] = { json_writer<buffer>(docs[0]), json_writer<buffer>(docs[1]), json_writer<buffer>(docs[2]) };
+    for (auto& writer : writers) {
+        writer.begin_array();
     }
-    req.specs =
+    for (auto& mutation : queue_) {
+        write_doc_record(writers[index(mutation.type())], mutation.id());
+    }
+    for (auto& writer : writers) {
+        writer.end_array();
+    }
+
+    // append, as the caller has usually added specs of its own
+    auto specs =
       couchbase::mutate_in_specs{
-          couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_DOCS_INSERTED, core::utils::to_binary(inserts.dump()))
+          couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_DOCS_INSERTED, std::move(docs[index(staged_mutation_type::INSERT)]))
             .xattr()
             .create_path(),
-          couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_DOCS_REPLACED, core::utils::to_binary(replaces.dump()))
+          couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_DOCS_REPLACED, std::move(docs[index(staged_mutation_type::REPLACE)]))
             .xattr()
             .create_path(),
-          couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_DOCS_REMOVED, core::utils::to_binary(removes.dump()))
+          couchbase::mutate_in_specs::upsert_raw(prefix + ATR_FIELD_DOCS_REMOVED, std::move(docs[index(staged_mutation_type::REMOVE)]))
             .xattr()
             .create_path(),
       }
         .specs();
+    req.specs.insert(req.specs.end(), std::make_move_iterator(specs.begin()), std::make_move_iterator(specs.end()));
+    return {};
 }
 
 void
 tx::staged_mutation_queue::remove_any(const core::document_id& id)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto new_end =
-      std::remove_if(queue_.begin(), queue_.end(), [id](const staged_mutation& item) { return document_ids_equal(item.id(), id); });
-    queue_.erase(new_end, queue_.end());
+    auto it = index_.find(id);
+    if (it != index_.end()) {
+        queue_.erase(it->second);
+        index_.erase(it);
+    }
+}
+
+tx::staged_mutation*
+tx::staged_mutation_queue::find_unlocked(const core::document_id& id)
+{
+    auto it = index_.find(id);
+    return it == index_.end() ? nullptr : &*it->second;
+}
+
+tx::staged_mutation*
+tx::staged_mutation_queue::find_unlocked(const core::document_id& id, staged_mutation_type type)
+{
+    auto item = find_unlocked(id);
+    return (item != nullptr && item->type() == type) ? item : nullptr;
 }
 
 tx::staged_mutation*
 tx::staged_mutation_queue::find_any(const core::document_id& id)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& item : queue_) {
-        if (document_ids_equal(item.doc().id(), id)) {
-            return &item;
-        }
-    }
-    return nullptr;
+    return find_unlocked(id);
 }
 
 tx::staged_mutation*
 tx::staged_mutation_queue::find_replace(const core::document_id& id)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& item : queue_) {
-        if (item.type() == staged_mutation_type::REPLACE && document_ids_equal(item.doc().id(), id)) {
-            return &item;
-        }
-    }
-    return nullptr;
+    return find_unlocked(id, staged_mutation_type::REPLACE);
 }
 
 tx::staged_mutation*
 tx::staged_mutation_queue::find_insert(const core::document_id& id)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& item : queue_) {
-        if (item.type() == staged_mutation_type::INSERT && document_ids_equal(item.doc().id(), id)) {
-            return &item;
-        }
-    }
-    return nullptr;
+    return find_unlocked(id, staged_mutation_type::INSERT);
 }
 
 tx::staged_mutation*
 tx::staged_mutation_queue::find_remove(const core::document_id& id)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& item : queue_) {
-        if (item.type() == staged_mutation_type::REMOVE && document_ids_equal(item.doc().id(), id)) {
-            return &item;
-        }
-    }
-    return nullptr;
+    return find_unlocked(id, staged_mutation_type::REMOVE);
 }
 void
 tx::staged_mutation_queue::iterate(std::function<void(staged_mutation&)> op)
@@ -147,41 +224,74 @@ tx::staged_mutation_queue::iterate(std::function<void(staged_mutation&)> op)
 }
 
 void
-tx::staged_mutation_queue::commit(attempt_context_impl& ctx)
+tx::staged_mutation_queue::run_windowed(size_t window,
+                                        std::function<void(staged_mutation&, unstaging_callback&&)>&& op,
+                                        unstaging_callback&& cb)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& item : queue_) {
-        switch (item.type()) {
-            case staged_mutation_type::REMOVE:
-                remove_doc(ctx, item);
-                break;
-            case staged_mutation_type::INSERT:
-            case staged_mutation_type::REPLACE:
-                commit_doc(ctx, item);
-                break;
-        }
+    windowed_executor<std::list<staged_mutation>::iterator>::run(
+      queue_.begin(), queue_.end(), window, std::move(op), [cb = std::move(cb)](std::list<transaction_operation_failed> errors) {
+          if (errors.empty()) {
+              return cb(std::nullopt);
+          }
+          cb(transaction_operation_failed::merge_errors(errors, std::nullopt, false));
+      });
+}
+
+void
+tx::staged_mutation_queue::commit(attempt_context_impl& ctx, unstaging_callback&& cb)
+{
+    // No lock is held while the requests are in flight: the attempt has blocked all further operations by now,
+    // so nothing can add to or remove from the queue.
+    run_windowed(
+      ctx.overall_.config().unstaging_concurrency(),
+      [this, &ctx](staged_mutation& item, unstaging_callback&& item_cb) {
+          switch (item.type()) {
+              case staged_mutation_type::REMOVE:
+                  return remove_doc(ctx, item, std::move(item_cb));
+              case staged_mutation_type::INSERT:
+              case staged_mutation_type::REPLACE:
+                  return commit_doc(ctx, item, false, false, std::move(item_cb));
+          }
+      },
+      std::move(cb));
+}
+
+void
+tx::staged_mutation_queue::rollback(attempt_context_impl& ctx, unstaging_callback&& cb)
+{
+    // As with commit, the attempt has blocked further operations so the queue cannot change under us.
+    run_windowed(
+      ctx.overall_.config().rollback_concurrency(),
+      [this, &ctx](staged_mutation& item, unstaging_callback&& item_cb) { rollback_doc(ctx, item, 0, std::move(item_cb)); },
+      std::move(cb));
+}
+
+void
+tx::staged_mutation_queue::rollback_doc(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb)
+{
+    switch (item.type()) {
+        case staged_mutation_type::INSERT:
+            return rollback_insert(ctx, item, retries, std::move(cb));
+        case staged_mutation_type::REMOVE:
+        case staged_mutation_type::REPLACE:
+            return rollback_remove_or_replace(ctx, item, retries, std::move(cb));
     }
 }
 
 void
-tx::staged_mutation_queue::rollback(attempt_context_impl& ctx)
+tx::staged_mutation_queue::retry_rollback_doc(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& item : queue_) {
-        switch (item.type()) {
-            case staged_mutation_type::INSERT:
-                retry_op_exp<void>([&]() { rollback_insert(ctx, item); });
-                break;
-            case staged_mutation_type::REMOVE:
-            case staged_mutation_type::REPLACE:
-                retry_op_exp<void>([&]() { rollback_remove_or_replace(ctx, item); });
-                break;
-        }
+    // same backoff as retry_op_exp, but per document so one slow document doesn't hold up the others
+    if (retries >= DEFAULT_RETRY_OP_MAX_RETRIES) {
+        return cb(transaction_operation_failed(FAIL_OTHER, "retries exhausted rolling back staged mutation").no_rollback());
     }
+    ctx.overall_.retry_delay(retry_op_exp_delay(retries), [this, &ctx, &item, retries, cb = std::move(cb)]() mutable {
+        rollback_doc(ctx, item, retries + 1, std::move(cb));
+    });
 }
 
 void
-tx::staged_mutation_queue::rollback_insert(attempt_context_impl& ctx, staged_mutation& item)
+tx::staged_mutation_queue::rollback_insert(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb)
 {
     try {
         ctx.trace("rolling back staged insert for {} with cas {}", item.doc().id(), item.doc().cas());
@@ -202,44 +312,61 @@ tx::staged_mutation_queue::rollback_insert(attempt_context_impl& ctx, staged_mut
         req.access_deleted = true;
         req.cas = couchbase::cas(item.doc().cas());
         wrap_durable_request(req, ctx.overall_.config());
-        auto barrier = std::make_shared<std::promise<result>>();
-        auto f = barrier->get_future();
-        ctx.cluster_ref().execute(
-          req, [barrier](core::operations::mutate_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-        auto res = wrap_operation_future(f);
-        ctx.trace("rollback result {}", res);
-        ec = ctx.hooks_.after_rollback_delete_inserted(&ctx, item.doc().id().key());
-        if (ec) {
-            throw client_error(*ec, "after_rollback_delete_insert hook threw error");
-        }
+        ctx.cluster_ref().execute(req, [this, &ctx, &item, retries, cb = std::move(cb)](core::operations::mutate_in_response resp) mutable {
+            auto res = result::create_from_subdoc_response(resp);
+            try {
+                validate_operation_result(res);
+                ctx.trace("rollback result {}", res);
+                auto ec = ctx.hooks_.after_rollback_delete_inserted(&ctx, item.doc().id().key());
+                if (ec) {
+                    throw client_error(*ec, "after_rollback_delete_insert hook threw error");
+                }
+            } catch (const client_error& e) {
+                return handle_rollback_insert_error(e, ctx, item, retries, std::move(cb));
+            }
+            cb(std::nullopt);
+        });
     } catch (const client_error& e) {
-        auto ec = e.ec();
-        if (ctx.expiry_overtime_mode_.load()) {
-            ctx.trace("rollback_insert for {} error while in overtime mode {}", item.doc().id(), e.what());
-            throw transaction_operation_failed(FAIL_EXPIRY, std::string("expired while rolling back insert with {} ") + e.what())
-              .no_rollback()
-              .expired();
-        }
-        switch (ec) {
-            case FAIL_HARD:
-            case FAIL_CAS_MISMATCH:
-                throw transaction_operation_failed(ec, e.what()).no_rollback();
-            case FAIL_EXPIRY:
-                ctx.expiry_overtime_mode_ = true;
-                ctx.trace("rollback_insert in expiry overtime mode, retrying...");
-                throw retry_operation("retry rollback_insert");
-            case FAIL_DOC_NOT_FOUND:
-            case FAIL_PATH_NOT_FOUND:
-                // already cleaned up?
-                return;
-            default:
-                throw retry_operation("retry rollback insert");
-        }
+        return handle_rollback_insert_error(e, ctx, item, retries, std::move(cb));
+    }
+}
+
+void
+tx::staged_mutation_queue::handle_rollback_insert_error(const client_error& e,
+                                                        attempt_context_impl& ctx,
+                                                        staged_mutation& item,
+                                                        size_t retries,
+                                                        unstaging_callback&& cb)
+{
+    auto ec = e.ec();
+    if (ctx.expiry_overtime_mode_.load()) {
+        ctx.trace("rollback_insert for {} error while in overtime mode {}", item.doc().id(), e.what());
+        return cb(transaction_operation_failed(FAIL_EXPIRY, std::string("expired while rolling back insert with {} ") + e.what())
+                    .no_rollback()
+                    .expired());
+    }
+    switch (ec) {
+        case FAIL_HARD:
+        case FAIL_CAS_MISMATCH:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback());
+        case FAIL_EXPIRY:
+            ctx.expiry_overtime_mode_ = true;
+            ctx.trace("rollback_insert in expiry overtime mode, retrying...");
+            return retry_rollback_doc(ctx, item, retries, std::move(cb));
+        case FAIL_DOC_NOT_FOUND:
+        case FAIL_PATH_NOT_FOUND:
+            // already cleaned up?
+            return cb(std::nullopt);
+        default:
+            return retry_rollback_doc(ctx, item, retries, std::move(cb));
     }
 }
 
 void
-tx::staged_mutation_queue::rollback_remove_or_replace(attempt_context_impl& ctx, staged_mutation& item)
+tx::staged_mutation_queue::rollback_remove_or_replace(attempt_context_impl& ctx,
+                                                      staged_mutation& item,
+                                                      size_t retries,
+                                                      unstaging_callback&& cb)
 {
     try {
         ctx.trace("rolling back staged remove/replace for {} with cas {}", item.doc().id(), item.doc().cas());
@@ -259,152 +386,217 @@ tx::staged_mutation_queue::rollback_remove_or_replace(attempt_context_impl& ctx,
             .specs();
         req.cas = couchbase::cas(item.doc().cas());
         wrap_durable_request(req, ctx.overall_.config());
-        auto barrier = std::make_shared<std::promise<result>>();
-        auto f = barrier->get_future();
-        ctx.cluster_ref().execute(
-          req, [barrier](core::operations::mutate_in_response resp) { barrier->set_value(result::create_from_subdoc_response(resp)); });
-        auto res = wrap_operation_future(f);
-        ctx.trace("rollback result {}", res);
-        ec = ctx.hooks_.after_rollback_replace_or_remove(&ctx, item.doc().id().key());
+        ctx.cluster_ref().execute(req, [this, &ctx, &item, retries, cb = std::move(cb)](core::operations::mutate_in_response resp) mutable {
+            auto res = result::create_from_subdoc_response(resp);
+            try {
+                validate_operation_result(res);
+                ctx.trace("rollback result {}", res);
+                auto ec = ctx.hooks_.after_rollback_replace_or_remove(&ctx, item.doc().id().key());
+                if (ec) {
+                    throw client_error(*ec, "after_rollback_replace_or_remove hook threw error");
+                }
+            } catch (const client_error& e) {
+                return handle_rollback_remove_or_replace_error(e, ctx, item, retries, std::move(cb));
+            }
+            cb(std::nullopt);
+        });
+    } catch (const client_error& e) {
+        return handle_rollback_remove_or_replace_error(e, ctx, item, retries, std::move(cb));
+    }
+}
+
+void
+tx::staged_mutation_queue::handle_rollback_remove_or_replace_error(const client_error& e,
+                                                                   attempt_context_impl& ctx,
+                                                                   staged_mutation& item,
+                                                                   size_t retries,
+                                                                   unstaging_callback&& cb)
+{
+    auto ec = e.ec();
+    if (ctx.expiry_overtime_mode_.load()) {
+        return cb(transaction_operation_failed(FAIL_EXPIRY, std::string("expired while handling ") + e.what()).no_rollback());
+    }
+    switch (ec) {
+        case FAIL_HARD:
+        case FAIL_DOC_NOT_FOUND:
+        case FAIL_CAS_MISMATCH:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback());
+        case FAIL_EXPIRY:
+            ctx.expiry_overtime_mode_ = true;
+            ctx.trace("setting expiry overtime mode in {}", STAGE_ROLLBACK_DOC);
+            return retry_rollback_doc(ctx, item, retries, std::move(cb));
+        case FAIL_PATH_NOT_FOUND:
+            // already cleaned up?
+            return cb(std::nullopt);
+        default:
+            return retry_rollback_doc(ctx, item, retries, std::move(cb));
+    }
+}
+
+void
+tx::staged_mutation_queue::commit_doc(attempt_context_impl& ctx,
+                                      staged_mutation& item,
+                                      bool ambiguity_resolution_mode,
+                                      bool cas_zero_mode,
+                                      unstaging_callback&& cb)
+{
+    ctx.trace("commit doc {}, cas_zero_mode {}, ambiguity_resolution_mode {}", item.doc().id(), cas_zero_mode, ambiguity_resolution_mode);
+    try {
+        ctx.check_expiry_during_commit_or_rollback(STAGE_COMMIT_DOC, std::optional<const std::string>(item.doc().id().key()));
+        auto ec = ctx.hooks_.before_doc_committed(&ctx, item.doc().id().key());
         if (ec) {
-            throw client_error(*ec, "after_rollback_replace_or_remove hook threw error");
+            throw client_error(*ec, "before_doc_committed hook threw error");
+        }
+
+        // move staged content into doc
+        ctx.trace("commit doc id {}, content {}, cas {}", item.doc().id(), item.content(), item.doc().cas());
+
+        if (item.type() == staged_mutation_type::INSERT && !cas_zero_mode) {
+            core::operations::insert_request req{ item.doc().id() };
+            req.value = core::utils::to_binary(item.content());
+            wrap_durable_request(req, ctx.overall_.config());
+            ctx.cluster_ref().execute(
+              req,
+              [this, &ctx, &item, ambiguity_resolution_mode, cas_zero_mode, cb = std::move(cb)](
+                core::operations::insert_response resp) mutable {
+                  commit_doc_completed(
+                    ctx, item, result::create_from_mutation_response(resp), ambiguity_resolution_mode, cas_zero_mode, std::move(cb));
+              });
+        } else {
+            core::operations::mutate_in_request req{ item.doc().id() };
+            req.specs =
+              couchbase::mutate_in_specs{
+                  couchbase::mutate_in_specs::remove(TRANSACTION_INTERFACE_PREFIX_ONLY).xattr(),
+                  // subdoc::opcode::set_doc used in replace w/ empty path
+                  couchbase::mutate_in_specs::replace_raw("", core::utils::to_binary(item.content())),
+              }
+                .specs();
+            req.store_semantics = couchbase::store_semantics::replace;
+            req.cas = couchbase::cas(cas_zero_mode ? 0 : item.doc().cas());
+            wrap_durable_request(req, ctx.overall_.config());
+            ctx.cluster_ref().execute(
+              req,
+              [this, &ctx, &item, ambiguity_resolution_mode, cas_zero_mode, cb = std::move(cb)](
+                core::operations::mutate_in_response resp) mutable {
+                  commit_doc_completed(
+                    ctx, item, result::create_from_subdoc_response(resp), ambiguity_resolution_mode, cas_zero_mode, std::move(cb));
+              });
         }
     } catch (const client_error& e) {
-        auto ec = e.ec();
-        if (ctx.expiry_overtime_mode_.load()) {
-            throw transaction_operation_failed(FAIL_EXPIRY, std::string("expired while handling ") + e.what()).no_rollback();
+        return handle_commit_doc_error(e, ctx, item, ambiguity_resolution_mode, cas_zero_mode, std::move(cb));
+    }
+}
+
+void
+tx::staged_mutation_queue::commit_doc_completed(attempt_context_impl& ctx,
+                                                staged_mutation& item,
+                                                result res,
+                                                bool ambiguity_resolution_mode,
+                                                bool cas_zero_mode,
+                                                unstaging_callback&& cb)
+{
+    try {
+        validate_operation_result(res);
+        ctx.trace("commit doc result {}", res);
+        // TODO: mutation tokens
+        auto ec = ctx.hooks_.after_doc_committed_before_saving_cas(&ctx, item.doc().id().key());
+        if (ec) {
+            throw client_error(*ec, "after_doc_committed_before_saving_cas threw error");
         }
-        switch (ec) {
-            case FAIL_HARD:
-            case FAIL_DOC_NOT_FOUND:
-            case FAIL_CAS_MISMATCH:
-                throw transaction_operation_failed(ec, e.what()).no_rollback();
-            case FAIL_EXPIRY:
-                ctx.expiry_overtime_mode_ = true;
-                ctx.trace("setting expiry overtime mode in {}", STAGE_ROLLBACK_DOC);
-                throw retry_operation("retry rollback_remove_or_replace");
-            case FAIL_PATH_NOT_FOUND:
-                // already cleaned up?
-                return;
-            default:
-                throw retry_operation("retry rollback_remove_or_replace");
+        item.doc().cas(res.cas);
+        ec = ctx.hooks_.after_doc_committed(&ctx, item.doc().id().key());
+        if (ec) {
+            throw client_error(*ec, "after_doc_committed threw error");
         }
+    } catch (const client_error& e) {
+        return handle_commit_doc_error(e, ctx, item, ambiguity_resolution_mode, cas_zero_mode, std::move(cb));
     }
+    cb(std::nullopt);
 }
+
 void
-tx::staged_mutation_queue::commit_doc(attempt_context_impl& ctx, staged_mutation& item, bool ambiguity_resolution_mode, bool cas_zero_mode)
+tx::staged_mutation_queue::handle_commit_doc_error(const client_error& e,
+                                                   attempt_context_impl& ctx,
+                                                   staged_mutation& item,
+                                                   bool ambiguity_resolution_mode,
+                                                   bool cas_zero_mode,
+                                                   unstaging_callback&& cb)
 {
-    retry_op<void>([&] {
-        ctx.trace(
-          "commit doc {}, cas_zero_mode {}, ambiguity_resolution_mode {}", item.doc().id(), cas_zero_mode, ambiguity_resolution_mode);
-        try {
-            ctx.check_expiry_during_commit_or_rollback(STAGE_COMMIT_DOC, std::optional<const std::string>(item.doc().id().key()));
-            auto ec = ctx.hooks_.before_doc_committed(&ctx, item.doc().id().key());
-            if (ec) {
-                throw client_error(*ec, "before_doc_committed hook threw error");
+    error_class ec = e.ec();
+    if (ctx.expiry_overtime_mode_.load()) {
+        return cb(transaction_operation_failed(FAIL_EXPIRY, "expired during commit").no_rollback().failed_post_commit());
+    }
+    switch (ec) {
+        case FAIL_AMBIGUOUS:
+            ctx.debug("FAIL_AMBIGUOUS in commit_doc for {}, retrying", item.doc().id());
+            return ctx.overall_.retry_delay(DEFAULT_RETRY_OP_DELAY, [this, &ctx, &item, cas_zero_mode, cb = std::move(cb)]() mutable {
+                commit_doc(ctx, item, true, cas_zero_mode, std::move(cb));
+            });
+        case FAIL_CAS_MISMATCH:
+        case FAIL_DOC_ALREADY_EXISTS:
+            if (ambiguity_resolution_mode) {
+                return cb(transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit());
             }
+            ctx.debug("{} in commit_doc for {}, retrying with cas zero", ec, item.doc().id());
+            return ctx.overall_.retry_delay(DEFAULT_RETRY_OP_DELAY, [this, &ctx, &item, cb = std::move(cb)]() mutable {
+                commit_doc(ctx, item, true, true, std::move(cb));
+            });
+        default:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit());
+    }
+}
 
-            // move staged content into doc
-            ctx.trace("commit doc id {}, content {}, cas {}", item.doc().id(), item.content(), item.doc().cas());
-
-            result res;
-            if (item.type() == staged_mutation_type::INSERT && !cas_zero_mode) {
-                core::operations::insert_request req{ item.doc().id() };
-                auto content = item.doc().content<nlohmann::json>().dump();
-                req.value = core::utils::to_binary(content);
-                wrap_durable_request(req, ctx.overall_.config());
-                auto barrier = std::make_shared<std::promise<result>>();
-                auto f = barrier->get_future();
-                ctx.cluster_ref().execute(req, [barrier](core::operations::insert_response resp) {
-                    barrier->set_value(result::create_from_mutation_response(resp));
-                });
-                res = wrap_operation_future(f);
-            } else {
-                core::operations::mutate_in_request req{ item.doc().id() };
-                req.specs =
-                  couchbase::mutate_in_specs{
-                      couchbase::mutate_in_specs::remove(TRANSACTION_INTERFACE_PREFIX_ONLY).xattr(),
-                      // subdoc::opcode::set_doc used in replace w/ empty path
-                      couchbase::mutate_in_specs::replace_raw("", core::utils::to_binary(item.content())),
-                  }
-                    .specs();
-                req.store_semantics = couchbase::store_semantics::replace;
-                req.cas = couchbase::cas(cas_zero_mode ? 0 : item.doc().cas());
-                wrap_durable_request(req, ctx.overall_.config());
-                auto barrier = std::make_shared<std::promise<result>>();
-                auto f = barrier->get_future();
-                ctx.cluster_ref().execute(req, [barrier](core::operations::mutate_in_response resp) {
-                    barrier->set_value(result::create_from_subdoc_response(resp));
-                });
-                res = wrap_operation_future(f);
-            }
-            ctx.trace("commit doc result {}", res);
-            // TODO: mutation tokens
-            ec = ctx.hooks_.after_doc_committed_before_saving_cas(&ctx, item.doc().id().key());
-            if (ec) {
-                throw client_error(*ec, "after_doc_committed_before_saving_cas threw error");
-            }
-            item.doc().cas(res.cas);
-            ec = ctx.hooks_.after_doc_committed(&ctx, item.doc().id().key());
-            if (ec) {
-                throw client_error(*ec, "after_doc_committed threw error");
-            }
-        } catch (const client_error& e) {
-            error_class ec = e.ec();
-            if (ctx.expiry_overtime_mode_.load()) {
-                throw transaction_operation_failed(FAIL_EXPIRY, "expired during commit").no_rollback().failed_post_commit();
-            }
-            switch (ec) {
-                case FAIL_AMBIGUOUS:
-                    ambiguity_resolution_mode = true;
-                    throw retry_operation("FAIL_AMBIGUOUS in commit_doc");
-                case FAIL_CAS_MISMATCH:
-                case FAIL_DOC_ALREADY_EXISTS:
-                    if (ambiguity_resolution_mode) {
-                        throw transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit();
-                    }
-                    ambiguity_resolution_mode = true;
-                    cas_zero_mode = true;
-                    throw retry_operation("FAIL_DOC_ALREADY_EXISTS in commit_doc");
-                default:
-                    throw transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit();
-            }
+void
+tx::staged_mutation_queue::remove_doc(attempt_context_impl& ctx, staged_mutation& item, unstaging_callback&& cb)
+{
+    try {
+        ctx.check_expiry_during_commit_or_rollback(STAGE_REMOVE_DOC, std::optional<const std::string>(item.doc().id().key()));
+        auto ec = ctx.hooks_.before_doc_removed(&ctx, item.doc().id().key());
+        if (ec) {
+            throw client_error(*ec, "before_doc_removed hook threw error");
         }
-    });
+        core::operations::remove_request req{ item.doc().id() };
+        wrap_durable_request(req, ctx.overall_.config());
+        ctx.cluster_ref().execute(req, [this, &ctx, &item, cb = std::move(cb)](core::operations::remove_response resp) mutable {
+            remove_doc_completed(ctx, item, result::create_from_mutation_response(resp), std::move(cb));
+        });
+    } catch (const client_error& e) {
+        return handle_remove_doc_error(e, ctx, item, std::move(cb));
+    }
 }
 
 void
-tx::staged_mutation_queue::remove_doc(attempt_context_impl& ctx, staged_mutation& item)
+tx::staged_mutation_queue::remove_doc_completed(attempt_context_impl& ctx, staged_mutation& item, result res, unstaging_callback&& cb)
 {
-    retry_op<void>([&] {
-        try {
-            ctx.check_expiry_during_commit_or_rollback(STAGE_REMOVE_DOC, std::optional<const std::string>(item.doc().id().key()));
-            auto ec = ctx.hooks_.before_doc_removed(&ctx, item.doc().id().key());
-            if (ec) {
-                throw client_error(*ec, "before_doc_removed hook threw error");
-            }
-            core::operations::remove_request req{ item.doc().id() };
-            wrap_durable_request(req, ctx.overall_.config());
-            auto barrier = std::make_shared<std::promise<result>>();
-            auto f = barrier->get_future();
-            ctx.cluster_ref().execute(
-              req, [barrier](core::operations::remove_response resp) { barrier->set_value(result::create_from_mutation_response(resp)); });
-            wrap_operation_future(f);
-            ec = ctx.hooks_.after_doc_removed_pre_retry(&ctx, item.doc().id().key());
-            if (ec) {
-                throw client_error(*ec, "after_doc_removed_pre_retry threw error");
-            }
-        } catch (const client_error& e) {
-            error_class ec = e.ec();
-            if (ctx.expiry_overtime_mode_.load()) {
-                throw transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit();
-            }
-            switch (ec) {
-                case FAIL_AMBIGUOUS:
-                    throw retry_operation("remove_doc got FAIL_AMBIGUOUS");
-                default:
-                    throw transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit();
-            }
+    try {
+        validate_operation_result(res);
+        auto ec = ctx.hooks_.after_doc_removed_pre_retry(&ctx, item.doc().id().key());
+        if (ec) {
+            throw client_error(*ec, "after_doc_removed_pre_retry threw error");
         }
-    });
+    } catch (const client_error& e) {
+        return handle_remove_doc_error(e, ctx, item, std::move(cb));
+    }
+    cb(std::nullopt);
+}
+
+void
+tx::staged_mutation_queue::handle_remove_doc_error(const client_error& e,
+                                                   attempt_context_impl& ctx,
+                                                   staged_mutation& item,
+                                                   unstaging_callback&& cb)
+{
+    error_class ec = e.ec();
+    if (ctx.expiry_overtime_mode_.load()) {
+        return cb(transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit());
+    }
+    switch (ec) {
+        case FAIL_AMBIGUOUS:
+            ctx.debug("FAIL_AMBIGUOUS in remove_doc for {}, retrying", item.doc().id());
+            return ctx.overall_.retry_delay(DEFAULT_RETRY_OP_DELAY, [this, &ctx, &item, cb = std::move(cb)]() mutable {
+                remove_doc(ctx, item, std::move(cb));
+            });
+        default:
+            return cb(transaction_operation_failed(ec, e.what()).no_rollback().failed_post_commit());
+    }
 }
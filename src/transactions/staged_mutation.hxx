@@ -16,8 +16,12 @@
 
 #pragma once
 
+#include <functional>
+#include <list>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "attempt_context_impl.hxx"
@@ -35,20 +39,22 @@ namespace transactions
       private:
         transaction_get_result doc_;
         staged_mutation_type type_;
-        std::string content_;
+        shared_content content_;
 
       public:
-        template<typename Content>
-        staged_mutation(transaction_get_result& doc, Content content, staged_mutation_type type)
+        // The doc keeps the staged content as its body, rather than what it had before, so only one copy of the body is
+        // held - and that is shared with whatever else has it.
+        staged_mutation(transaction_get_result& doc, shared_content content, staged_mutation_type type)
           : doc_(std::move(doc))
           , type_(type)
           , content_(std::move(content))
         {
+            doc_.content(content_);
         }
 
         staged_mutation(const staged_mutation& o) = default;
 
-        CB_NODISCARD staged_mutation& operator=(const staged_mutation& o)
+        staged_mutation& operator=(const staged_mutation& o)
         {
             doc_ = o.doc_;
             type_ = o.type_;
@@ -77,13 +83,19 @@ namespace transactions
         }
 
         const std::string& content() const
+        {
+            return content_.str();
+        }
+
+        const shared_content& content_buffer() const
         {
             return content_;
         }
 
         void content(const std::string& content)
         {
-            content_ = content;
+            content_ = shared_content(content);
+            doc_.content(content_);
         }
 
         std::string type_as_string() const
@@ -103,22 +115,82 @@ namespace transactions
     class staged_mutation_queue
     {
       private:
+        struct document_id_hash {
+            size_t operator()(const core::document_id& id) const
+            {
+                // the key is what usually differs, so start with that
+                size_t h = std::hash<std::string>()(id.key());
+                auto combine = [&h](const std::string& part) { h ^= std::hash<std::string>()(part) + 0x9e3779b9 + (h << 6) + (h >> 2); };
+                combine(id.bucket());
+                combine(id.scope());
+                combine(id.collection());
+                return h;
+            }
+        };
+        struct document_id_equal {
+            bool operator()(const core::document_id& id1, const core::document_id& id2) const
+            {
+                return document_ids_equal(id1, id2);
+            }
+        };
+
         std::mutex mutex_;
-        std::vector<staged_mutation> queue_;
+        // The list keeps the mutations in the order they were staged, and never moves them, so the staged_mutation*
+        // we hand out stay valid until that mutation is removed.  The index finds them by document.
+        std::list<staged_mutation> queue_;
+        std::unordered_map<core::document_id, std::list<staged_mutation>::iterator, document_id_hash, document_id_equal> index_;
+
+        staged_mutation* find_unlocked(const core::document_id& id);
+        staged_mutation* find_unlocked(const core::document_id& id, staged_mutation_type type);
+        using unstaging_callback = std::function<void(std::optional<transaction_operation_failed>)>;
+
         void commit_doc(attempt_context_impl& ctx,
                         staged_mutation& item,
-                        bool ambiguity_resolution_mode = false,
-                        bool cas_zero_mode = false);
-        void remove_doc(attempt_context_impl& ctx, staged_mutation& item);
-        void rollback_insert(attempt_context_impl& ctx, staged_mutation& item);
-        void rollback_remove_or_replace(attempt_context_impl& ctx, staged_mutation& item);
+                        bool ambiguity_resolution_mode,
+                        bool cas_zero_mode,
+                        unstaging_callback&& cb);
+        void commit_doc_completed(attempt_context_impl& ctx,
+                                  staged_mutation& item,
+                                  result res,
+                                  bool ambiguity_resolution_mode,
+                                  bool cas_zero_mode,
+                                  unstaging_callback&& cb);
+        void handle_commit_doc_error(const client_error& e,
+                                     attempt_context_impl& ctx,
+                                     staged_mutation& item,
+                                     bool ambiguity_resolution_mode,
+                                     bool cas_zero_mode,
+                                     unstaging_callback&& cb);
+        void remove_doc(attempt_context_impl& ctx, staged_mutation& item, unstaging_callback&& cb);
+        void remove_doc_completed(attempt_context_impl& ctx, staged_mutation& item, result res, unstaging_callback&& cb);
+        void handle_remove_doc_error(const client_error& e, attempt_context_impl& ctx, staged_mutation& item, unstaging_callback&& cb);
+        void rollback_doc(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb);
+        void retry_rollback_doc(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb);
+        void rollback_insert(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb);
+        void handle_rollback_insert_error(const client_error& e,
+                                          attempt_context_impl& ctx,
+                                          staged_mutation& item,
+                                          size_t retries,
+                                          unstaging_callback&& cb);
+        void rollback_remove_or_replace(attempt_context_impl& ctx, staged_mutation& item, size_t retries, unstaging_callback&& cb);
+        void handle_rollback_remove_or_replace_error(const client_error& e,
+                                                     attempt_context_impl& ctx,
+                                                     staged_mutation& item,
+                                                     size_t retries,
+                                                     unstaging_callback&& cb);
+        // runs op over every staged mutation, with at most window in flight, then calls cb with the merged errors, if any.
+        void run_windowed(size_t window, std::function<void(staged_mutation&, unstaging_callback&&)>&& op, unstaging_callback&& cb);
 
       public:
         bool empty();
         void add(const staged_mutation& mutation);
-        void extract_to(const std::string& prefix, core::operations::mutate_in_request& req);
-        void commit(attempt_context_impl& ctx);
-        void rollback(attempt_context_impl& ctx);
+        // Adds specs writing the doc lists under prefix to req.  With more than chunk_size mutations (unless it is zero)
+        // the lists are returned in chunks, to be written to documents of their own, and req only records how many.
+        std::vector<std::vector<std::byte>> extract_to(const std::string& prefix,
+                                                       core::operations::mutate_in_request& req,
+                                                       size_t chunk_size = 0);
+        void commit(attempt_context_impl& ctx, std::function<void(std::optional<transaction_operation_failed>)>&& cb);
+        void rollback(attempt_context_impl& ctx, std::function<void(std::optional<transaction_operation_failed>)>&& cb);
         void iterate(std::function<void(staged_mutation&)>);
         void remove_any(const core::document_id&);
 
@@ -0,0 +1,124 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couchbase/transactions/internal/timer_scheduler.hxx"
+#include "couchbase/transactions/internal/exceptions_internal.hxx"
+#include "couchbase/transactions/internal/logging.hxx"
+#include "couchbase/transactions/internal/utils.hxx"
+
+#include <asio/error.hpp>
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/steady_timer.hpp>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+
+namespace tx = couchbase::transactions;
+
+struct tx::timer_scheduler::state {
+    asio::io_context io;
+    std::optional<asio::executor_work_guard<asio::io_context::executor_type>> work{ asio::make_work_guard(io) };
+    std::mutex mutex;
+    bool closed{ false };
+    std::set<std::shared_ptr<asio::steady_timer>> timers;
+};
+
+tx::timer_scheduler::timer_scheduler()
+  : state_(std::make_shared<state>())
+  , thread_([state = state_]() { state->io.run(); })
+{
+}
+
+tx::timer_scheduler::~timer_scheduler()
+{
+    close();
+}
+
+void
+tx::timer_scheduler::schedule(std::chrono::nanoseconds delay, std::function<void(std::error_code)>&& fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->closed) {
+            auto timer = std::make_shared<asio::steady_timer>(state_->io, delay);
+            state_->timers.insert(timer);
+            // holds on to the state rather than us, as it may run after we are gone
+            timer->async_wait([state = state_, timer, fn = std::move(fn)](std::error_code ec) {
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->timers.erase(timer);
+                }
+                fn(ec);
+            });
+            return;
+        }
+    }
+    fn(asio::error::operation_aborted);
+}
+
+void
+tx::timer_scheduler::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->closed) {
+            state_->closed = true;
+            for (const auto& timer : state_->timers) {
+                timer->cancel();
+            }
+            state_->work.reset();
+        }
+    }
+    // a callback may be the last thing holding on to us, in which case we cannot join ourselves.  The thread keeps the
+    // io_context alive until run() has returned.
+    if (thread_.joinable()) {
+        if (thread_.get_id() == std::this_thread::get_id()) {
+            thread_.detach();
+        } else {
+            thread_.join();
+        }
+    }
+}
+
+void
+tx::async_exp_delay::operator()(std::function<void(std::exception_ptr)>&& cb)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!end_time_) {
+        end_time_ = now + timeout_;
+        return cb(nullptr);
+    }
+    if (now > *end_time_) {
+        return cb(std::make_exception_ptr(retry_operation_timeout("timed out")));
+    }
+    auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(initial_delay_ * (jitter() * pow(2, retries_++)));
+    if (delay > max_delay_) {
+        delay = max_delay_;
+    }
+    if (now + delay > *end_time_) {
+        delay = std::chrono::duration_cast<std::chrono::nanoseconds>(*end_time_ - now);
+    }
+    txn_log->trace("waiting {}ms before next attempt", std::chrono::duration_cast<std::chrono::milliseconds>(delay).count());
+    scheduler_.schedule(delay, [cb = std::move(cb)](std::error_code ec) {
+        if (ec) {
+            return cb(std::make_exception_ptr(retry_operation_timeout("scheduler closed while waiting")));
+        }
+        cb(nullptr);
+    });
+}
@@ -24,7 +24,8 @@ namespace transactions
 
     transaction_attempt::transaction_attempt()
       : id(uid_generator::next())
-      , state(attempt_state::NOT_STARTED){};
+      , state(attempt_state::NOT_STARTED)
+      , unstaging_complete(false){};
 
 } // namespace transactions
 } // namespace couchbase
@@ -32,6 +32,14 @@ namespace transactions
       , attempt_context_hooks_(new attempt_context_testing_hooks())
       , cleanup_hooks_(new cleanup_testing_hooks())
       , scan_consistency_(core::query_scan_consistency::request_plus)
+      , unstaging_concurrency_(32)
+      , rollback_concurrency_(32)
+      , staging_concurrency_(32)
+      , num_atrs_(1024)
+      , num_vbuckets_(1024)
+      , doc_list_chunk_size_(0)
+      , atr_group_commit_window_(0)
+      , defer_atr_complete_(false)
     {
     }
 
@@ -47,6 +55,14 @@ namespace transactions
       , cleanup_hooks_(new cleanup_testing_hooks(config.cleanup_hooks()))
       , scan_consistency_(config.scan_consistency())
       , custom_metadata_collection_(config.custom_metadata_collection())
+      , unstaging_concurrency_(config.unstaging_concurrency())
+      , rollback_concurrency_(config.rollback_concurrency())
+      , staging_concurrency_(config.staging_concurrency())
+      , num_atrs_(config.num_atrs())
+      , num_vbuckets_(config.num_vbuckets())
+      , doc_list_chunk_size_(config.doc_list_chunk_size())
+      , atr_group_commit_window_(config.atr_group_commit_window())
+      , defer_atr_complete_(config.defer_atr_complete())
 
     {
     }
@@ -62,6 +78,14 @@ namespace transactions
         cleanup_hooks_.reset(new cleanup_testing_hooks(c.cleanup_hooks()));
         scan_consistency_ = c.scan_consistency();
         custom_metadata_collection_ = c.custom_metadata_collection();
+        unstaging_concurrency_ = c.unstaging_concurrency();
+        rollback_concurrency_ = c.rollback_concurrency();
+        staging_concurrency_ = c.staging_concurrency();
+        num_atrs_ = c.num_atrs();
+        num_vbuckets_ = c.num_vbuckets();
+        doc_list_chunk_size_ = c.doc_list_chunk_size();
+        atr_group_commit_window_ = c.atr_group_commit_window();
+        defer_atr_complete_ = c.defer_atr_complete();
         return *this;
     }
 
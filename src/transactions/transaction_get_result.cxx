@@ -14,109 +14,111 @@
  *   limitations under the License.
  */
 #include "result.hxx"
+#include "couchbase/transactions/internal/transaction_fields.hxx"
 #include <couchbase/transactions/transaction_get_result.hxx>
 
+#include <string_view>
+
 namespace couchbase::transactions
 {
-transaction_get_result
-transaction_get_result::create_from(const core::operations::lookup_in_response& resp)
+const decltype(core::operations::lookup_in_request::specs)&
+transaction_get_result::lookup_specs()
 {
-    std::optional<std::string> atr_id;
-    std::optional<std::string> transaction_id;
-    std::optional<std::string> attempt_id;
-    std::optional<std::string> staged_content;
-    std::optional<std::string> atr_bucket_name;
-    std::optional<std::string> atr_scope_name;
-    std::optional<std::string> atr_collection_name;
-    std::optional<nlohmann::json> forward_compat;
-
-    // read from xattrs.txn.restore
-    std::optional<std::string> cas_pre_txn;
-    std::optional<std::string> revid_pre_txn;
-    std::optional<uint32_t> exptime_pre_txn;
-    std::optional<std::string> crc32_of_staging;
-
-    // read from $document
-    std::optional<std::string> cas_from_doc;
-    std::optional<std::string> revid_from_doc;
-    std::optional<uint32_t> exptime_from_doc;
-    std::optional<std::string> crc32_from_doc;
+    static const auto specs =
+      lookup_in_specs{
+          lookup_in_specs::get(ATR_ID).xattr(),
+          lookup_in_specs::get(TRANSACTION_ID).xattr(),
+          lookup_in_specs::get(ATTEMPT_ID).xattr(),
+          lookup_in_specs::get(STAGED_DATA).xattr(),
+          lookup_in_specs::get(ATR_BUCKET_NAME).xattr(),
+          lookup_in_specs::get(ATR_SCOPE_NAME).xattr(),
+          lookup_in_specs::get(ATR_COLL_NAME).xattr(),
+          lookup_in_specs::get(TRANSACTION_RESTORE_PREFIX_ONLY).xattr(),
+          lookup_in_specs::get(TYPE).xattr(),
+          lookup_in_specs::get(subdoc::lookup_in_macro::document).xattr(),
+          lookup_in_specs::get(CRC32_OF_STAGING).xattr(),
+          lookup_in_specs::get(FORWARD_COMPAT).xattr(),
+          lookup_in_specs::get(""),
+      }
+        .specs();
+    return specs;
+}
 
-    std::optional<std::string> op;
-    std::string content;
+namespace
+{
+using lookup_field = decltype(core::operations::lookup_in_response::fields)::value_type;
 
-    if (resp.fields[0].status == key_value_status_code::success) {
-        atr_id = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[0].value));
-    }
-    if (resp.fields[1].status == key_value_status_code::success) {
-        transaction_id = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[1].value));
-    }
-    if (resp.fields[2].status == key_value_status_code::success) {
-        attempt_id = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[2].value));
-    }
-    if (resp.fields[3].status == key_value_status_code::success) {
-        staged_content = to_string(resp.fields[3].value);
-    }
-    if (resp.fields[4].status == key_value_status_code::success) {
-        atr_bucket_name = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[4].value));
+// The fields we look up are mostly json strings we wrote ourselves, which never need unescaping - so just strip the
+// quotes, and save parsing them.
+std::string
+string_from_field(const std::vector<std::byte>& value)
+{
+    std::string_view raw(reinterpret_cast<const char*>(value.data()), value.size());
+    if (raw.size() >= 2 && raw.front() == '"' && raw.back() == '"' && raw.find('\\') == std::string_view::npos) {
+        return std::string(raw.substr(1, raw.size() - 2));
     }
-    if (resp.fields[5].status == key_value_status_code::success) {
-        atr_scope_name = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[5].value));
+    return default_json_serializer::deserialize_from_json_string<std::string>(to_string(value));
+}
+
+std::optional<std::string>
+optional_string_from_field(const lookup_field& field)
+{
+    if (field.status != key_value_status_code::success) {
+        return std::nullopt;
     }
-    if (resp.fields[6].status == key_value_status_code::success) {
-        atr_collection_name = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[6].value));
+    return string_from_field(field.value);
+}
+
+std::optional<std::string>
+optional_raw_from_field(const lookup_field& field)
+{
+    if (field.status != key_value_status_code::success) {
+        return std::nullopt;
     }
+    return to_string(field.value);
+}
 
-    if (resp.fields[7].status == key_value_status_code::success) {
-        auto restore = nlohmann::json::parse(to_string(resp.fields[7].value));
-        cas_pre_txn = restore["CAS"].get<std::string>();
-        // only present in 6.5+
-        revid_pre_txn = restore["revid"].get<std::string>();
-        exptime_pre_txn = restore["exptime"].get<uint32_t>();
-    }
-    if (resp.fields[8].status == key_value_status_code::success) {
-        op = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[8].value));
-    }
-    if (resp.fields[9].status == key_value_status_code::success) {
-        auto doc = nlohmann::json::parse(to_string(resp.fields[9].value));
-        cas_from_doc = doc["CAS"].get<std::string>();
-        // only present in 6.5+
-        revid_from_doc = doc["revid"].get<std::string>();
-        exptime_from_doc = doc["exptime"].get<uint32_t>();
-        crc32_from_doc = doc["value_crc32c"].get<std::string>();
-    }
-    if (resp.fields[10].status == key_value_status_code::success) {
-        crc32_of_staging = default_json_serializer::deserialize_from_json_string<std::string>(to_string(resp.fields[10].value));
-    }
-    if (resp.fields[11].status == key_value_status_code::success) {
-        forward_compat = nlohmann::json::parse(to_string(resp.fields[11].value));
-    } else {
-        forward_compat = nlohmann::json::object();
-    }
-    if (resp.fields[12].status == key_value_status_code::success) {
-        content = to_string(resp.fields[12].value);
+std::optional<std::string>
+optional_raw_from_value(const subdoc_result& value)
+{
+    if (!value.has_value()) {
+        return std::nullopt;
     }
+    return value.raw_value;
+}
+} // namespace
 
-    transaction_links links(atr_id,
-                            atr_bucket_name,
-                            atr_scope_name,
-                            atr_collection_name,
-                            transaction_id,
-                            attempt_id,
-                            staged_content,
-                            cas_pre_txn,
-                            revid_pre_txn,
-                            exptime_pre_txn,
-                            crc32_of_staging,
-                            op,
-                            forward_compat,
+transaction_get_result
+transaction_get_result::create_from(const core::operations::lookup_in_response& resp)
+{
+    // Only the fields in the order lookup_specs() asks for them are decoded here.  restore, $document and the forward
+    // compatibility fields are json, and are kept as such until something needs them - most gets never do.
+    const auto& fields = resp.fields;
+    transaction_links links(optional_string_from_field(fields[0]),
+                            optional_string_from_field(fields[4]),
+                            optional_string_from_field(fields[5]),
+                            optional_string_from_field(fields[6]),
+                            optional_string_from_field(fields[1]),
+                            optional_string_from_field(fields[2]),
+                            optional_raw_from_field(fields[3]),
+                            optional_raw_from_field(fields[7]),
+                            optional_string_from_field(fields[10]),
+                            optional_string_from_field(fields[8]),
+                            optional_raw_from_field(fields[11]),
                             resp.deleted);
-    document_metadata md(cas_from_doc, revid_from_doc, exptime_from_doc, crc32_from_doc);
+    std::optional<document_metadata> md;
+    if (fields[9].status == key_value_status_code::success) {
+        md = document_metadata::from_document_xattr(to_string(fields[9].value));
+    }
+    std::string content;
+    if (fields[12].status == key_value_status_code::success) {
+        content = to_string(fields[12].value);
+    }
     return { { resp.ctx.bucket(), resp.ctx.scope(), resp.ctx.collection(), resp.ctx.id() },
-             content,
+             std::move(content),
              resp.cas.value(),
-             links,
-             std::make_optional(md) };
+             std::move(links),
+             std::move(md) };
 }
 
 transaction_get_result
@@ -129,20 +131,7 @@ transaction_get_result::create_from(const core::document_id& id, const result& r
     std::optional<std::string> atr_bucket_name;
     std::optional<std::string> atr_scope_name;
     std::optional<std::string> atr_collection_name;
-    std::optional<nlohmann::json> forward_compat;
-
-    // read from xattrs.txn.restore
-    std::optional<std::string> cas_pre_txn;
-    std::optional<std::string> revid_pre_txn;
-    std::optional<uint32_t> exptime_pre_txn;
     std::optional<std::string> crc32_of_staging;
-
-    // read from $document
-    std::optional<std::string> cas_from_doc;
-    std::optional<std::string> revid_from_doc;
-    std::optional<uint32_t> exptime_from_doc;
-    std::optional<std::string> crc32_from_doc;
-
     std::optional<std::string> op;
     std::string content;
 
@@ -156,7 +145,7 @@ transaction_get_result::create_from(const core::document_id& id, const result& r
         attempt_id = res.values[2].content_as<std::string>();
     }
     if (res.values[3].has_value()) {
-        staged_content = res.values[3].content_as<nlohmann::json>().dump();
+        staged_content = res.values[3].raw_value;
     }
     if (res.values[4].has_value()) {
         atr_bucket_name = res.values[4].content_as<std::string>();
@@ -167,34 +156,14 @@ transaction_get_result::create_from(const core::document_id& id, const result& r
     if (res.values[6].has_value()) {
         atr_collection_name = res.values[6].content_as<std::string>();
     }
-    if (res.values[7].has_value()) {
-        auto restore = res.values[7].content_as<nlohmann::json>();
-        cas_pre_txn = restore["CAS"].get<std::string>();
-        // only present in 6.5+
-        revid_pre_txn = restore["revid"].get<std::string>();
-        exptime_pre_txn = restore["exptime"].get<uint32_t>();
-    }
     if (res.values[8].has_value()) {
         op = res.values[8].content_as<std::string>();
     }
-    if (res.values[9].has_value()) {
-        auto doc = res.values[9].content_as<nlohmann::json>();
-        cas_from_doc = doc["CAS"].get<std::string>();
-        // only present in 6.5+
-        revid_from_doc = doc["revid"].get<std::string>();
-        exptime_from_doc = doc["exptime"].get<uint32_t>();
-        crc32_from_doc = doc["value_crc32c"].get<std::string>();
-    }
     if (res.values[10].has_value()) {
         crc32_of_staging = res.values[10].content_as<std::string>();
     }
-    if (res.values[11].has_value()) {
-        forward_compat = res.values[11].content_as<nlohmann::json>();
-    } else {
-        forward_compat = nlohmann::json::object();
-    }
     if (res.values[12].has_value()) {
-        content = res.values[12].content_as<nlohmann::json>().dump();
+        content = res.values[12].raw_value;
     }
 
     transaction_links links(atr_id,
@@ -203,15 +172,16 @@ transaction_get_result::create_from(const core::document_id& id, const result& r
                             atr_collection_name,
                             transaction_id,
                             attempt_id,
-                            staged_content,
-                            cas_pre_txn,
-                            revid_pre_txn,
-                            exptime_pre_txn,
+                            std::move(staged_content),
+                            optional_raw_from_value(res.values[7]),
                             crc32_of_staging,
                             op,
-                            forward_compat,
+                            optional_raw_from_value(res.values[11]),
                             res.is_deleted);
-    document_metadata md(cas_from_doc, revid_from_doc, exptime_from_doc, crc32_from_doc);
-    return { id, content, res.cas, links, std::make_optional(md) };
+    std::optional<document_metadata> md;
+    if (res.values[9].has_value()) {
+        md = document_metadata::from_document_xattr(res.values[9].raw_value);
+    }
+    return { id, std::move(content), res.cas, std::move(links), std::move(md) };
 }
-}; // namespace couchbase::transactions
\ No newline at end of file
+}; // namespace couchbase::transactions
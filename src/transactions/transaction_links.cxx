@@ -19,9 +19,12 @@
 std::ostream&
 couchbase::transactions::operator<<(std::ostream& os, const transaction_links& links)
 {
-    os << "transaction_links{atr: " << links.atr_id_.value_or("none") << ", atr_bkt: " << links.atr_bucket_name_.value_or("none")
-       << ", atr_coll: " << links.atr_collection_name_.value_or("none") << ", atr_scope: " << links.atr_scope_name_.value_or("none")
-       << ", txn_id: " << links.staged_transaction_id_.value_or("none") << ", attempt_id: " << links.staged_attempt_id_.value_or("none")
-       << ", crc32_of_staging:" << links.crc32_of_staging_.value_or("none") << "}";
+    os << "transaction_links{atr: " << links.view(transaction_links::ATR_ID).value_or("none")
+       << ", atr_bkt: " << links.view(transaction_links::ATR_BUCKET_NAME).value_or("none")
+       << ", atr_coll: " << links.view(transaction_links::ATR_COLLECTION_NAME).value_or("none")
+       << ", atr_scope: " << links.view(transaction_links::ATR_SCOPE_NAME).value_or("none")
+       << ", txn_id: " << links.view(transaction_links::STAGED_TRANSACTION_ID).value_or("none")
+       << ", attempt_id: " << links.view(transaction_links::STAGED_ATTEMPT_ID).value_or("none")
+       << ", crc32_of_staging:" << links.view(transaction_links::CRC32_OF_STAGING).value_or("none") << "}";
     return os;
 }
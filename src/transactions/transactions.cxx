@@ -15,21 +15,32 @@
  */
 
 #include "attempt_context_impl.hxx"
+#include "atr_ids.hxx"
+#include "atr_write_batcher.hxx"
 #include "couchbase/transactions/internal/exceptions_internal.hxx"
 #include "couchbase/transactions/internal/logging.hxx"
+#include "couchbase/transactions/internal/timer_scheduler.hxx"
 #include "couchbase/transactions/internal/transaction_context.hxx"
 #include "couchbase/transactions/internal/transactions_cleanup.hxx"
 #include "couchbase/transactions/internal/utils.hxx"
+#include "waitable_op_list.hxx"
 #include <couchbase/transactions.hxx>
 
+#include <asio/post.hpp>
+
 namespace tx = couchbase::transactions;
 
 tx::transactions::transactions(core::cluster& cluster, const transaction_config& config)
   : cluster_(cluster)
   , config_(config)
   , cleanup_(new transactions_cleanup(cluster_, config_))
+  , scheduler_(new timer_scheduler())
+  , background_ops_(new waitable_op_list())
 {
+    atr_batcher_.reset(new atr_write_batcher(cluster_, *scheduler_));
     txn_log->info("couchbase transactions {}{} creating new transaction object", VERSION_STR, VERSION_SHA);
+    // generating the ATR ids takes a little while, so do it now rather than in the first transaction.
+    atr_ids::for_config(config_);
     // if the config specifies custom metadata collection, lets be sure to open that bucket
     // on the cluster before we start.  NOTE: we actually do call get_and_open_buckets which opens all the buckets
     // on the cluster (that we have permissions to open) in the cleanup.   However, that is happening asynchronously
@@ -56,7 +67,11 @@ tx::transactions::transactions(core::cluster& cluster, const transaction_config&
     }
 }
 
-tx::transactions::~transactions() = default;
+tx::transactions::~transactions()
+{
+    // in case close was not called, as the background work would outlive what it uses
+    background_ops_->wait_and_block_ops();
+}
 
 template<typename Handler>
 tx::transaction_result
@@ -118,19 +133,71 @@ tx::transactions::run(const per_transaction_config& config, logic&& logic)
     return wrap_run(*this, config, max_attempts_, std::move(logic));
 }
 
+namespace
+{
+// Runs one attempt of an async transaction.  Rather than blocking on the outcome, the attempt either completes the
+// transaction by calling cb, or starts the next attempt from its own completion callback.
 void
-tx::transactions::run(const per_transaction_config& config, async_logic&& logic, txn_complete_callback&& cb)
+run_async_attempt(std::shared_ptr<tx::transaction_context> overall,
+                  std::shared_ptr<tx::async_logic_with_completion> logic,
+                  size_t attempts,
+                  size_t max_attempts,
+                  std::shared_ptr<tx::txn_complete_callback> cb)
 {
-    std::thread([this, config, logic = std::move(logic), cb = std::move(cb)] {
-        try {
-            auto result = wrap_run(*this, config, max_attempts_, std::move(logic));
-            return cb({}, result);
-        } catch (const transaction_exception& e) {
-            return cb(e, std::nullopt);
+    if (attempts++ >= max_attempts) {
+        // only thing to do here is return, but we really exceeded the max attempts
+        return (*cb)(std::nullopt, overall->get_transaction_result());
+    }
+    // NOTE: new_attempt_context has the exponential backoff built in, just as in wrap_run.
+    overall->new_attempt_context([overall, logic, attempts, max_attempts, cb](std::exception_ptr err) {
+        if (err) {
+            // the backoff only fails once we have run out of time
+            return (*cb)(tx::transaction_operation_failed(tx::FAIL_EXPIRY, "expired while starting new attempt")
+                           .no_rollback()
+                           .expired()
+                           .get_final_exception(*overall),
+                         std::nullopt);
         }
-    })
-      .detach();
+        auto finalize_handler = [overall, logic, attempts, max_attempts, cb](std::optional<tx::transaction_exception> err,
+                                                                             std::optional<tx::transaction_result> result) {
+            if (result || err) {
+                return (*cb)(err, result);
+            }
+            // no return value, no exception means retry.
+            run_async_attempt(overall, logic, attempts, max_attempts, cb);
+        };
+        // after a backoff we are on the timer_scheduler's thread, which must not be held up by the logic
+        asio::post(overall->cluster_ref().io_context(), [overall, logic, finalize_handler]() {
+            try {
+                auto ctx = overall->current_attempt_context();
+                (*logic)(*ctx, [overall, finalize_handler](std::exception_ptr err) {
+                    if (err) {
+                        return overall->handle_error(err, finalize_handler);
+                    }
+                    // the logic may still have operations in flight, but commit waits for those without blocking.
+                    overall->finalize(finalize_handler);
+                });
+            } catch (...) {
+                return overall->handle_error(std::current_exception(), finalize_handler);
+            }
+        });
+    });
+}
+} // namespace
+
+void
+tx::transactions::run(const per_transaction_config& config, async_logic&& logic, txn_complete_callback&& cb)
+{
+    // the logic is done once it has returned, and the ops it started - and any they started in turn - have completed
+    return run(
+      config,
+      [logic = std::move(logic)](async_attempt_context& ctx, async_attempt_context::VoidCallback&& done) {
+          logic(ctx);
+          static_cast<attempt_context_impl&>(ctx).when_ops_done([done = std::move(done)]() { done(nullptr); });
+      },
+      std::move(cb));
 }
+
 void
 tx::transactions::run(async_logic&& logic, txn_complete_callback&& cb)
 {
@@ -138,10 +205,30 @@ tx::transactions::run(async_logic&& logic, txn_complete_callback&& cb)
     return run(config, std::move(logic), std::move(cb));
 }
 
+void
+tx::transactions::run(const per_transaction_config& config, async_logic_with_completion&& logic, txn_complete_callback&& cb)
+{
+    run_async_attempt(std::make_shared<transaction_context>(*this, config),
+                      std::make_shared<async_logic_with_completion>(std::move(logic)),
+                      0,
+                      max_attempts_,
+                      std::make_shared<txn_complete_callback>(std::move(cb)));
+}
+
+void
+tx::transactions::run(async_logic_with_completion&& logic, txn_complete_callback&& cb)
+{
+    per_transaction_config config;
+    return run(config, std::move(logic), std::move(cb));
+}
+
 void
 tx::transactions::close()
 {
     txn_log->info("closing transactions");
+    // the deferred removals of ATR entries need the scheduler and batcher, so must be done first
+    background_ops_->wait_and_block_ops();
     cleanup_->close();
+    scheduler_->close();
     txn_log->info("transactions closed");
 }
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include <chrono>
 #include <functional>
+#include <set>
 
 namespace tx = couchbase::transactions;
 
@@ -55,41 +56,6 @@ tx::transactions_cleanup::transactions_cleanup(core::cluster& cluster, const tx:
     }
 }
 
-static uint64_t
-byteswap64(uint64_t val)
-{
-    size_t ii;
-    uint64_t ret = 0;
-    for (ii = 0; ii < sizeof(uint64_t); ii++) {
-        ret <<= 8ull;
-        ret |= val & 0xffull;
-        val >>= 8ull;
-    }
-    return ret;
-}
-
-/**
- * ${Mutation.CAS} is written by kvengine with
- * 'macroToString(htonll(info.cas))'.  Discussed this with KV team and, though
- * there is consensus that this is off (htonll is definitely wrong, and a string
- * is an odd choice), there are clients (SyncGateway) that consume the current
- * string, so it can't be changed.  Note that only little-endian servers are
- * supported for Couchbase, so the 8 byte long inside the string will always be
- * little-endian ordered.
- *
- * Looks like: "0x000058a71dd25c15"
- * Want:        0x155CD21DA7580000   (1539336197457313792 in base10, an epoch
- * time in millionths of a second)
- */
-static uint64_t
-parse_mutation_cas(const std::string& cas)
-{
-    if (cas.empty()) {
-        return 0;
-    }
-    return byteswap64(stoull(cas, nullptr, 16)) / 1000000;
-}
-
 static const std::string CLIENT_RECORD_DOC_ID = "_txn:client-record";
 static const std::string FIELD_RECORDS = "records";
 static const std::string FIELD_CLIENTS_ONLY = "clients";
@@ -100,9 +66,33 @@ static const std::string FIELD_OVERRIDE = "override";
 static const std::string FIELD_OVERRIDE_EXPIRES = "expires";
 static const std::string FIELD_OVERRIDE_ENABLED = "enabled";
 static const std::string FIELD_NUM_ATRS = "num_atrs";
+static const std::string FIELD_NUM_VBUCKETS = "num_vbuckets";
 
 #define SAFETY_MARGIN_EXPIRY_MS 2000
 
+// The ids of every ATR any client may be using, ours included.  Clients with the same vbucket count share the ids of
+// the first ATRs, so each id is only listed once.
+static std::vector<std::string>
+atrs_in_use(const tx::client_record_details& details, const tx::transaction_config& config)
+{
+    auto num_atrs_by_num_vbuckets = details.num_atrs_by_num_vbuckets;
+    auto& ours = num_atrs_by_num_vbuckets[static_cast<uint32_t>(config.num_vbuckets())];
+    ours = std::max(ours, static_cast<uint32_t>(config.num_atrs()));
+    std::vector<std::string> atrs;
+    std::set<std::string> seen;
+    for (const auto& [num_vbuckets, num_atrs] : num_atrs_by_num_vbuckets) {
+        if (num_atrs == 0 || num_vbuckets == 0) {
+            continue;
+        }
+        for (const auto& atr_id : tx::atr_ids::get(num_atrs, num_vbuckets).all()) {
+            if (seen.insert(atr_id).second) {
+                atrs.push_back(atr_id);
+            }
+        }
+    }
+    return atrs;
+}
+
 template<class R, class P>
 bool
 tx::transactions_cleanup::interruptable_wait(std::chrono::duration<R, P> delay)
@@ -125,7 +115,8 @@ tx::transactions_cleanup::clean_lost_attempts_in_bucket(const std::string& bucke
         return;
     }
     auto details = get_active_clients(bucket_name, client_uuid_);
-    auto all_atrs = atr_ids::all();
+    // other clients may be using more ATRs than we are, or other ids for them, so check all of theirs too
+    auto all_atrs = atrs_in_use(details, config_);
 
     // TXNCXX-232 - dynamically adjust the budget for fetching each ATR, based on how long is left of the cleanup window and how many are
     // left to fetch
@@ -294,6 +285,7 @@ tx::transactions_cleanup::get_active_clients(const std::string& bucket_name, con
               auto now_ms = now_ns_from_vbucket(hlc) / 1000000;
               details.override_enabled = false;
               details.override_expires = 0;
+              details.num_atrs_by_num_vbuckets.clear();
               if (res.values[0].status == subdoc_result::status_type::success) {
                   auto records = res.values[0].content_as<nlohmann::json>();
                   lost_attempts_cleanup_log->trace("client records: {}", records.dump());
@@ -314,6 +306,15 @@ tx::transactions_cleanup::get_active_clients(const std::string& bucket_name, con
                               auto cl = client.value();
                               uint64_t heartbeat_ms = parse_mutation_cas(cl[FIELD_HEARTBEAT].get<std::string>());
                               auto expires_ms = cl[FIELD_EXPIRES].get<uint64_t>();
+                              if (auto num_atrs = cl.find(FIELD_NUM_ATRS); num_atrs != cl.end() && num_atrs->is_number_unsigned()) {
+                                  // clients which do not record it predate it being configurable
+                                  uint32_t num_vbuckets = atr_ids::DEFAULT_NUM_VBUCKETS;
+                                  if (auto vbuckets = cl.find(FIELD_NUM_VBUCKETS); vbuckets != cl.end() && vbuckets->is_number_unsigned()) {
+                                      num_vbuckets = vbuckets->get<uint32_t>();
+                                  }
+                                  auto& most = details.num_atrs_by_num_vbuckets[num_vbuckets];
+                                  most = std::max(most, num_atrs->get<uint32_t>());
+                              }
                               auto expired_period = static_cast<int64_t>(now_ms) - static_cast<int64_t>(heartbeat_ms);
                               bool has_expired = expired_period >= static_cast<int64_t>(expires_ms) && now_ms > heartbeat_ms;
                               if (has_expired && other_client_uuid != uuid) {
@@ -355,7 +356,10 @@ tx::transactions_cleanup::get_active_clients(const std::string& bucket_name, con
                                                      config_.cleanup_window().count() / 2 + SAFETY_MARGIN_EXPIRY_MS)
                     .xattr()
                     .create_path(),
-                  couchbase::mutate_in_specs::upsert(FIELD_CLIENTS + "." + uuid + "." + FIELD_NUM_ATRS, atr_ids::all().size())
+                  couchbase::mutate_in_specs::upsert(FIELD_CLIENTS + "." + uuid + "." + FIELD_NUM_ATRS, config_.num_atrs())
+                    .xattr()
+                    .create_path(),
+                  couchbase::mutate_in_specs::upsert(FIELD_CLIENTS + "." + uuid + "." + FIELD_NUM_VBUCKETS, config_.num_vbuckets())
                     .xattr()
                     .create_path(),
               };
@@ -17,6 +17,8 @@
 #pragma once
 #include "couchbase/transactions/internal/logging.hxx"
 #include <condition_variable>
+#include <functional>
+#include <list>
 #include <mutex>
 
 namespace couchbase::transactions
@@ -72,6 +74,34 @@ class waitable_op_list
         // we have the lock.  Block all further ops
         allow_ops_ = false;
     }
+
+    // Non-blocking version of the above: once the ops already started have completed, blocks
+    // all further ops and calls cb.  Until then ops may still be started - typically from the
+    // callbacks of those in flight - and are waited for too.  If called from within an op's
+    // callback, cb will be called once that op is done, so this never deadlocks an io thread.
+    void wait_and_block_ops(std::function<void()>&& cb)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (0 == count_) {
+            allow_ops_ = false;
+            lock.unlock();
+            return cb();
+        }
+        ops_waiters_.push_back(std::move(cb));
+    }
+
+    // Calls cb once the ops already started, and any they start in turn, have completed - but
+    // unlike wait_and_block_ops, leaves further ops allowed.
+    void when_ops_done(std::function<void()>&& cb)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (0 == count_) {
+            lock.unlock();
+            return cb();
+        }
+        idle_waiters_.push_back(std::move(cb));
+    }
+
     attempt_mode get_mode()
     {
         std::unique_lock<std::mutex> lock(mutex_);
@@ -149,8 +179,9 @@ class waitable_op_list
   private:
     void change_count(int32_t val)
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (allow_ops_) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // ops already started may still complete after the ops are blocked
+        if (allow_ops_ || val < 0) {
             count_ += val;
             if (val > 0) {
                 in_flight_ += val;
@@ -164,6 +195,23 @@ class waitable_op_list
             if (0 == in_flight_) {
                 cv_in_flight_.notify_all();
             }
+            if (0 == count_ && !(ops_waiters_.empty() && idle_waiters_.empty())) {
+                auto idle_waiters = std::move(idle_waiters_);
+                idle_waiters_.clear();
+                auto waiters = std::move(ops_waiters_);
+                ops_waiters_.clear();
+                if (!waiters.empty()) {
+                    // nothing left in flight, so now we block
+                    allow_ops_ = false;
+                }
+                lock.unlock();
+                for (auto& waiter : idle_waiters) {
+                    waiter();
+                }
+                for (auto& waiter : waiters) {
+                    waiter();
+                }
+            }
         } else {
             txn_log->error("operation attempted after commit/rollback");
             throw async_operation_conflict("Operation attempted after commit or rollback");
@@ -179,5 +227,7 @@ class waitable_op_list
     std::condition_variable cv_query_;
     std::condition_variable cv_in_flight_;
     std::mutex mutex_;
+    std::list<std::function<void()>> ops_waiters_;
+    std::list<std::function<void()>> idle_waiters_;
 };
 }; // namespace couchbase::transactions
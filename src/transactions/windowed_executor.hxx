@@ -0,0 +1,131 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "couchbase/transactions/internal/exceptions_internal.hxx"
+
+namespace couchbase
+{
+namespace transactions
+{
+    /**
+     * Runs an asynchronous operation over a range of items, with at most `window` operations in flight at once.
+     *
+     * Every operation must call its callback exactly once.  Once any operation reports a failure, no new operations
+     * are started.  When all the operations in flight have completed, the handler is called with every failure seen.
+     * That list is empty if all operations succeeded.
+     *
+     * The range must outlive the run, which ends when the handler is called.
+     */
+    template<typename Iterator>
+    class windowed_executor : public std::enable_shared_from_this<windowed_executor<Iterator>>
+    {
+      public:
+        using item_type = typename std::iterator_traits<Iterator>::reference;
+        using item_callback = std::function<void(std::optional<transaction_operation_failed>)>;
+        using operation = std::function<void(item_type, item_callback&&)>;
+        using handler = std::function<void(std::list<transaction_operation_failed>)>;
+
+        static void run(Iterator begin, Iterator end, size_t window, operation&& op, handler&& done)
+        {
+            std::shared_ptr<windowed_executor> executor(new windowed_executor(begin, end, window, std::move(op), std::move(done)));
+            executor->pump();
+        }
+
+      private:
+        std::mutex mutex_;
+        Iterator next_;
+        Iterator end_;
+        size_t window_;
+        size_t in_flight_{ 0 };
+        bool finished_{ false };
+        bool pumping_{ false };
+        operation op_;
+        handler done_;
+        std::list<transaction_operation_failed> errors_;
+
+        windowed_executor(Iterator begin, Iterator end, size_t window, operation&& op, handler&& done)
+          : next_(begin)
+          , end_(end)
+          , window_(std::max<size_t>(window, 1))
+          , op_(std::move(op))
+          , done_(std::move(done))
+        {
+        }
+
+        // Must be called with mutex_ held.  Returns true once nothing is in flight and nothing more will start.
+        bool finish_if_idle()
+        {
+            if (in_flight_ == 0 && (next_ == end_ || !errors_.empty())) {
+                finished_ = true;
+                return true;
+            }
+            return false;
+        }
+
+        // Starts operations until the window is full or there are none left.  Only one caller does that at a time: an
+        // operation completing while another is pumping - synchronously from within op_, say - just leaves its result for
+        // the loop already running to pick up, rather than starting the next operation further down the stack.
+        void pump()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (pumping_ || finished_) {
+                return;
+            }
+            pumping_ = true;
+            while (true) {
+                if (finish_if_idle()) {
+                    pumping_ = false;
+                    lock.unlock();
+                    return done_(std::move(errors_));
+                }
+                if (in_flight_ >= window_ || next_ == end_ || !errors_.empty()) {
+                    pumping_ = false;
+                    return;
+                }
+                in_flight_++;
+                auto it = next_++;
+                lock.unlock();
+                op_(*it, [self = this->shared_from_this()](std::optional<transaction_operation_failed> err) {
+                    self->completed(std::move(err));
+                });
+                lock.lock();
+            }
+        }
+
+        void completed(std::optional<transaction_operation_failed> err)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                in_flight_--;
+                if (err) {
+                    errors_.push_back(*err);
+                }
+            }
+            pump();
+        }
+    };
+} // namespace transactions
+} // namespace couchbase
@@ -0,0 +1,214 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../transactions/transactions_env.h"
+#include <couchbase/transactions/awaitable.hxx>
+
+#include <gtest/gtest.h>
+#include <spdlog/spdlog.h>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#ifndef COUCHBASE_TRANSACTIONS_HAS_COROUTINES
+#error "the coroutine tests must be compiled with coroutine support"
+#endif
+
+using namespace couchbase::transactions;
+
+static const nlohmann::json coro_content = nlohmann::json::parse("{\"some\": \"thing\"}");
+static const nlohmann::json coro_new_content = nlohmann::json::parse("{\"shiny\": \"and new\"}");
+
+namespace
+{
+// A coroutine which starts straight away, so a test can wait for it to finish, and see anything it threw.
+struct test_task {
+    struct promise_type {
+        std::shared_ptr<std::promise<void>> finished = std::make_shared<std::promise<void>>();
+
+        test_task get_return_object()
+        {
+            return { finished->get_future() };
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void()
+        {
+            finished->set_value();
+        }
+        void unhandled_exception()
+        {
+            finished->set_exception(std::current_exception());
+        }
+    };
+
+    std::future<void> finished;
+
+    void get()
+    {
+        finished.get();
+    }
+};
+
+// the awaiters cannot be moved, so each is made inside the coroutine awaiting it
+test_task
+await_value(internal::operation_awaiter<int>::starter start, std::optional<int>& out)
+{
+    out = co_await internal::operation_awaiter<int>(std::move(start));
+}
+
+test_task
+await_void(std::function<void(async_attempt_context::VoidCallback&&)> start)
+{
+    co_await internal::void_awaiter(std::move(start));
+}
+
+attempt_task
+replace_logic(awaitable_attempt_context ctx, couchbase::core::document_id id, couchbase::core::document_id inserted_id)
+{
+    auto doc = co_await ctx.get(id);
+    EXPECT_EQ(doc.content<nlohmann::json>(), coro_content);
+    co_await ctx.replace(doc, coro_new_content);
+    co_await ctx.insert(inserted_id, coro_content);
+}
+
+attempt_task
+explicit_commit_logic(awaitable_attempt_context ctx, couchbase::core::document_id id)
+{
+    auto doc = co_await ctx.get(id);
+    co_await ctx.replace(doc, coro_new_content);
+    co_await ctx.commit();
+}
+
+attempt_task
+failing_logic(awaitable_attempt_context ctx, couchbase::core::document_id inserted_id, couchbase::core::document_id missing_id)
+{
+    co_await ctx.insert(inserted_id, coro_content);
+    // this throws, and we let it propagate out of the attempt
+    co_await ctx.get(missing_id);
+    ADD_FAILURE() << "get of a missing document should have thrown";
+}
+
+attempt_task
+get_optional_logic(awaitable_attempt_context ctx, couchbase::core::document_id missing_id, std::shared_ptr<bool> found)
+{
+    auto doc = co_await ctx.get_optional(missing_id);
+    *found = doc.has_value();
+}
+
+test_task
+run_logic(transactions& txns, coroutine_logic logic)
+{
+    co_await run_async(txns, std::move(logic));
+}
+} // namespace
+
+TEST(OperationAwaiter, ResumesWhenCompletedBeforeSuspending)
+{
+    std::optional<int> out;
+    auto task = await_value([](auto&& cb) { cb(nullptr, 42); }, out);
+    task.get();
+    ASSERT_EQ(42, out.value());
+}
+
+TEST(OperationAwaiter, ResumesWhenCompletedLater)
+{
+    std::optional<int> out;
+    internal::operation_awaiter<int>::callback pending;
+    auto task = await_value([&pending](auto&& cb) { pending = std::move(cb); }, out);
+    ASSERT_EQ(std::future_status::timeout, task.finished.wait_for(std::chrono::milliseconds(10)));
+    std::thread([&pending]() { pending(nullptr, 7); }).join();
+    task.get();
+    ASSERT_EQ(7, out.value());
+}
+
+TEST(OperationAwaiter, RethrowsError)
+{
+    std::optional<int> out;
+    auto task = await_value([](auto&& cb) { cb(std::make_exception_ptr(std::runtime_error("boom")), std::nullopt); }, out);
+    ASSERT_THROW(task.get(), std::runtime_error);
+    ASSERT_FALSE(out);
+}
+
+TEST(OperationAwaiter, VoidAwaiterRethrowsError)
+{
+    ASSERT_NO_THROW(await_void([](auto&& cb) { cb(nullptr); }).get());
+    auto task = await_void([](auto&& cb) { cb(std::make_exception_ptr(std::logic_error("boom"))); });
+    ASSERT_THROW(task.get(), std::logic_error);
+}
+
+TEST(CoroutineTxns, GetReplaceInsertCommits)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto id = TransactionsTestEnvironment::get_document_id();
+    auto inserted_id = TransactionsTestEnvironment::get_document_id();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, coro_content.dump()));
+    run_logic(txns, [id, inserted_id](awaitable_attempt_context ctx) { return replace_logic(ctx, id, inserted_id); }).get();
+    ASSERT_EQ(TransactionsTestEnvironment::get_doc(id).content_as<nlohmann::json>(), coro_new_content);
+    ASSERT_EQ(TransactionsTestEnvironment::get_doc(inserted_id).content_as<nlohmann::json>(), coro_content);
+}
+
+TEST(CoroutineTxns, ExplicitCommit)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto id = TransactionsTestEnvironment::get_document_id();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, coro_content.dump()));
+    run_logic(txns, [id](awaitable_attempt_context ctx) { return explicit_commit_logic(ctx, id); }).get();
+    ASSERT_EQ(TransactionsTestEnvironment::get_doc(id).content_as<nlohmann::json>(), coro_new_content);
+}
+
+TEST(CoroutineTxns, ErrorPropagatesAndRollsBack)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto inserted_id = TransactionsTestEnvironment::get_document_id();
+    auto missing_id = TransactionsTestEnvironment::get_document_id();
+    auto task =
+      run_logic(txns, [inserted_id, missing_id](awaitable_attempt_context ctx) { return failing_logic(ctx, inserted_id, missing_id); });
+    try {
+        task.get();
+        FAIL() << "expected transaction_exception";
+    } catch (const transaction_exception& e) {
+        ASSERT_EQ(e.type(), failure_type::FAIL);
+    }
+    ASSERT_THROW(TransactionsTestEnvironment::get_doc(inserted_id), client_error);
+}
+
+TEST(CoroutineTxns, GetOptionalOfMissingDoc)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto missing_id = TransactionsTestEnvironment::get_document_id();
+    auto found = std::make_shared<bool>(true);
+    run_logic(txns, [missing_id, found](awaitable_attempt_context ctx) { return get_optional_logic(ctx, missing_id, found); }).get();
+    ASSERT_FALSE(*found);
+}
+
+int
+main(int argc, char* argv[])
+{
+    testing::InitGoogleTest(&argc, argv);
+    testing::AddGlobalTestEnvironment(new TransactionsTestEnvironment());
+    spdlog::set_level(spdlog::level::trace);
+    return RUN_ALL_TESTS();
+}
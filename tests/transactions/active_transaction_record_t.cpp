@@ -0,0 +1,91 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/active_transaction_record.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+using namespace couchbase::transactions;
+
+TEST(ParseMutationCas, DecodesLittleEndianHex)
+{
+    ASSERT_EQ(1539336197457ull, parse_mutation_cas("0x000058a71dd25c15"));
+    ASSERT_EQ(1539336197457ull, parse_mutation_cas("0x000058A71DD25C15"));
+    ASSERT_EQ(0ull, parse_mutation_cas(""));
+}
+
+TEST(ActiveTransactionRecord, ParsesAttempts)
+{
+    auto raw = std::make_shared<const std::string>(R"({
+        "a1": { "st": "COMMITTED", "tst": "0x000058a71dd25c15", "exp": 15000, "d": "m", "unknown": [1, { "x": null }],
+                "ins": [ { "id": "k\"1", "bkt": "b", "scp": "_default", "col": "_default" } ], "rep": [],
+                "fc": { "x": [ { "a": "]}" } ] } },
+        "a2": { "st": "PENDING" }
+    })");
+    auto entries = active_transaction_record::parse_attempts("b", "_txn:atr-1", raw, 42);
+    ASSERT_EQ(2, entries.size());
+    // the entries keep the buffer alive
+    raw.reset();
+
+    const auto& first = entries[0];
+    ASSERT_EQ("a1", first.attempt_id());
+    ASSERT_EQ("_txn:atr-1", first.atr_id());
+    ASSERT_EQ(attempt_state::COMMITTED, first.state());
+    ASSERT_EQ(1539336197457ull, first.timestamp_start_ms().value());
+    ASSERT_EQ(15000, first.expires_after_ms().value());
+    ASSERT_EQ("m", first.durability_level().value());
+    ASSERT_EQ(42, first.cas());
+    auto inserted = first.inserted_ids();
+    ASSERT_TRUE(inserted);
+    ASSERT_EQ(1, inserted->size());
+    ASSERT_EQ("k\"1", inserted->front().id());
+    ASSERT_TRUE(first.replaced_ids());
+    ASSERT_TRUE(first.replaced_ids()->empty());
+    ASSERT_FALSE(first.removed_ids());
+    ASSERT_EQ("]}", first.forward_compat().value()["x"][0]["a"]);
+
+    const auto& second = entries[1];
+    ASSERT_EQ(attempt_state::PENDING, second.state());
+    ASSERT_FALSE(second.inserted_ids());
+    ASSERT_FALSE(second.forward_compat());
+    ASSERT_FALSE(second.expires_after_ms());
+}
+
+TEST(ActiveTransactionRecord, RejectsCorruptAttempts)
+{
+    ASSERT_TRUE(active_transaction_record::parse_attempts("b", "k", std::make_shared<const std::string>("{}"), 0).empty());
+    ASSERT_THROW(active_transaction_record::parse_attempts("b", "k", std::make_shared<const std::string>(R"({"a":{"tst":""}})"), 0),
+                 std::runtime_error);
+    ASSERT_THROW(active_transaction_record::parse_attempts("b", "k", std::make_shared<const std::string>(R"({"a":{"st":"PENDING")"), 0),
+                 std::runtime_error);
+}
+
+TEST(ActiveTransactionRecord, ParsesSingleEntry)
+{
+    auto raw = std::make_shared<const std::string>(R"({ "st": "ABORTED", "tst": "0x000058a71dd25c15", "rem": [] })");
+    auto entry = active_transaction_record::parse_entry("b", "_txn:atr-1", "a1", raw, 42);
+    ASSERT_EQ("a1", entry.attempt_id());
+    ASSERT_EQ(attempt_state::ABORTED, entry.state());
+    ASSERT_TRUE(entry.removed_ids());
+    ASSERT_FALSE(entry.inserted_ids());
+
+    auto summary = entry.without_doc_lists();
+    ASSERT_EQ(attempt_state::ABORTED, summary.state());
+    ASSERT_FALSE(summary.removed_ids());
+}
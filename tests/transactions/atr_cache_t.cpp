@@ -0,0 +1,202 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/atr_cache.hxx"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace couchbase::transactions;
+
+namespace
+{
+const couchbase::core::document_id atr_id{ "b", "s", "c", "_txn:atr-1-#5" };
+
+atr_entry
+entry(const std::string& attempt_id, attempt_state state)
+{
+    return { "b",          "_txn:atr-1-#5", attempt_id, state, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+             std::nullopt, nullptr,         {},         {},    {},           {},           0,            std::nullopt };
+}
+
+// holds on to each fetch, for the test to complete when it likes
+struct fake_fetches {
+    struct fetch {
+        std::string attempt_id;
+        atr_cache::fetch_callback cb;
+    };
+    std::vector<fetch> pending;
+
+    atr_cache::fetcher fetcher()
+    {
+        return [this](couchbase::core::cluster&, const couchbase::core::document_id&, const std::string& attempt_id, auto&& cb) {
+            pending.push_back({ attempt_id, std::move(cb) });
+        };
+    }
+};
+
+struct results {
+    std::vector<std::optional<atr_entry>> entries;
+    std::vector<std::error_code> errors;
+
+    atr_cache::entry_callback callback()
+    {
+        return [this](std::error_code ec, std::optional<atr_entry> entry) {
+            errors.push_back(ec);
+            entries.push_back(std::move(entry));
+        };
+    }
+};
+
+class AtrCache : public ::testing::Test
+{
+  protected:
+    asio::io_context io;
+    std::shared_ptr<couchbase::core::cluster> cluster = couchbase::core::cluster::create(io);
+    fake_fetches fetches;
+    atr_cache cache{ fetches.fetcher() };
+};
+} // namespace
+
+TEST_F(AtrCache, ConcurrentGetsShareOneFetch)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    cache.get_entry(*cluster, atr_id, "a1", true, got.callback());
+    ASSERT_EQ(1, fetches.pending.size());
+    ASSERT_TRUE(got.entries.empty());
+
+    fetches.pending[0].cb({}, entry("a1", attempt_state::PENDING), 10);
+    ASSERT_EQ(3, got.entries.size());
+    for (const auto& e : got.entries) {
+        ASSERT_EQ(attempt_state::PENDING, e->state());
+    }
+}
+
+TEST_F(AtrCache, DifferentAttemptsFetchedSeparately)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    cache.get_entry(*cluster, atr_id, "a2", false, got.callback());
+    cache.get_entry(*cluster, { "b", "s", "c", "_txn:atr-2-#6" }, "a1", false, got.callback());
+    ASSERT_EQ(3, fetches.pending.size());
+    ASSERT_EQ("a2", fetches.pending[1].attempt_id);
+}
+
+TEST_F(AtrCache, ResolvedEntryIsCached)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    fetches.pending[0].cb({}, entry("a1", attempt_state::COMMITTED), 10);
+
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    ASSERT_EQ(1, fetches.pending.size());
+    ASSERT_EQ(2, got.entries.size());
+    ASSERT_EQ(attempt_state::COMMITTED, got.entries.back()->state());
+
+    // COMMITTED is not finished, so this must ask the ATR again
+    cache.get_entry(*cluster, atr_id, "a1", true, got.callback());
+    ASSERT_EQ(2, fetches.pending.size());
+}
+
+TEST_F(AtrCache, UnresolvedEntryIsNotCached)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    fetches.pending[0].cb({}, entry("a1", attempt_state::PENDING), 10);
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    ASSERT_EQ(2, fetches.pending.size());
+}
+
+TEST_F(AtrCache, ErrorIsPassedOnAndNotCached)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    fetches.pending[0].cb(couchbase::errc::key_value::path_invalid, std::nullopt, 0);
+    ASSERT_EQ(2, got.errors.size());
+    ASSERT_EQ(couchbase::errc::key_value::path_invalid, got.errors[0]);
+    ASSERT_EQ(couchbase::errc::key_value::path_invalid, got.errors[1]);
+    ASSERT_FALSE(got.entries[0]);
+
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    ASSERT_EQ(2, fetches.pending.size());
+}
+
+TEST_F(AtrCache, LaterCasWins)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    fetches.pending[0].cb({}, entry("a1", attempt_state::COMMITTED), 20);
+
+    // a fetch which read the ATR before the cached one did changes nothing
+    cache.get_entry(*cluster, atr_id, "a1", true, got.callback());
+    fetches.pending[1].cb({}, entry("a1", attempt_state::COMPLETED), 10);
+    cache.get_entry(*cluster, atr_id, "a1", true, got.callback());
+    ASSERT_EQ(3, fetches.pending.size());
+
+    // and one which read it after replaces it
+    fetches.pending[2].cb({}, entry("a1", attempt_state::COMPLETED), 30);
+    cache.get_entry(*cluster, atr_id, "a1", true, got.callback());
+    ASSERT_EQ(3, fetches.pending.size());
+    ASSERT_EQ(attempt_state::COMPLETED, got.entries.back()->state());
+}
+
+TEST_F(AtrCache, SecondCallbackOfAFetchIsIgnored)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    auto cb = fetches.pending[0].cb;
+    cb({}, entry("a1", attempt_state::PENDING), 10);
+    cb({}, entry("a1", attempt_state::PENDING), 10);
+    ASSERT_EQ(1, got.entries.size());
+}
+
+TEST_F(AtrCache, ClearDropsCachedEntries)
+{
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    fetches.pending[0].cb({}, entry("a1", attempt_state::ROLLED_BACK), 10);
+    cache.clear();
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    ASSERT_EQ(2, fetches.pending.size());
+}
+
+TEST_F(AtrCache, SameAtrOnAnotherClusterIsSeparate)
+{
+    auto other = couchbase::core::cluster::create(io);
+    results got;
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    fetches.pending[0].cb({}, entry("a1", attempt_state::COMMITTED), 10);
+
+    // neither the cached entry nor a fetch in progress is shared with the other cluster
+    cache.get_entry(*other, atr_id, "a1", false, got.callback());
+    ASSERT_EQ(2, fetches.pending.size());
+    cache.get_entry(*cluster, atr_id, "a2", false, got.callback());
+    cache.get_entry(*other, atr_id, "a2", false, got.callback());
+    ASSERT_EQ(4, fetches.pending.size());
+
+    fetches.pending[1].cb({}, entry("a1", attempt_state::ABORTED), 20);
+    cache.get_entry(*cluster, atr_id, "a1", false, got.callback());
+    cache.get_entry(*other, atr_id, "a1", false, got.callback());
+    ASSERT_EQ(4, fetches.pending.size());
+    ASSERT_EQ(attempt_state::COMMITTED, got.entries[got.entries.size() - 2]->state());
+    ASSERT_EQ(attempt_state::ABORTED, got.entries.back()->state());
+}
@@ -0,0 +1,49 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/atr_ids.hxx"
+
+#include <gtest/gtest.h>
+
+using namespace couchbase::transactions;
+
+TEST(AtrIds, DefaultsMatchOtherSdks)
+{
+    const auto& ids = atr_ids::get();
+    ASSERT_EQ(1024, ids.all().size());
+    ASSERT_EQ("_txn:atr-0-#14", ids.all()[0]);
+    ASSERT_EQ("_txn:atr-77-#58b8", ids.all()[77]);
+    ASSERT_EQ("_txn:atr-1023-#10c2", ids.all()[1023]);
+}
+
+TEST(AtrIds, AtrsAreOnTheirVbuckets)
+{
+    const auto& ids = atr_ids::get(2048, 64);
+    ASSERT_EQ(2048, ids.all().size());
+    for (size_t i = 0; i < ids.all().size(); ++i) {
+        ASSERT_EQ(i % 64, ids.vbucket_for_key(ids.all()[i]));
+    }
+    auto vbucket = ids.vbucket_for_key("somekey");
+    ASSERT_EQ(vbucket, ids.vbucket_for_key(ids.atr_id_for_vbucket(vbucket)));
+}
+
+TEST(AtrIds, FewerAtrsThanVbuckets)
+{
+    const auto& ids = atr_ids::get(16, 1024);
+    ASSERT_EQ(16, ids.all().size());
+    ASSERT_EQ(ids.all()[1000 % 16], ids.atr_id_for_vbucket(1000));
+    ASSERT_THROW(ids.atr_id_for_vbucket(1024), std::invalid_argument);
+}
@@ -0,0 +1,73 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/atr_ids.hxx"
+#include "../../src/transactions/atr_selector.hxx"
+
+#include <couchbase/transactions/transaction_config.hxx>
+
+#include <gtest/gtest.h>
+
+using namespace couchbase::transactions;
+
+TEST(AtrSelector, UsesUsualAtrWhenFree)
+{
+    transaction_config config;
+    atr_selector::lease claim;
+    auto atr_id = atr_selector::instance().select(config, "selector-free", 5, claim);
+    ASSERT_EQ(atr_ids::get().atr_id_for_vbucket(5), atr_id.key());
+    ASSERT_EQ(1, atr_selector::instance().in_flight(atr_id));
+    claim.reset();
+    ASSERT_EQ(0, atr_selector::instance().in_flight(atr_id));
+}
+
+TEST(AtrSelector, AvoidsAtrsInUse)
+{
+    transaction_config config;
+    atr_selector::lease first;
+    atr_selector::lease second;
+    auto first_id = atr_selector::instance().select(config, "selector-busy", 5, first);
+    auto second_id = atr_selector::instance().select(config, "selector-busy", 5, second);
+    ASSERT_NE(first_id.key(), second_id.key());
+
+    first.reset();
+    atr_selector::lease third;
+    ASSERT_EQ(first_id.key(), atr_selector::instance().select(config, "selector-busy", 5, third).key());
+}
+
+TEST(AtrSelector, PrefersAtrsOnTheSameVbucket)
+{
+    transaction_config config;
+    config.num_atrs(2048);
+    atr_selector::lease first;
+    atr_selector::lease second;
+    atr_selector::instance().select(config, "selector-vbucket", 7, first);
+    auto second_id = atr_selector::instance().select(config, "selector-vbucket", 7, second);
+    ASSERT_EQ(atr_ids::for_config(config).all()[7 + 1024], second_id.key());
+}
+
+TEST(AtrSelector, AvoidsFullAtrs)
+{
+    transaction_config config;
+    const auto& ids = atr_ids::get();
+    // the usual ATR and all its neighbours are full
+    for (size_t i = 0; i <= atr_selector::NEIGHBOURS; ++i) {
+        atr_selector::instance().mark_full(config.atr_id_from_bucket_and_key("selector-full", ids.all()[9 + i]));
+    }
+    atr_selector::lease claim;
+    auto atr_id = atr_selector::instance().select(config, "selector-full", 9, claim);
+    ASSERT_EQ(ids.all()[9 + atr_selector::NEIGHBOURS + 1], atr_id.key());
+}
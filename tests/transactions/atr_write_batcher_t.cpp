@@ -0,0 +1,313 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/atr_write_batcher.hxx"
+#include "couchbase/transactions/internal/timer_scheduler.hxx"
+
+#include <core/error_context/key_value.hxx>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace couchbase::transactions;
+
+namespace
+{
+const couchbase::core::document_id atr_id{ "b", "s", "c", "_txn:atr-1-#5" };
+
+atr_write_batcher::write
+attempt_write(const std::string& attempt_id, std::size_t specs, bool creates_atr)
+{
+    couchbase::core::operations::mutate_in_request req{ atr_id };
+    for (std::size_t i = 0; i < specs; ++i) {
+        auto spec =
+          couchbase::mutate_in_specs{ couchbase::mutate_in_specs::upsert("attempts." + attempt_id + ".f" + std::to_string(i), 0).xattr() }
+            .specs();
+        req.specs.insert(req.specs.end(), spec.begin(), spec.end());
+    }
+    return { std::move(req), creates_atr, [](couchbase::core::operations::mutate_in_response) {} };
+}
+
+// a response with one field per spec of req
+couchbase::core::operations::mutate_in_response
+succeeded(const couchbase::core::operations::mutate_in_request& req)
+{
+    couchbase::core::operations::mutate_in_response resp;
+    resp.fields.resize(req.specs.size());
+    for (std::size_t i = 0; i < req.specs.size(); ++i) {
+        resp.fields[i].path = req.specs[i].path_;
+    }
+    return resp;
+}
+
+couchbase::core::operations::mutate_in_response
+failed(std::error_code ec)
+{
+    couchbase::core::operations::mutate_in_response resp;
+    auto ctx = couchbase::core::make_key_value_error_context(ec, atr_id);
+    resp.ctx = couchbase::core::make_subdocument_error_context(ctx, ec, {}, {}, false);
+    return resp;
+}
+
+// holds on to each request, for the test to answer when it likes
+struct fake_sender {
+    struct sent {
+        couchbase::core::operations::mutate_in_request req;
+        atr_write_batcher::callback cb;
+    };
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<sent> requests;
+
+    atr_write_batcher::sender sender()
+    {
+        return [this](couchbase::core::operations::mutate_in_request req, atr_write_batcher::callback&& cb) {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back({ std::move(req), std::move(cb) });
+            cv.notify_all();
+        };
+    }
+
+    // waits a while for count requests to have been sent, returning how many have
+    std::size_t wait_for(std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(5), [&]() { return requests.size() >= count; });
+        return requests.size();
+    }
+
+    // answers request i, which must be answered outside the lock, as the batcher may send more from its callback
+    void answer(std::size_t i, couchbase::core::operations::mutate_in_response resp)
+    {
+        atr_write_batcher::callback cb;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cb = std::move(requests.at(i).cb);
+        }
+        cb(std::move(resp));
+    }
+
+    std::size_t specs_of(std::size_t i)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requests.at(i).req.specs.size();
+    }
+};
+
+struct responses {
+    std::vector<std::optional<couchbase::core::operations::mutate_in_response>> got;
+
+    explicit responses(std::size_t count)
+      : got(count)
+    {
+    }
+
+    atr_write_batcher::callback callback(std::size_t i)
+    {
+        return [this, i](couchbase::core::operations::mutate_in_response resp) { got[i] = std::move(resp); };
+    }
+};
+
+void
+execute(atr_write_batcher& batcher,
+        const std::string& attempt_id,
+        std::size_t specs,
+        std::chrono::microseconds window,
+        atr_write_batcher::callback&& cb)
+{
+    auto w = attempt_write(attempt_id, specs, false);
+    batcher.execute(std::move(w.req), false, window, std::move(cb));
+}
+
+class AtrWriteBatcherExecute : public ::testing::Test
+{
+  protected:
+    timer_scheduler scheduler;
+    fake_sender sender;
+    std::unique_ptr<atr_write_batcher> batcher = std::make_unique<atr_write_batcher>(sender.sender(), scheduler);
+
+    void TearDown() override
+    {
+        // as transactions does, run what is scheduled while the batcher is still there for it
+        scheduler.close();
+    }
+};
+} // namespace
+
+TEST(AtrWriteBatcher, MergesSpecsInOrder)
+{
+    std::vector<atr_write_batcher::write> writes;
+    writes.push_back(attempt_write("a1", 3, false));
+    writes.push_back(attempt_write("a2", 2, false));
+    std::vector<std::size_t> offsets;
+    auto req = atr_write_batcher::merge(writes, offsets);
+    ASSERT_EQ(5, req.specs.size());
+    ASSERT_EQ((std::vector<std::size_t>{ 0, 3 }), offsets);
+    ASSERT_EQ("_txn:atr-1-#5", req.id.key());
+    ASSERT_EQ(couchbase::store_semantics::replace, req.store_semantics);
+}
+
+TEST(AtrWriteBatcher, SetsBodyOnceWhenCreatingAtr)
+{
+    std::vector<atr_write_batcher::write> writes;
+    writes.push_back(attempt_write("a1", 5, true));
+    writes.push_back(attempt_write("a2", 5, true));
+    writes.push_back(attempt_write("a3", 1, false));
+    std::vector<std::size_t> offsets;
+    auto req = atr_write_batcher::merge(writes, offsets);
+    ASSERT_EQ(12, req.specs.size());
+    ASSERT_EQ((std::vector<std::size_t>{ 0, 5, 10 }), offsets);
+    ASSERT_EQ(couchbase::store_semantics::upsert, req.store_semantics);
+}
+
+TEST(AtrWriteBatcher, SlicesResponse)
+{
+    couchbase::core::operations::mutate_in_response resp;
+    resp.fields.resize(5);
+    for (std::size_t i = 0; i < resp.fields.size(); ++i) {
+        resp.fields[i].path = "f" + std::to_string(i);
+    }
+    auto first = atr_write_batcher::slice(resp, 0, 3);
+    ASSERT_EQ(3, first.fields.size());
+    ASSERT_EQ("f0", first.fields.front().path);
+    auto second = atr_write_batcher::slice(resp, 3, 2);
+    ASSERT_EQ(2, second.fields.size());
+    ASSERT_EQ("f3", second.fields.front().path);
+    ASSERT_EQ("f4", second.fields.back().path);
+    // nothing to slice when the server sent back fewer fields than asked for
+    ASSERT_TRUE(atr_write_batcher::slice(resp, 5, 1).fields.empty());
+}
+
+TEST_F(AtrWriteBatcherExecute, NoWindowSendsStraightAway)
+{
+    responses r(1);
+    execute(*batcher, "a1", 2, std::chrono::microseconds(0), r.callback(0));
+    ASSERT_EQ(1, sender.requests.size());
+    sender.answer(0, succeeded(sender.requests[0].req));
+    ASSERT_EQ(2, r.got[0]->fields.size());
+}
+
+TEST_F(AtrWriteBatcherExecute, FlushesWhenWindowEnds)
+{
+    responses r(2);
+    execute(*batcher, "a1", 3, std::chrono::milliseconds(20), r.callback(0));
+    execute(*batcher, "a2", 2, std::chrono::milliseconds(20), r.callback(1));
+    ASSERT_EQ(1, sender.wait_for(1));
+    ASSERT_EQ(5, sender.specs_of(0));
+
+    // each gets its own part of the response
+    sender.answer(0, succeeded(sender.requests[0].req));
+    ASSERT_EQ(3, r.got[0]->fields.size());
+    ASSERT_EQ("attempts.a1.f0", r.got[0]->fields.front().path);
+    ASSERT_EQ(2, r.got[1]->fields.size());
+    ASSERT_EQ("attempts.a2.f0", r.got[1]->fields.front().path);
+}
+
+TEST_F(AtrWriteBatcherExecute, SendsFullBatchWithoutWaiting)
+{
+    responses r(3);
+    execute(*batcher, "a1", 10, std::chrono::milliseconds(500), r.callback(0));
+    ASSERT_EQ(0, sender.requests.size());
+    // this would take it over MAX_SPECS, so the batch goes without it, and it starts the next
+    execute(*batcher, "a2", 10, std::chrono::milliseconds(500), r.callback(1));
+    ASSERT_EQ(1, sender.requests.size());
+    ASSERT_EQ(10, sender.specs_of(0));
+    // and this fills the next one exactly
+    execute(*batcher, "a3", atr_write_batcher::MAX_SPECS - 10, std::chrono::milliseconds(500), r.callback(2));
+    ASSERT_EQ(2, sender.requests.size());
+    ASSERT_EQ(atr_write_batcher::MAX_SPECS, sender.specs_of(1));
+}
+
+TEST_F(AtrWriteBatcherExecute, ResendsEachAloneWhenMergedWriteFails)
+{
+    responses r(2);
+    execute(*batcher, "a1", 3, std::chrono::milliseconds(1), r.callback(0));
+    execute(*batcher, "a2", 2, std::chrono::milliseconds(1), r.callback(1));
+    ASSERT_EQ(1, sender.wait_for(1));
+
+    sender.answer(0, failed(couchbase::errc::key_value::path_exists));
+    ASSERT_FALSE(r.got[0]);
+    ASSERT_FALSE(r.got[1]);
+    ASSERT_EQ(3, sender.wait_for(3));
+    ASSERT_EQ(3, sender.specs_of(1));
+    ASSERT_EQ(2, sender.specs_of(2));
+
+    // now each has an outcome of its own
+    sender.answer(1, failed(couchbase::errc::key_value::path_exists));
+    sender.answer(2, succeeded(sender.requests[2].req));
+    ASSERT_EQ(couchbase::errc::key_value::path_exists, r.got[0]->ctx.ec());
+    ASSERT_FALSE(r.got[1]->ctx.ec());
+    ASSERT_EQ(2, r.got[1]->fields.size());
+}
+
+TEST_F(AtrWriteBatcherExecute, AmbiguousFailureGoesToEveryWrite)
+{
+    responses r(2);
+    execute(*batcher, "a1", 3, std::chrono::milliseconds(1), r.callback(0));
+    execute(*batcher, "a2", 2, std::chrono::milliseconds(1), r.callback(1));
+    ASSERT_EQ(1, sender.wait_for(1));
+
+    sender.answer(0, failed(couchbase::errc::common::ambiguous_timeout));
+    ASSERT_EQ(1, sender.requests.size());
+    ASSERT_EQ(couchbase::errc::common::ambiguous_timeout, r.got[0]->ctx.ec());
+    ASSERT_EQ(couchbase::errc::common::ambiguous_timeout, r.got[1]->ctx.ec());
+}
+
+TEST_F(AtrWriteBatcherExecute, FailureOfWholeRequestGoesToEveryWrite)
+{
+    responses r(2);
+    execute(*batcher, "a1", 3, std::chrono::milliseconds(1), r.callback(0));
+    execute(*batcher, "a2", 2, std::chrono::milliseconds(1), r.callback(1));
+    ASSERT_EQ(1, sender.wait_for(1));
+
+    // sending them alone would not help
+    sender.answer(0, failed(couchbase::errc::key_value::document_not_found));
+    ASSERT_EQ(1, sender.requests.size());
+    ASSERT_EQ(couchbase::errc::key_value::document_not_found, r.got[0]->ctx.ec());
+    ASSERT_EQ(couchbase::errc::key_value::document_not_found, r.got[1]->ctx.ec());
+}
+
+TEST_F(AtrWriteBatcherExecute, ClosingSchedulerSendsPendingBatches)
+{
+    responses r(1);
+    execute(*batcher, "a1", 3, std::chrono::hours(1), r.callback(0));
+    ASSERT_EQ(0, sender.requests.size());
+    scheduler.close();
+    ASSERT_EQ(1, sender.requests.size());
+
+    // the response can still come back once the batcher has gone
+    batcher.reset();
+    sender.answer(0, succeeded(sender.requests[0].req));
+    ASSERT_EQ(3, r.got[0]->fields.size());
+}
+
+TEST_F(AtrWriteBatcherExecute, SendsStraightAwayOnceSchedulerClosed)
+{
+    scheduler.close();
+    responses r(1);
+    execute(*batcher, "a1", 3, std::chrono::hours(1), r.callback(0));
+    ASSERT_EQ(1, sender.requests.size());
+    ASSERT_EQ(3, sender.specs_of(0));
+    sender.answer(0, succeeded(sender.requests[0].req));
+    ASSERT_EQ(3, r.got[0]->fields.size());
+}
@@ -0,0 +1,149 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/active_transaction_record.hxx"
+#include "../../src/transactions/doc_list_chunks.hxx"
+#include "../../src/transactions/forward_compat.hxx"
+#include "couchbase/transactions/internal/atr_cleanup_entry.hxx"
+#include "couchbase/transactions/internal/logging.hxx"
+#include "transactions_env.h"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace couchbase::transactions;
+
+namespace
+{
+std::string
+doc_list(const std::vector<std::string>& keys)
+{
+    std::string list = "[";
+    for (const auto& key : keys) {
+        if (list.size() > 1) {
+            list += ",";
+        }
+        list += R"({"id":")" + key + R"(","bkt":"default","scp":"_default","col":"_default"})";
+    }
+    return list + "]";
+}
+
+doc_list_chunks::buffer
+chunk(const std::vector<std::string>& inserted, const std::vector<std::string>& replaced)
+{
+    auto raw = R"({"ins":)" + doc_list(inserted) + R"(,"rep":)" + doc_list(replaced) + R"(,"rem":[]})";
+    auto bytes = reinterpret_cast<const std::byte*>(raw.data());
+    return { bytes, bytes + raw.size() };
+}
+
+void
+wait_for(const std::function<void(doc_list_chunks::callback&&)>& op)
+{
+    auto barrier = std::make_shared<std::promise<std::optional<client_error>>>();
+    auto f = barrier->get_future();
+    op([barrier](std::optional<client_error> err) { barrier->set_value(std::move(err)); });
+    auto err = f.get();
+    ASSERT_FALSE(err) << err->what();
+}
+} // namespace
+
+TEST(DocListChunks, ChunksLiveBesideTheAtr)
+{
+    couchbase::core::document_id atr_id{ "b", "s", "c", "_txn:atr-1-#5" };
+    auto first = doc_list_chunks::chunk_id(atr_id, "a1", 0);
+    auto second = doc_list_chunks::chunk_id(atr_id, "a1", 1);
+    ASSERT_EQ("b", first.bucket());
+    ASSERT_EQ("s", first.scope());
+    ASSERT_EQ("c", first.collection());
+    ASSERT_NE(first.key(), second.key());
+    ASSERT_NE(first.key(), doc_list_chunks::chunk_id(atr_id, "a2", 0).key());
+}
+
+TEST(DocListChunks, ParsesChunk)
+{
+    auto chunk = doc_list_chunks::parse(R"({
+        "ins": [ { "id": "k1", "bkt": "b", "scp": "_default", "col": "_default" } ],
+        "rep": [],
+        "rem": [ { "id": "k2", "bkt": "b", "scp": "s", "col": "c" }, { "id": "k3", "bkt": "b", "scp": "s", "col": "c" } ]
+    })");
+    ASSERT_EQ(1, chunk.inserted.size());
+    ASSERT_EQ("k1", chunk.inserted.front().id());
+    ASSERT_TRUE(chunk.replaced.empty());
+    ASSERT_EQ(2, chunk.removed.size());
+    ASSERT_EQ("c", chunk.removed.back().collection_name());
+}
+
+TEST(DocListChunks, EntryRecordsChunks)
+{
+    auto fc = doc_list_chunks::forward_compat();
+    auto raw = std::make_shared<const std::string>(R"({ "st": "COMMITTED", "dlc": 3, "fc": )" +
+                                                   std::string(reinterpret_cast<const char*>(fc.data()), fc.size()) + " }");
+    auto entry = active_transaction_record::parse_entry("b", "_txn:atr-1", "a1", raw, 42);
+    ASSERT_EQ(3, entry.doc_list_chunks());
+    ASSERT_FALSE(entry.inserted_ids());
+
+    // we can clean it up, but nothing is stopped from reading it
+    ASSERT_FALSE(forward_compat::check(forward_compat_stage::CLEANUP_ENTRY, entry.forward_compat()));
+    ASSERT_FALSE(forward_compat::check(forward_compat_stage::GETS_READING_ATR, entry.forward_compat()));
+    ASSERT_EQ(attempt_state::COMMITTED, entry.without_doc_lists().state());
+
+    auto plain = active_transaction_record::parse_entry(
+      "b", "_txn:atr-1", "a1", std::make_shared<const std::string>(R"({ "st": "COMMITTED", "ins": [] })"), 42);
+    ASSERT_EQ(0, plain.doc_list_chunks());
+}
+
+TEST(DocListChunks, CleanupReadsChunksBack)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    // any key will do for the ATR, as only the chunks are read
+    auto atr_id = TransactionsTestEnvironment::get_document_id();
+    auto attempt_id = uid_generator::next();
+    std::vector<doc_list_chunks::buffer> chunks{ chunk({ "c0" }, { "c1" }), chunk({ "c2", "c3" }, {}), chunk({}, { "c4" }) };
+    wait_for([&](auto&& cb) { doc_list_chunks::write(cluster, txns.config(), atr_id, attempt_id, chunks, std::move(cb)); });
+
+    auto raw = std::make_shared<const std::string>(R"({ "st": "COMMITTED", "ins": )" + doc_list({ "e0" }) + R"(, "dlc": 3 })");
+    auto entry = active_transaction_record::parse_entry("default", atr_id.key(), attempt_id, raw, 42);
+    atr_cleanup_entry cleanup_entry(entry, atr_id, txns.cleanup(), false);
+    auto listed = [&cleanup_entry]() {
+        std::vector<std::string> keys;
+        cleanup_entry.for_each_doc_lists(lost_attempts_cleanup_log, [&keys](auto inserted, auto replaced, auto removed) {
+            for (const auto& list : { inserted, replaced, removed }) {
+                for (const auto& record : list.value_or(std::vector<doc_record>{})) {
+                    keys.push_back(record.id());
+                }
+            }
+        });
+        return keys;
+    };
+    // the entry's own lists, then each chunk's in turn
+    ASSERT_EQ((std::vector<std::string>{ "e0", "c0", "c1", "c2", "c3", "c4" }), listed());
+
+    // a chunk which has been removed has nothing left to clean
+    wait_for([&](auto&& cb) {
+        doc_list_chunks::remove(cluster, txns.config(), txns.config().durability_level(), atr_id, attempt_id, 1, std::move(cb));
+    });
+    ASSERT_EQ((std::vector<std::string>{ "e0", "c2", "c3", "c4" }), listed());
+
+    wait_for([&](auto&& cb) {
+        doc_list_chunks::remove(cluster, txns.config(), txns.config().durability_level(), atr_id, attempt_id, 3, std::move(cb));
+    });
+    ASSERT_EQ((std::vector<std::string>{ "e0" }), listed());
+}
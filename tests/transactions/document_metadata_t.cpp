@@ -0,0 +1,105 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/result.hxx"
+#include <couchbase/transactions/document_metadata.hxx>
+#include <couchbase/transactions/transaction_get_result.hxx>
+
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <string>
+
+using namespace couchbase::transactions;
+
+static const std::string document_xattr =
+  R"({"CAS":"0x1234","revid":"42","exptime":10,"value_crc32c":"0xabcd","flags":0,"deleted":false})";
+
+namespace
+{
+// a lookup of the fields transaction_get_result::create_from expects, with $document (index 9) as given
+result
+lookup_result(const std::string& document)
+{
+    result res;
+    res.cas = 100;
+    res.values.resize(13);
+    res.values[9] = subdoc_result(document, 0);
+    res.values[12] = subdoc_result(R"({"some":"thing"})", 0);
+    return res;
+}
+} // namespace
+
+TEST(DocumentMetadata, ParsesDocumentXattr)
+{
+    auto md = document_metadata::from_document_xattr(document_xattr);
+    ASSERT_EQ("0x1234", md.cas().value());
+    ASSERT_EQ("42", md.revid().value());
+    ASSERT_EQ(10, md.exptime().value());
+    ASSERT_EQ("0xabcd", md.crc32().value());
+}
+
+TEST(DocumentMetadata, CopiesShareParsedResult)
+{
+    auto md = document_metadata::from_document_xattr(document_xattr);
+    auto copy = md;
+    ASSERT_EQ("0xabcd", copy.crc32().value());
+    ASSERT_EQ(copy.cas(), md.cas());
+    ASSERT_EQ(copy.revid(), md.revid());
+}
+
+TEST(DocumentMetadata, EmptyXattrHasNoValues)
+{
+    auto md = document_metadata::from_document_xattr("");
+    ASSERT_FALSE(md.cas());
+    ASSERT_FALSE(md.revid());
+    ASSERT_FALSE(md.exptime());
+    ASSERT_FALSE(md.crc32());
+}
+
+TEST(DocumentMetadata, RevidIsOptional)
+{
+    auto md = document_metadata::from_document_xattr(R"({"CAS":"0x1234","exptime":0,"value_crc32c":"0xabcd"})");
+    ASSERT_FALSE(md.revid());
+    ASSERT_EQ("0x1234", md.cas().value());
+}
+
+TEST(DocumentMetadata, MalformedXattrThrowsFromEveryAccess)
+{
+    // nothing is parsed until asked for
+    auto md = document_metadata::from_document_xattr("{not json");
+    ASSERT_THROW(md.crc32(), std::exception);
+    // and a failed parse is not mistaken for an absent field next time
+    ASSERT_THROW(md.crc32(), std::exception);
+    ASSERT_THROW(md.cas(), std::exception);
+
+    auto missing_cas = document_metadata::from_document_xattr(R"({"exptime":0,"value_crc32c":"0xabcd"})");
+    ASSERT_THROW(missing_cas.cas(), std::exception);
+}
+
+TEST(DocumentMetadata, GetResultWithDocumentXattr)
+{
+    auto doc = transaction_get_result::create_from({ "b", "s", "c", "k" }, lookup_result(document_xattr));
+    ASSERT_TRUE(doc.metadata());
+    ASSERT_EQ("0xabcd", doc.metadata()->crc32().value());
+}
+
+TEST(DocumentMetadata, GetResultWithoutDocumentXattr)
+{
+    auto doc = transaction_get_result::create_from({ "b", "s", "c", "k" }, lookup_result(""));
+    ASSERT_FALSE(doc.metadata());
+    ASSERT_EQ(100, doc.cas());
+}
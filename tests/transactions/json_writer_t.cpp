@@ -0,0 +1,61 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/json_writer.hxx"
+
+#include <gtest/gtest.h>
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace couchbase::transactions;
+
+TEST(JsonWriter, WritesNestedContainers)
+{
+    std::string out;
+    json_writer<std::string> writer(out);
+    writer.begin_object().key("id").begin_object().field("txn", "abc").end_object().field("n", 12).key("m").begin_array();
+    writer.begin_object().field("k", "v1").end_object();
+    writer.begin_object().field("k", "v2").end_object();
+    writer.end_array().key("e").begin_array().end_array().end_object();
+    ASSERT_EQ(R"({"id":{"txn":"abc"},"n":12,"m":[{"k":"v1"},{"k":"v2"}],"e":[]})", out);
+}
+
+TEST(JsonWriter, EscapesStrings)
+{
+    std::string value("quote\" slash\\ newline\n tab\t ctrl\x01 utf8 \xc3\xa9");
+    std::string out;
+    json_writer<std::string>(out).begin_array().value(value).end_array();
+    ASSERT_EQ(value, nlohmann::json::parse(out)[0].get<std::string>());
+}
+
+TEST(JsonWriter, CanWriteBytes)
+{
+    std::vector<std::byte> out;
+    json_writer<std::vector<std::byte>>(out).begin_array().value("a").value(-1).end_array();
+    ASSERT_EQ(R"(["a",-1])", std::string(reinterpret_cast<const char*>(out.data()), out.size()));
+}
+
+TEST(JsonWriter, CanCarryOnFromPrefix)
+{
+    std::string out;
+    json_writer<std::string>(out).begin_object().field("a", "b");
+    json_writer<std::string>(out, true).field("c", 1).end_object();
+    ASSERT_EQ(R"({"a":"b","c":1})", out);
+}
@@ -16,6 +16,7 @@
 
 #include "../../src/transactions/attempt_context_impl.hxx"
 #include "../../src/transactions/attempt_context_testing_hooks.hxx"
+#include "../../src/transactions/cleanup_testing_hooks.hxx"
 #include "helpers.hxx"
 #include "transactions_env.h"
 #include <couchbase/error_codes.hxx>
@@ -25,7 +26,10 @@
 
 #include <future>
 #include <list>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace couchbase::transactions;
 
@@ -258,6 +262,191 @@ TEST(SimpleAsyncTxns, AsyncReplace)
     ASSERT_EQ(content, new_content);
 }
 
+TEST(SimpleAsyncTxns, AsyncGetReplaceThenCommit)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto id = TransactionsTestEnvironment::get_document_id();
+    auto new_content = nlohmann::json::parse("{\"shiny\":\"and new\"}");
+    std::atomic<bool> replaced = false;
+    std::atomic<bool> committed = false;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, async_content.dump()));
+    txns.run(
+      [&replaced, &committed, &new_content, id](async_attempt_context& ctx) {
+          // each op is started from the callback of the one before, with commit last of all
+          ctx.get(id, [&](std::exception_ptr err, std::optional<transaction_get_result> res) {
+              ASSERT_FALSE(err);
+              ctx.replace(*res, new_content, [&](std::exception_ptr err, std::optional<transaction_get_result>) {
+                  ASSERT_FALSE(err);
+                  replaced = true;
+                  ctx.commit([&](std::exception_ptr err) {
+                      EXPECT_FALSE(err);
+                      committed = true;
+                  });
+              });
+          });
+      },
+      [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+          txn_completed(std::move(err), res, barrier);
+      });
+    f.get();
+    ASSERT_TRUE(replaced.load());
+    ASSERT_TRUE(committed.load());
+    auto content = TransactionsTestEnvironment::get_doc(id).content_as<nlohmann::json>();
+    ASSERT_EQ(content, new_content);
+}
+
+TEST(SimpleAsyncTxns, AsyncGetMulti)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    std::vector<couchbase::core::document_id> ids;
+    for (int i = 0; i < 5; i++) {
+        ids.push_back(TransactionsTestEnvironment::get_document_id());
+        ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(ids.back(), nlohmann::json{ { "number", i } }.dump()));
+    }
+    std::atomic<bool> cb_called = false;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    txns.run(
+      [&cb_called, ids](async_attempt_context& ctx) {
+          ctx.get_multi(ids, [&cb_called, ids](std::exception_ptr err, std::optional<std::vector<transaction_get_result>> docs) {
+              ASSERT_FALSE(err);
+              ASSERT_EQ(ids.size(), docs->size());
+              for (size_t i = 0; i < docs->size(); i++) {
+                  ASSERT_EQ(ids[i].key(), docs->at(i).id().key());
+                  ASSERT_EQ(static_cast<int>(i), docs->at(i).content<nlohmann::json>()["number"].get<int>());
+              }
+              cb_called = true;
+          });
+      },
+      [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+          txn_completed(std::move(err), res, barrier);
+      });
+    f.get();
+    ASSERT_TRUE(cb_called.load());
+}
+
+TEST(SimpleAsyncTxns, AsyncGetMultiFail)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    auto id = TransactionsTestEnvironment::get_document_id();
+    auto missing = TransactionsTestEnvironment::get_document_id();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, async_content.dump()));
+    std::atomic<bool> cb_called = false;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    try {
+        txns.run(
+          [&cb_called, id, missing](async_attempt_context& ctx) {
+              ctx.get_multi({ id, missing }, [&cb_called](std::exception_ptr err, std::optional<std::vector<transaction_get_result>>) {
+                  // should be an error
+                  ASSERT_TRUE(err);
+                  cb_called = true;
+              });
+          },
+          [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+              txn_completed(std::move(err), res, barrier);
+          });
+        f.get();
+        FAIL() << "expected transaction_exception!";
+    } catch (const transaction_exception& e) {
+        ASSERT_TRUE(cb_called.load());
+        ASSERT_EQ(e.type(), failure_type::FAIL);
+    }
+}
+
+TEST(SimpleAsyncTxns, AsyncInsertManyReplaceMany)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.staging_concurrency(4);
+    couchbase::transactions::transactions txns(cluster, cfg);
+
+    std::vector<std::pair<couchbase::core::document_id, nlohmann::json>> docs;
+    for (int i = 0; i < 20; i++) {
+        docs.emplace_back(TransactionsTestEnvironment::get_document_id(), nlohmann::json{ { "number", i } });
+    }
+    std::vector<couchbase::core::document_id> ids;
+    for (auto& doc : docs) {
+        ids.push_back(doc.first);
+    }
+    std::atomic<bool> replaced = false;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    // insert them all, then read them back and replace them all, each from the callback of the one before
+    txns.run(
+      [&replaced, docs, ids](async_attempt_context& ctx) {
+          ctx.insert_many(docs, [&ctx, &replaced, ids](std::exception_ptr err, std::optional<std::vector<transaction_get_result>> res) {
+              ASSERT_FALSE(err);
+              ASSERT_EQ(ids.size(), res->size());
+              ctx.get_multi(ids, [&ctx, &replaced](std::exception_ptr err, std::optional<std::vector<transaction_get_result>> res) {
+                  ASSERT_FALSE(err);
+                  std::vector<std::pair<transaction_get_result, nlohmann::json>> replacements;
+                  for (auto& doc : *res) {
+                      auto number = doc.content<nlohmann::json>()["number"].get<int>();
+                      replacements.emplace_back(doc, nlohmann::json{ { "number", number + 1 } });
+                  }
+                  ctx.replace_many(replacements,
+                                   [&replaced](std::exception_ptr err, std::optional<std::vector<transaction_get_result>>) {
+                                       ASSERT_FALSE(err);
+                                       replaced = true;
+                                   });
+              });
+          });
+      },
+      [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+          txn_completed(std::move(err), res, barrier);
+      });
+    f.get();
+    ASSERT_TRUE(replaced.load());
+    for (auto& doc : docs) {
+        ASSERT_EQ(doc.second["number"].get<int>() + 1,
+                  TransactionsTestEnvironment::get_doc(doc.first).content_as<nlohmann::json>()["number"].get<int>());
+    }
+}
+
+TEST(SimpleAsyncTxns, AsyncInsertManyWithExistingDocFails)
+{
+    auto txns = TransactionsTestEnvironment::get_transactions();
+    std::vector<std::pair<couchbase::core::document_id, nlohmann::json>> docs;
+    for (int i = 0; i < 10; i++) {
+        docs.emplace_back(TransactionsTestEnvironment::get_document_id(), nlohmann::json{ { "number", i } });
+    }
+    // one of them is already there
+    auto existing = docs[5].first;
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(existing, async_content.dump()));
+    std::atomic<bool> cb_called = false;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    try {
+        txns.run(
+          [&cb_called, docs](async_attempt_context& ctx) {
+              ctx.insert_many(docs, [&cb_called](std::exception_ptr err, std::optional<std::vector<transaction_get_result>>) {
+                  ASSERT_TRUE(err);
+                  cb_called = true;
+              });
+          },
+          [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+              txn_completed(std::move(err), res, barrier);
+          });
+        f.get();
+        FAIL() << "expected transaction_exception!";
+    } catch (const transaction_exception& e) {
+        ASSERT_TRUE(cb_called.load());
+        ASSERT_EQ(e.type(), failure_type::FAIL);
+    }
+    for (auto& doc : docs) {
+        if (doc.first.key() == existing.key()) {
+            ASSERT_EQ(TransactionsTestEnvironment::get_doc(doc.first).content_as<nlohmann::json>(), async_content);
+        } else {
+            ASSERT_THROW(TransactionsTestEnvironment::get_doc(doc.first), client_error);
+        }
+    }
+}
+
 TEST(SimpleAsyncTxns, AsyncReplaceFail)
 {
     auto& cluster = TransactionsTestEnvironment::get_cluster();
@@ -359,6 +548,171 @@ TEST(SimpleAsyncTxns, AsyncInsertFail)
     }
 }
 
+namespace
+{
+// what each of a batch of inserts, all made before the first could complete, got back
+struct insert_outcomes {
+    std::mutex mutex;
+    size_t succeeded{ 0 };
+    std::vector<std::string> errors;
+
+    void record(std::exception_ptr err)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!err) {
+            succeeded++;
+            return;
+        }
+        try {
+            std::rethrow_exception(err);
+        } catch (const transaction_operation_failed& e) {
+            errors.emplace_back(e.what());
+        } catch (...) {
+            errors.emplace_back("not a transaction_operation_failed");
+        }
+    }
+};
+} // namespace
+
+TEST(SimpleAsyncTxns, ConcurrentFirstMutationsSetAtrPendingOnce)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    std::atomic<size_t> atr_pending_calls{ 0 };
+    attempt_context_testing_hooks hooks;
+    cleanup_testing_hooks cleanup_hooks;
+    hooks.before_atr_pending = [&atr_pending_calls](attempt_context*) -> std::optional<error_class> {
+        atr_pending_calls++;
+        return std::nullopt;
+    };
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.test_factories(hooks, cleanup_hooks);
+    couchbase::transactions::transactions txns(cluster, cfg);
+    std::vector<couchbase::core::document_id> ids;
+    for (int i = 0; i < 10; i++) {
+        ids.push_back(TransactionsTestEnvironment::get_document_id());
+    }
+    insert_outcomes outcomes;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    // none of them can complete until the ATR is pending, so all but the first queue up behind it
+    txns.run(
+      [&ids, &outcomes](async_attempt_context& ctx) {
+          for (const auto& id : ids) {
+              ctx.insert(id, async_content, [&outcomes](std::exception_ptr err, std::optional<transaction_get_result>) {
+                  outcomes.record(err);
+              });
+          }
+      },
+      [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+          txn_completed(std::move(err), res, barrier);
+      });
+    f.get();
+    ASSERT_EQ(1, atr_pending_calls.load());
+    ASSERT_EQ(ids.size(), outcomes.succeeded);
+    ASSERT_TRUE(outcomes.errors.empty());
+    for (const auto& id : ids) {
+        ASSERT_EQ(TransactionsTestEnvironment::get_doc(id).content_as<nlohmann::json>(), async_content);
+    }
+}
+
+TEST(SimpleAsyncTxns, ConcurrentFirstMutationsAllFailWhenAtrPendingFails)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    std::vector<couchbase::core::document_id> ids;
+    for (int i = 0; i < 10; i++) {
+        ids.push_back(TransactionsTestEnvironment::get_document_id());
+    }
+    std::atomic<size_t> inserts_started{ 0 };
+    std::atomic<size_t> atr_pending_calls{ 0 };
+    attempt_context_testing_hooks hooks;
+    cleanup_testing_hooks cleanup_hooks;
+    // the hook fails straight away, so hold it until the other inserts have had time to queue up behind this one
+    hooks.before_atr_pending = [&](attempt_context*) -> std::optional<error_class> {
+        atr_pending_calls++;
+        while (inserts_started.load() < ids.size()) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return FAIL_OTHER;
+    };
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.test_factories(hooks, cleanup_hooks);
+    couchbase::transactions::transactions txns(cluster, cfg);
+    insert_outcomes outcomes;
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    txns.run(
+      [&](async_attempt_context& ctx) {
+          // each from a thread of its own, as the one which sets the ATR pending is held up in the hook
+          std::vector<std::thread> threads;
+          for (const auto& id : ids) {
+              threads.emplace_back([&ctx, &outcomes, &inserts_started, id]() {
+                  inserts_started++;
+                  ctx.insert(id, async_content, [&outcomes](std::exception_ptr err, std::optional<transaction_get_result>) {
+                      outcomes.record(err);
+                  });
+              });
+          }
+          for (auto& t : threads) {
+              t.join();
+          }
+      },
+      [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+          txn_completed(std::move(err), res, barrier);
+      });
+    ASSERT_THROW(f.get(), transaction_exception);
+    ASSERT_EQ(1, atr_pending_calls.load());
+    // the insert setting the ATR pending, and every one queued up behind it, gets the same error
+    ASSERT_EQ(0, outcomes.succeeded);
+    ASSERT_EQ(ids.size(), outcomes.errors.size());
+    for (const auto& err : outcomes.errors) {
+        ASSERT_EQ(outcomes.errors.front(), err);
+    }
+    for (const auto& id : ids) {
+        ASSERT_THROW(TransactionsTestEnvironment::get_doc(id), client_error);
+    }
+}
+
+TEST(SimpleAsyncTxns, RollbackWithOpInFlightFailsInsteadOfHanging)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    attempt_context_testing_hooks hooks;
+    cleanup_testing_hooks cleanup_hooks;
+    // makes the rollback fail as it starts, which is once the insert has completed
+    hooks.has_expired_client_side = [](attempt_context*, const std::string& place, std::optional<const std::string>) {
+        if (place == STAGE_ROLLBACK) {
+            throw std::runtime_error("rollback failed");
+        }
+        return false;
+    };
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.test_factories(hooks, cleanup_hooks);
+    couchbase::transactions::transactions txns(cluster, cfg);
+    auto id = TransactionsTestEnvironment::get_document_id();
+    auto rolled_back = std::make_shared<std::promise<std::exception_ptr>>();
+    auto barrier = std::make_shared<std::promise<void>>();
+    auto f = barrier->get_future();
+    txns.run(
+      [id, rolled_back](async_attempt_context& ctx) {
+          ctx.insert(id, async_content, [](std::exception_ptr, std::optional<transaction_get_result>) {});
+          ctx.rollback([rolled_back](std::exception_ptr err) { rolled_back->set_value(err); });
+      },
+      [barrier](std::optional<transaction_exception> err, std::optional<transaction_result> res) {
+          txn_completed(std::move(err), res, barrier);
+      });
+    auto rollback_result = rolled_back->get_future();
+    ASSERT_EQ(std::future_status::ready, rollback_result.wait_for(std::chrono::seconds(10)));
+    ASSERT_TRUE(rollback_result.get());
+    // and the transaction still finishes
+    ASSERT_EQ(std::future_status::ready, f.wait_for(std::chrono::seconds(10)));
+}
+
 TEST(SimpleQueryAsyncTxns, AsyncQuery)
 {
     auto txns = TransactionsTestEnvironment::get_transactions();
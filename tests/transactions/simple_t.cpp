@@ -14,6 +14,10 @@
  *   limitations under the License.
  */
 
+#include "../../src/transactions/active_transaction_record.hxx"
+#include "../../src/transactions/attempt_context_impl.hxx"
+#include "../../src/transactions/attempt_context_testing_hooks.hxx"
+#include "../../src/transactions/cleanup_testing_hooks.hxx"
 #include "helpers.hxx"
 #include "transactions_env.h"
 #include <couchbase/error_codes.hxx>
@@ -100,6 +104,177 @@ TEST(SimpleTransactions, CanGetReplace)
     ASSERT_EQ(c, TransactionsTestEnvironment::get_doc(id).content_as<nlohmann::json>());
 }
 
+TEST(SimpleTransactions, CanGetMulti)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    couchbase::transactions::transactions txn(cluster, cfg);
+
+    std::vector<couchbase::core::document_id> ids;
+    for (int i = 0; i < 5; i++) {
+        ids.push_back(TransactionsTestEnvironment::get_document_id());
+        ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(ids.back(), nlohmann::json{ { "number", i } }.dump()));
+    }
+    auto inserted = TransactionsTestEnvironment::get_document_id();
+    txn.run([&](attempt_context& ctx) {
+        // own writes should be visible too
+        ctx.insert(inserted, nlohmann::json{ { "number", 5 } });
+        auto all_ids = ids;
+        all_ids.push_back(inserted);
+        auto docs = ctx.get_multi(all_ids);
+        ASSERT_EQ(all_ids.size(), docs.size());
+        for (size_t i = 0; i < docs.size(); i++) {
+            ASSERT_EQ(all_ids[i].key(), docs[i].id().key());
+            ASSERT_EQ(static_cast<int>(i), docs[i].content<nlohmann::json>()["number"].get<int>());
+        }
+    });
+}
+
+TEST(SimpleTransactions, GetMultiOfMissingDocFails)
+{
+    auto txn = TransactionsTestEnvironment::get_transactions();
+    auto id = TransactionsTestEnvironment::get_document_id();
+    auto missing = TransactionsTestEnvironment::get_document_id();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, nlohmann::json{ { "number", 0 } }.dump()));
+    try {
+        txn.run([&](attempt_context& ctx) {
+            ctx.get_multi({ id, missing });
+            FAIL() << "expected get_multi to throw";
+        });
+        FAIL() << "expected txn to throw a transaction_exception";
+    } catch (const transaction_exception& e) {
+        ASSERT_EQ(e.type(), failure_type::FAIL);
+    }
+}
+
+TEST(SimpleTransactions, CanInsertManyReplaceMany)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.staging_concurrency(4);
+    couchbase::transactions::transactions txn(cluster, cfg);
+
+    std::vector<std::pair<couchbase::core::document_id, nlohmann::json>> docs;
+    for (int i = 0; i < 20; i++) {
+        docs.emplace_back(TransactionsTestEnvironment::get_document_id(), nlohmann::json{ { "number", i } });
+    }
+    txn.run([&](attempt_context& ctx) { ASSERT_EQ(docs.size(), ctx.insert_many(docs).size()); });
+    txn.run([&](attempt_context& ctx) {
+        std::vector<std::pair<transaction_get_result, nlohmann::json>> replacements;
+        for (auto& doc : docs) {
+            replacements.emplace_back(ctx.get(doc.first), nlohmann::json{ { "number", doc.second["number"].get<int>() + 1 } });
+        }
+        ctx.replace_many(replacements);
+    });
+    for (auto& doc : docs) {
+        ASSERT_EQ(doc.second["number"].get<int>() + 1,
+                  TransactionsTestEnvironment::get_doc(doc.first).content_as<nlohmann::json>()["number"].get<int>());
+    }
+}
+
+TEST(SimpleTransactions, InsertManyWithExistingDocRollsBack)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.staging_concurrency(4);
+    couchbase::transactions::transactions txn(cluster, cfg);
+
+    std::vector<std::pair<couchbase::core::document_id, nlohmann::json>> docs;
+    for (int i = 0; i < 10; i++) {
+        docs.emplace_back(TransactionsTestEnvironment::get_document_id(), nlohmann::json{ { "number", i } });
+    }
+    // one of them is already there
+    auto existing = docs[5];
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(existing.first, nlohmann::json{ { "number", -1 } }.dump()));
+    ASSERT_THROW(txn.run([&](attempt_context& ctx) { ctx.insert_many(docs); }), transaction_exception);
+    for (auto& doc : docs) {
+        if (doc.first.key() == existing.first.key()) {
+            ASSERT_EQ(-1, TransactionsTestEnvironment::get_doc(doc.first).content_as<nlohmann::json>()["number"].get<int>());
+        } else {
+            ASSERT_THROW(TransactionsTestEnvironment::get_doc(doc.first), client_error);
+        }
+    }
+}
+
+TEST(SimpleTransactions, RollsBackMoreThanRollbackConcurrency)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.rollback_concurrency(2);
+    couchbase::transactions::transactions txn(cluster, cfg);
+
+    std::vector<couchbase::core::document_id> replaced;
+    std::vector<couchbase::core::document_id> inserted;
+    for (int i = 0; i < 6; i++) {
+        replaced.push_back(TransactionsTestEnvironment::get_document_id());
+        ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(replaced.back(), nlohmann::json{ { "number", i } }.dump()));
+        inserted.push_back(TransactionsTestEnvironment::get_document_id());
+    }
+    ASSERT_THROW(txn.run([&](attempt_context& ctx) {
+        for (size_t i = 0; i < replaced.size(); i++) {
+            ctx.replace(ctx.get(replaced[i]), nlohmann::json{ { "number", -1 } });
+            ctx.insert(inserted[i], nlohmann::json{ { "number", -1 } });
+        }
+        throw std::runtime_error("roll them all back");
+    }),
+                 transaction_exception);
+    for (size_t i = 0; i < replaced.size(); i++) {
+        ASSERT_EQ(static_cast<int>(i), TransactionsTestEnvironment::get_doc(replaced[i]).content_as<nlohmann::json>()["number"].get<int>());
+        ASSERT_THROW(TransactionsTestEnvironment::get_doc(inserted[i]), client_error);
+    }
+}
+
+TEST(SimpleTransactions, RollbackGivesUpOnDocumentAfterRetries)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    std::vector<couchbase::core::document_id> ids;
+    for (int i = 0; i < 5; i++) {
+        ids.push_back(TransactionsTestEnvironment::get_document_id());
+        ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(ids.back(), nlohmann::json{ { "number", i } }.dump()));
+    }
+    // the last document staged never rolls back, so every retry of it fails and the rollback gives up on it
+    auto stuck = ids.back().key();
+    std::atomic<size_t> stuck_attempts{ 0 };
+    attempt_context_testing_hooks hooks;
+    cleanup_testing_hooks cleanup_hooks;
+    hooks.before_doc_rolled_back = [&stuck, &stuck_attempts](attempt_context*, const std::string& key) -> std::optional<error_class> {
+        if (key == stuck) {
+            stuck_attempts++;
+            return FAIL_TRANSIENT;
+        }
+        return std::nullopt;
+    };
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.rollback_concurrency(2);
+    // long enough for every retry, with their backoff, to happen before the transaction expires
+    cfg.expiration_time(std::chrono::seconds(60));
+    cfg.test_factories(hooks, cleanup_hooks);
+    couchbase::transactions::transactions txn(cluster, cfg);
+
+    ASSERT_THROW(txn.run([&](attempt_context& ctx) {
+        for (auto& id : ids) {
+            ctx.replace(ctx.get(id), nlohmann::json{ { "number", -1 } });
+        }
+        throw std::runtime_error("roll them all back");
+    }),
+                 transaction_exception);
+    ASSERT_EQ(DEFAULT_RETRY_OP_MAX_RETRIES + 1, stuck_attempts.load());
+    // the others were all rolled back before it gave up
+    for (size_t i = 0; i < ids.size(); i++) {
+        ASSERT_EQ(static_cast<int>(i), TransactionsTestEnvironment::get_doc(ids[i]).content_as<nlohmann::json>()["number"].get<int>());
+    }
+}
+
 TEST(SimpleTransactions, CanUseCustomMetadataCollectionsPerTransaction)
 {
     nlohmann::json c = nlohmann::json::parse("{\"some number\": 0}");
@@ -656,6 +831,84 @@ TEST(SimpleQueryTransactions, CanRollbackKVInsert)
     }
 }
 
+TEST(SimpleTransactions, ClientRecordHasVbucketCount)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.num_atrs(16);
+    cfg.num_vbuckets(64);
+    couchbase::transactions::transactions txn(cluster, cfg);
+    auto bucket = TransactionsTestEnvironment::get_document_id().bucket();
+    auto uuid = couchbase::transactions::uid_generator::next();
+
+    // the first call adds this client to the record, which the second reads back
+    txn.cleanup().get_active_clients(bucket, uuid);
+    auto details = txn.cleanup().get_active_clients(bucket, uuid);
+    ASSERT_EQ(16, details.num_atrs_by_num_vbuckets.at(64));
+    txn.cleanup().remove_client_record_from_all_buckets(uuid);
+}
+
+namespace
+{
+// runs a transaction replacing id, returning its result and the id of its ATR and attempt
+transaction_result
+replace_in_txn(couchbase::transactions::transactions& txn,
+               const couchbase::core::document_id& id,
+               couchbase::core::document_id& atr_id,
+               std::string& attempt_id)
+{
+    return txn.run([&](attempt_context& ctx) {
+        auto doc = ctx.get(id);
+        ctx.replace(doc, nlohmann::json::parse("{\"some\": \"thing else\"}"));
+        auto& impl = static_cast<attempt_context_impl&>(ctx);
+        atr_id = txn.config().atr_id_from_bucket_and_key(id.bucket(), impl.atr_id());
+        attempt_id = impl.id();
+    });
+}
+} // namespace
+
+TEST(SimpleTransactions, AtrCompleteIsNotDeferredByDefault)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    ASSERT_FALSE(cfg.defer_atr_complete());
+    couchbase::transactions::transactions txn(cluster, cfg);
+    auto id = TransactionsTestEnvironment::get_document_id();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, content.dump()));
+    couchbase::core::document_id atr_id;
+    std::string attempt_id;
+    auto result = replace_in_txn(txn, id, atr_id, attempt_id);
+    ASSERT_TRUE(result.unstaging_complete);
+    // the entry is gone before commit returns
+    ASSERT_FALSE(active_transaction_record::get_atr_entry(cluster, atr_id, attempt_id));
+}
+
+TEST(SimpleTransactions, DeferredAtrCompleteRemovesEntryBeforeClose)
+{
+    auto& cluster = TransactionsTestEnvironment::get_cluster();
+    transaction_config cfg;
+    cfg.cleanup_client_attempts(false);
+    cfg.cleanup_lost_attempts(false);
+    cfg.defer_atr_complete(true);
+    couchbase::transactions::transactions txn(cluster, cfg);
+    auto id = TransactionsTestEnvironment::get_document_id();
+    ASSERT_TRUE(TransactionsTestEnvironment::upsert_doc(id, content.dump()));
+    couchbase::core::document_id atr_id;
+    std::string attempt_id;
+    auto result = replace_in_txn(txn, id, atr_id, attempt_id);
+    // the attempt stays COMMITTED, but the documents are all there to be read
+    ASSERT_TRUE(result.unstaging_complete);
+    ASSERT_EQ(TransactionsTestEnvironment::get_doc(id).content_as<nlohmann::json>(), nlohmann::json::parse("{\"some\": \"thing else\"}"));
+
+    // close waits for the removal
+    txn.close();
+    ASSERT_FALSE(active_transaction_record::get_atr_entry(cluster, atr_id, attempt_id));
+}
+
 TEST(SimpleQueryTransactions, CanKVReplace)
 {
     auto& cluster = TransactionsTestEnvironment::get_cluster();
@@ -0,0 +1,220 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/doc_list_chunks.hxx"
+#include "../../src/transactions/staged_mutation.hxx"
+#include "couchbase/transactions/internal/transaction_fields.hxx"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace couchbase::transactions;
+
+namespace
+{
+couchbase::core::document_id
+doc_id(const std::string& key)
+{
+    return { "b", "s", "c", key };
+}
+
+staged_mutation
+mutation(const std::string& key, staged_mutation_type type, const std::string& content = "{}")
+{
+    transaction_get_result doc(doc_id(key), nlohmann::json::object());
+    return { doc, shared_content(content), type };
+}
+
+std::vector<std::string>
+staged_keys(staged_mutation_queue& queue)
+{
+    std::vector<std::string> keys;
+    queue.iterate([&keys](staged_mutation& item) { keys.push_back(item.id().key()); });
+    return keys;
+}
+
+template<typename Buffer>
+std::string
+as_string(const Buffer& buffer)
+{
+    return { reinterpret_cast<const char*>(buffer.data()), buffer.size() };
+}
+
+// the value extract_to wrote to path
+std::optional<std::string>
+spec_value(const couchbase::core::operations::mutate_in_request& req, const std::string& path)
+{
+    for (const auto& spec : req.specs) {
+        if (spec.path_ == path) {
+            return as_string(spec.value_);
+        }
+    }
+    return std::nullopt;
+}
+
+// the keys in the doc list extract_to wrote to prefix + field
+std::vector<std::string>
+listed_keys(const couchbase::core::operations::mutate_in_request& req, const std::string& path)
+{
+    auto value = spec_value(req, path);
+    if (!value) {
+        ADD_FAILURE() << "no spec for " << path;
+        return {};
+    }
+    std::vector<std::string> keys;
+    for (auto& record : nlohmann::json::parse(*value)) {
+        keys.push_back(doc_record::create_from(record).id());
+    }
+    return keys;
+}
+
+std::vector<std::string>
+keys_of(const std::vector<doc_record>& records)
+{
+    std::vector<std::string> keys;
+    for (const auto& record : records) {
+        keys.push_back(record.id());
+    }
+    return keys;
+}
+} // namespace
+
+TEST(StagedMutationQueue, RestagingReplacesInPlace)
+{
+    staged_mutation_queue queue;
+    queue.add(mutation("k1", staged_mutation_type::INSERT, R"({"v":1})"));
+    queue.add(mutation("k2", staged_mutation_type::INSERT));
+    auto* staged = queue.find_insert(doc_id("k1"));
+    ASSERT_NE(nullptr, staged);
+
+    // as a replace after an insert does
+    queue.add(mutation("k1", staged_mutation_type::REPLACE, R"({"v":2})"));
+    ASSERT_EQ(nullptr, queue.find_insert(doc_id("k1")));
+    ASSERT_EQ(staged, queue.find_replace(doc_id("k1")));
+    ASSERT_EQ(staged, queue.find_any(doc_id("k1")));
+    ASSERT_EQ(R"({"v":2})", staged->content());
+    ASSERT_EQ((std::vector<std::string>{ "k1", "k2" }), staged_keys(queue));
+}
+
+TEST(StagedMutationQueue, FindsByWholeDocumentId)
+{
+    staged_mutation_queue queue;
+    queue.add(mutation("k1", staged_mutation_type::REMOVE));
+    ASSERT_NE(nullptr, queue.find_remove(doc_id("k1")));
+    ASSERT_EQ(nullptr, queue.find_any({ "b", "s", "other", "k1" }));
+    ASSERT_EQ(nullptr, queue.find_any({ "other", "s", "c", "k1" }));
+    ASSERT_EQ(nullptr, queue.find_replace(doc_id("k1")));
+}
+
+TEST(StagedMutationQueue, RemoveAnyThenFind)
+{
+    staged_mutation_queue queue;
+    queue.add(mutation("k1", staged_mutation_type::INSERT));
+    queue.add(mutation("k2", staged_mutation_type::REPLACE));
+    queue.add(mutation("k3", staged_mutation_type::REMOVE));
+    auto* k3 = queue.find_any(doc_id("k3"));
+
+    queue.remove_any(doc_id("k2"));
+    ASSERT_EQ(nullptr, queue.find_any(doc_id("k2")));
+    ASSERT_EQ(nullptr, queue.find_replace(doc_id("k2")));
+    ASSERT_NE(nullptr, queue.find_insert(doc_id("k1")));
+    // the others have not moved
+    ASSERT_EQ(k3, queue.find_remove(doc_id("k3")));
+    ASSERT_EQ((std::vector<std::string>{ "k1", "k3" }), staged_keys(queue));
+
+    // removing what is not there does nothing
+    queue.remove_any(doc_id("k2"));
+    ASSERT_EQ((std::vector<std::string>{ "k1", "k3" }), staged_keys(queue));
+
+    // and it can be staged again, at the end
+    queue.add(mutation("k2", staged_mutation_type::INSERT));
+    ASSERT_NE(nullptr, queue.find_insert(doc_id("k2")));
+    ASSERT_EQ((std::vector<std::string>{ "k1", "k3", "k2" }), staged_keys(queue));
+
+    queue.remove_any(doc_id("k1"));
+    queue.remove_any(doc_id("k2"));
+    queue.remove_any(doc_id("k3"));
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(StagedMutationQueue, ExtractKeepsStagingOrder)
+{
+    staged_mutation_queue queue;
+    const staged_mutation_type types[] = { staged_mutation_type::INSERT, staged_mutation_type::REPLACE, staged_mutation_type::REMOVE };
+    for (int i = 0; i < 9; i++) {
+        queue.add(mutation("k" + std::to_string(i), types[i % 3]));
+    }
+    // re-staging keeps its place
+    queue.add(mutation("k3", staged_mutation_type::INSERT));
+    ASSERT_EQ((std::vector<std::string>{ "k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7", "k8" }), staged_keys(queue));
+
+    couchbase::core::operations::mutate_in_request req{ doc_id("_txn:atr-1") };
+    ASSERT_TRUE(queue.extract_to("attempts.a1.", req).empty());
+    ASSERT_EQ((std::vector<std::string>{ "k0", "k3", "k6" }), listed_keys(req, "attempts.a1." + ATR_FIELD_DOCS_INSERTED));
+    ASSERT_EQ((std::vector<std::string>{ "k1", "k4", "k7" }), listed_keys(req, "attempts.a1." + ATR_FIELD_DOCS_REPLACED));
+    ASSERT_EQ((std::vector<std::string>{ "k2", "k5", "k8" }), listed_keys(req, "attempts.a1." + ATR_FIELD_DOCS_REMOVED));
+}
+
+TEST(StagedMutationQueue, ExtractsChunksWhenOverChunkSize)
+{
+    staged_mutation_queue queue;
+    queue.add(mutation("k0", staged_mutation_type::INSERT));
+    queue.add(mutation("k1", staged_mutation_type::REMOVE));
+    queue.add(mutation("k2", staged_mutation_type::REPLACE));
+    queue.add(mutation("k3", staged_mutation_type::INSERT));
+    queue.add(mutation("k4", staged_mutation_type::REPLACE));
+
+    couchbase::core::operations::mutate_in_request req{ doc_id("_txn:atr-1") };
+    auto chunks = queue.extract_to("attempts.a1.", req, 2);
+    ASSERT_EQ(3, chunks.size());
+
+    // the entry just says how many chunks there are, and that cleanup must know about them
+    ASSERT_EQ(2, req.specs.size());
+    ASSERT_EQ("3", spec_value(req, "attempts.a1." + ATR_FIELD_DOC_LIST_CHUNKS).value_or(""));
+    ASSERT_EQ(as_string(doc_list_chunks::forward_compat()), spec_value(req, "attempts.a1." + ATR_FIELD_FORWARD_COMPAT).value_or(""));
+    ASSERT_FALSE(spec_value(req, "attempts.a1." + ATR_FIELD_DOCS_INSERTED));
+
+    // each chunk lists the next chunk_size mutations, in staging order
+    auto first = doc_list_chunks::parse(as_string(chunks[0]));
+    ASSERT_EQ((std::vector<std::string>{ "k0" }), keys_of(first.inserted));
+    ASSERT_TRUE(first.replaced.empty());
+    ASSERT_EQ((std::vector<std::string>{ "k1" }), keys_of(first.removed));
+    auto second = doc_list_chunks::parse(as_string(chunks[1]));
+    ASSERT_EQ((std::vector<std::string>{ "k3" }), keys_of(second.inserted));
+    ASSERT_EQ((std::vector<std::string>{ "k2" }), keys_of(second.replaced));
+    ASSERT_TRUE(second.removed.empty());
+    auto last = doc_list_chunks::parse(as_string(chunks[2]));
+    ASSERT_TRUE(last.inserted.empty());
+    ASSERT_EQ((std::vector<std::string>{ "k4" }), keys_of(last.replaced));
+    ASSERT_EQ("c", last.replaced.front().collection_name());
+}
+
+TEST(StagedMutationQueue, NoChunksUpToChunkSize)
+{
+    staged_mutation_queue queue;
+    queue.add(mutation("k0", staged_mutation_type::INSERT));
+    queue.add(mutation("k1", staged_mutation_type::REMOVE));
+
+    couchbase::core::operations::mutate_in_request req{ doc_id("_txn:atr-1") };
+    ASSERT_TRUE(queue.extract_to("attempts.a1.", req, 2).empty());
+    ASSERT_FALSE(spec_value(req, "attempts.a1." + ATR_FIELD_DOC_LIST_CHUNKS));
+    ASSERT_FALSE(spec_value(req, "attempts.a1." + ATR_FIELD_FORWARD_COMPAT));
+    ASSERT_EQ((std::vector<std::string>{ "k0" }), listed_keys(req, "attempts.a1." + ATR_FIELD_DOCS_INSERTED));
+    ASSERT_EQ((std::vector<std::string>{ "k1" }), listed_keys(req, "attempts.a1." + ATR_FIELD_DOCS_REMOVED));
+}
@@ -0,0 +1,131 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <asio/error.hpp>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "couchbase/transactions/internal/exceptions_internal.hxx"
+#include "couchbase/transactions/internal/timer_scheduler.hxx"
+
+using namespace couchbase::transactions;
+
+TEST(TimerScheduler, CallsAfterDelay)
+{
+    timer_scheduler scheduler;
+    std::promise<std::thread::id> barrier;
+    auto start = std::chrono::steady_clock::now();
+    scheduler.schedule(std::chrono::milliseconds(10), [&barrier](std::error_code ec) {
+        ASSERT_FALSE(ec);
+        barrier.set_value(std::this_thread::get_id());
+    });
+    auto id = barrier.get_future().get();
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(10));
+    ASSERT_NE(std::this_thread::get_id(), id);
+}
+
+TEST(TimerScheduler, CloseCancelsPendingTimers)
+{
+    timer_scheduler scheduler;
+    std::error_code result;
+    auto start = std::chrono::steady_clock::now();
+    scheduler.schedule(std::chrono::hours(1), [&result](std::error_code ec) { result = ec; });
+    scheduler.close();
+    ASSERT_EQ(asio::error::operation_aborted, result);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::minutes(1));
+}
+
+TEST(TimerScheduler, ScheduleAfterCloseIsAborted)
+{
+    timer_scheduler scheduler;
+    scheduler.close();
+    std::error_code result;
+    scheduler.schedule(std::chrono::hours(1), [&result](std::error_code ec) { result = ec; });
+    ASSERT_EQ(asio::error::operation_aborted, result);
+}
+
+TEST(TimerScheduler, CloseStopsCallbackReschedulingItself)
+{
+    timer_scheduler scheduler;
+    std::atomic<size_t> calls{ 0 };
+    std::promise<void> started;
+    std::function<void(std::error_code)> again = [&](std::error_code ec) {
+        if (calls++ == 0) {
+            started.set_value();
+        }
+        if (!ec) {
+            scheduler.schedule(std::chrono::milliseconds(1), std::function<void(std::error_code)>(again));
+        }
+    };
+    scheduler.schedule(std::chrono::milliseconds(1), std::function<void(std::error_code)>(again));
+    started.get_future().get();
+    scheduler.close();
+    auto calls_at_close = calls.load();
+    ASSERT_GT(calls_at_close, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(calls_at_close, calls.load());
+}
+
+TEST(TimerScheduler, DestroyedFromItsOwnCallback)
+{
+    auto scheduler = std::make_unique<timer_scheduler>();
+    std::promise<std::error_code> later;
+    scheduler->schedule(std::chrono::hours(1), [&later](std::error_code ec) { later.set_value(ec); });
+    scheduler->schedule(std::chrono::milliseconds(1), [&scheduler](std::error_code) { scheduler.reset(); });
+    // the detached thread goes on to run the cancelled timer, which must not need the scheduler
+    ASSERT_EQ(asio::error::operation_aborted, later.get_future().get());
+}
+
+TEST(AsyncExpDelay, FirstCallDoesNotWait)
+{
+    timer_scheduler scheduler;
+    async_exp_delay delay(scheduler, std::chrono::milliseconds(100), std::chrono::milliseconds(100), std::chrono::seconds(1));
+    bool called = false;
+    delay([&called](std::exception_ptr err) {
+        ASSERT_FALSE(err);
+        called = true;
+    });
+    ASSERT_TRUE(called);
+}
+
+TEST(AsyncExpDelay, CanCallTillTimeout)
+{
+    timer_scheduler scheduler;
+    async_exp_delay delay(scheduler, std::chrono::milliseconds(1), std::chrono::milliseconds(10), std::chrono::milliseconds(100));
+    std::promise<size_t> barrier;
+    size_t calls = 0;
+    std::function<void(std::exception_ptr)> next = [&](std::exception_ptr err) {
+        if (err) {
+            try {
+                std::rethrow_exception(err);
+            } catch (const retry_operation_timeout&) {
+                return barrier.set_value(calls);
+            }
+        }
+        calls++;
+        delay(std::function<void(std::exception_ptr)>(next));
+    };
+    auto start = std::chrono::steady_clock::now();
+    delay(std::function<void(std::exception_ptr)>(next));
+    auto calls_made = barrier.get_future().get();
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    ASSERT_LE(calls_made, 20);
+}
@@ -0,0 +1,174 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <couchbase/transactions/transaction_links.hxx>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+using namespace couchbase::transactions;
+
+namespace
+{
+transaction_links
+all_fields()
+{
+    return { "atr-1",
+             "bkt",
+             "scp",
+             "coll",
+             "txn-1",
+             "attempt-1",
+             shared_content(R"({"staged":true})"),
+             R"({"CAS":"0x10","revid":"3","exptime":20})",
+             "0xcrc",
+             "replace",
+             R"({"WW_R":[{"e":"X"}]})",
+             true };
+}
+} // namespace
+
+TEST(TransactionLinks, RoundTripsEveryField)
+{
+    auto links = all_fields();
+    ASSERT_EQ("atr-1", links.atr_id().value());
+    ASSERT_EQ("bkt", links.atr_bucket_name().value());
+    ASSERT_EQ("scp", links.atr_scope_name().value());
+    ASSERT_EQ("coll", links.atr_collection_name().value());
+    ASSERT_EQ("txn-1", links.staged_transaction_id().value());
+    ASSERT_EQ("attempt-1", links.staged_attempt_id().value());
+    ASSERT_EQ("attempt-1", links.staged_attempt_id_view().value());
+    ASSERT_EQ(R"({"staged":true})", links.staged_content());
+    ASSERT_EQ("0x10", links.cas_pre_txn().value());
+    ASSERT_EQ("3", links.revid_pre_txn().value());
+    ASSERT_EQ(20, links.exptime_pre_txn().value());
+    ASSERT_EQ("0xcrc", links.crc32_of_staging().value());
+    ASSERT_EQ("0xcrc", links.crc32_of_staging_view().value());
+    ASSERT_EQ("replace", links.op().value());
+    ASSERT_EQ(nlohmann::json::parse(R"({"WW_R":[{"e":"X"}]})"), links.forward_compat().value());
+    ASSERT_TRUE(links.is_deleted());
+    ASSERT_TRUE(links.is_document_in_transaction());
+    ASSERT_TRUE(links.has_staged_content());
+    ASSERT_TRUE(links.has_staged_write());
+    ASSERT_FALSE(links.is_document_being_inserted());
+    ASSERT_FALSE(links.is_document_being_removed());
+
+    // copies own the same values
+    auto copy = links;
+    links = transaction_links();
+    ASSERT_EQ("coll", copy.atr_collection_name().value());
+    ASSERT_EQ("replace", copy.op().value());
+}
+
+TEST(TransactionLinks, MissingFieldsAreNullopt)
+{
+    transaction_links links;
+    ASSERT_FALSE(links.atr_id());
+    ASSERT_FALSE(links.atr_bucket_name());
+    ASSERT_FALSE(links.atr_scope_name());
+    ASSERT_FALSE(links.atr_collection_name());
+    ASSERT_FALSE(links.staged_transaction_id());
+    ASSERT_FALSE(links.staged_attempt_id_view());
+    ASSERT_FALSE(links.cas_pre_txn());
+    ASSERT_FALSE(links.crc32_of_staging());
+    ASSERT_FALSE(links.op());
+    ASSERT_FALSE(links.forward_compat());
+    ASSERT_FALSE(links.is_document_in_transaction());
+    ASSERT_FALSE(links.has_staged_content());
+    ASSERT_FALSE(links.has_staged_write());
+    ASSERT_FALSE(links.is_deleted());
+    ASSERT_TRUE(links.staged_content().empty());
+}
+
+TEST(TransactionLinks, EmptyFieldIsNotMissing)
+{
+    // empty fields between others, so each must still start where the one before it ends
+    transaction_links links(
+      "", std::nullopt, "scp", "", std::nullopt, "", std::nullopt, std::nullopt, "", "insert", std::nullopt, false);
+    ASSERT_EQ("", links.atr_id().value());
+    ASSERT_TRUE(links.is_document_in_transaction());
+    ASSERT_FALSE(links.atr_bucket_name());
+    ASSERT_EQ("scp", links.atr_scope_name().value());
+    ASSERT_EQ("", links.atr_collection_name().value());
+    ASSERT_FALSE(links.staged_transaction_id());
+    ASSERT_EQ("", links.staged_attempt_id().value());
+    ASSERT_TRUE(links.has_staged_write());
+    ASSERT_FALSE(links.cas_pre_txn());
+    ASSERT_EQ("", links.crc32_of_staging().value());
+    ASSERT_TRUE(links.is_document_being_inserted());
+    ASSERT_FALSE(links.forward_compat());
+}
+
+TEST(TransactionLinks, RestoreFieldsAreOptional)
+{
+    transaction_links links(std::nullopt,
+                            std::nullopt,
+                            std::nullopt,
+                            std::nullopt,
+                            std::nullopt,
+                            std::nullopt,
+                            std::nullopt,
+                            R"({"CAS":"0x10","exptime":0})",
+                            std::nullopt,
+                            "remove",
+                            std::nullopt,
+                            false);
+    ASSERT_EQ("0x10", links.cas_pre_txn().value());
+    // only present in 6.5+
+    ASSERT_FALSE(links.revid_pre_txn());
+    ASSERT_EQ(0, links.exptime_pre_txn().value());
+    ASSERT_TRUE(links.is_document_being_removed());
+}
+
+TEST(TransactionLinks, QueryJsonRoundTrip)
+{
+    auto json = nlohmann::json::parse(R"({"txnMeta":{"atmpt":"attempt-1","txn":"txn-1",
+                                         "atr":{"key":"atr-1","bkt":"bkt","scp":"scp","coll":"coll"}}})");
+    transaction_links links(json);
+    ASSERT_EQ("attempt-1", links.staged_attempt_id().value());
+    ASSERT_EQ("txn-1", links.staged_transaction_id().value());
+    ASSERT_EQ("atr-1", links.atr_id().value());
+    ASSERT_EQ("bkt", links.atr_bucket_name().value());
+    ASSERT_EQ("scp", links.atr_scope_name().value());
+    ASSERT_EQ("coll", links.atr_collection_name().value());
+    ASSERT_FALSE(links.op());
+
+    nlohmann::json out = nlohmann::json::object();
+    links.append_to_json(out);
+    ASSERT_EQ(json, out);
+
+    // nothing to add when there is nothing in the links
+    nlohmann::json empty = nlohmann::json::object();
+    transaction_links(nlohmann::json::object()).append_to_json(empty);
+    ASSERT_TRUE(empty.empty());
+}
+
+TEST(TransactionLinks, StreamsFields)
+{
+    std::stringstream all;
+    all << all_fields();
+    ASSERT_EQ("transaction_links{atr: atr-1, atr_bkt: bkt, atr_coll: coll, atr_scope: scp, txn_id: txn-1, attempt_id: attempt-1, "
+              "crc32_of_staging:0xcrc}",
+              all.str());
+
+    std::stringstream none;
+    none << transaction_links();
+    ASSERT_EQ("transaction_links{atr: none, atr_bkt: none, atr_coll: none, atr_scope: none, txn_id: none, attempt_id: none, "
+              "crc32_of_staging:none}",
+              none.str());
+}
@@ -131,3 +131,89 @@ TEST(WaitableOpList, GetModeWaits)
     ASSERT_EQ(mode.query_node, NODE);
     ASSERT_EQ(mode.mode, couchbase::transactions::attempt_mode::modes::QUERY);
 }
+
+TEST(WaitableOpList, AsyncWaitCallsImmediatelyWithNoOps)
+{
+    couchbase::transactions::waitable_op_list op_list;
+    bool called{ false };
+    op_list.wait_and_block_ops([&called]() { called = true; });
+    ASSERT_TRUE(called);
+    ASSERT_THROW(op_list.increment_ops(), couchbase::transactions::async_operation_conflict);
+}
+
+TEST(WaitableOpList, AsyncWaitCalledWhenOpsComplete)
+{
+    couchbase::transactions::waitable_op_list op_list;
+    bool called{ false };
+    op_list.increment_ops();
+    op_list.increment_ops();
+    op_list.wait_and_block_ops([&called]() { called = true; });
+    ASSERT_FALSE(called);
+    op_list.decrement_ops();
+    ASSERT_FALSE(called);
+    op_list.decrement_ops();
+    ASSERT_TRUE(called);
+    ASSERT_THROW(op_list.increment_ops(), couchbase::transactions::async_operation_conflict);
+}
+
+TEST(WaitableOpList, AsyncWaitAllowsOpsStartedByOpsInFlight)
+{
+    couchbase::transactions::waitable_op_list op_list;
+    bool called{ false };
+    op_list.increment_ops();
+    op_list.wait_and_block_ops([&called]() { called = true; });
+    // as an op's callback does: start the next op before the first is counted as done
+    ASSERT_NO_THROW(op_list.increment_ops());
+    op_list.decrement_in_flight();
+    op_list.decrement_ops();
+    ASSERT_FALSE(called);
+    // and again, one level down
+    ASSERT_NO_THROW(op_list.increment_ops());
+    op_list.decrement_in_flight();
+    op_list.decrement_ops();
+    ASSERT_FALSE(called);
+    op_list.decrement_in_flight();
+    op_list.decrement_ops();
+    ASSERT_TRUE(called);
+    ASSERT_THROW(op_list.increment_ops(), couchbase::transactions::async_operation_conflict);
+}
+
+TEST(WaitableOpList, AsyncWaitersAllCalledOnce)
+{
+    couchbase::transactions::waitable_op_list op_list;
+    int calls{ 0 };
+    op_list.increment_ops();
+    op_list.wait_and_block_ops([&calls]() { calls++; });
+    op_list.wait_and_block_ops([&calls]() { calls++; });
+    op_list.decrement_ops();
+    ASSERT_EQ(2, calls);
+}
+
+TEST(WaitableOpList, WhenOpsDoneLeavesOpsAllowed)
+{
+    couchbase::transactions::waitable_op_list op_list;
+    bool called{ false };
+    op_list.increment_ops();
+    op_list.when_ops_done([&called]() { called = true; });
+    ASSERT_NO_THROW(op_list.increment_ops());
+    op_list.decrement_ops();
+    ASSERT_FALSE(called);
+    op_list.decrement_ops();
+    ASSERT_TRUE(called);
+    ASSERT_NO_THROW(op_list.increment_ops());
+}
+
+TEST(WaitableOpList, WhenOpsDoneCalledBeforeOpsBlocked)
+{
+    couchbase::transactions::waitable_op_list op_list;
+    bool could_start_op{ false };
+    op_list.increment_ops();
+    // as an async transaction does: its logic finishes, then commits
+    op_list.when_ops_done([&]() {
+        op_list.wait_and_block_ops([]() {});
+        could_start_op = true;
+    });
+    op_list.decrement_ops();
+    ASSERT_TRUE(could_start_op);
+    ASSERT_THROW(op_list.increment_ops(), couchbase::transactions::async_operation_conflict);
+}
@@ -0,0 +1,125 @@
+/*
+ *     Copyright 2021 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../../src/transactions/windowed_executor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <list>
+#include <thread>
+#include <vector>
+
+using namespace couchbase::transactions;
+using executor = windowed_executor<std::vector<int>::iterator>;
+
+TEST(WindowedExecutor, EmptyRangeCallsHandler)
+{
+    std::vector<int> items;
+    std::promise<size_t> barrier;
+    executor::run(
+      items.begin(),
+      items.end(),
+      4,
+      [](int&, executor::item_callback&& cb) { cb(std::nullopt); },
+      [&barrier](std::list<transaction_operation_failed> errors) { barrier.set_value(errors.size()); });
+    ASSERT_EQ(0, barrier.get_future().get());
+}
+
+TEST(WindowedExecutor, RunsEveryItemWithinWindow)
+{
+    const size_t window = 4;
+    std::vector<int> items(100, 0);
+    std::atomic<size_t> in_flight{ 0 };
+    std::atomic<size_t> max_in_flight{ 0 };
+    std::list<std::thread> threads;
+    std::mutex threads_mutex;
+    std::promise<size_t> barrier;
+    executor::run(
+      items.begin(),
+      items.end(),
+      window,
+      [&](int& item, executor::item_callback&& cb) {
+          auto now = ++in_flight;
+          auto prev = max_in_flight.load();
+          while (now > prev && !max_in_flight.compare_exchange_weak(prev, now)) {
+          }
+          std::lock_guard<std::mutex> lock(threads_mutex);
+          threads.emplace_back([&item, &in_flight, cb = std::move(cb)]() {
+              std::this_thread::sleep_for(std::chrono::milliseconds(1));
+              item = 1;
+              in_flight--;
+              cb(std::nullopt);
+          });
+      },
+      [&barrier](std::list<transaction_operation_failed> errors) { barrier.set_value(errors.size()); });
+    ASSERT_EQ(0, barrier.get_future().get());
+    {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+    ASSERT_LE(max_in_flight.load(), window);
+    for (auto item : items) {
+        ASSERT_EQ(1, item);
+    }
+}
+
+TEST(WindowedExecutor, StopsStartingAfterFailure)
+{
+    std::vector<int> items(10, 0);
+    size_t started = 0;
+    std::promise<size_t> barrier;
+    executor::run(
+      items.begin(),
+      items.end(),
+      1,
+      [&started](int&, executor::item_callback&& cb) {
+          if (++started == 3) {
+              return cb(transaction_operation_failed(FAIL_OTHER, "failed").no_rollback());
+          }
+          cb(std::nullopt);
+      },
+      [&barrier](std::list<transaction_operation_failed> errors) { barrier.set_value(errors.size()); });
+    ASSERT_EQ(1, barrier.get_future().get());
+    ASSERT_EQ(3, started);
+}
+
+TEST(WindowedExecutor, SynchronousCompletionsDoNotNest)
+{
+    std::vector<int> items(100000, 0);
+    size_t depth = 0;
+    size_t max_depth = 0;
+    std::promise<size_t> barrier;
+    executor::run(
+      items.begin(),
+      items.end(),
+      1,
+      [&](int& item, executor::item_callback&& cb) {
+          max_depth = std::max(max_depth, ++depth);
+          item = 1;
+          cb(std::nullopt);
+          depth--;
+      },
+      [&barrier](std::list<transaction_operation_failed> errors) { barrier.set_value(errors.size()); });
+    ASSERT_EQ(0, barrier.get_future().get());
+    ASSERT_EQ(1, max_depth);
+    for (auto item : items) {
+        ASSERT_EQ(1, item);
+    }
+}